@@ -10,13 +10,16 @@ import sys
 import platform
 import shutil
 import subprocess
+import tempfile
 import warnings
 
 # Use setuptools to include build_sphinx, upload/sphinx commands
 try:
     from setuptools import setup, Extension
+    from setuptools.command.build_ext import build_ext
 except:
     from distutils.core import setup, Extension
+    from distutils.command.build_ext import build_ext
 
 # python 2/3 compatible way to load module from file
 def load_module(name, location):
@@ -127,6 +130,9 @@ def create_exension():
             else:
                 extra_objects = []
                 SHARED = True
+        # shm_open is in librt before glibc 2.34
+        if 'rt' not in libraries:
+            libraries += ['rt']
     else:
         print("Platform", UNAME, ARCH, " Not Supported")
         sys.exit(1)
@@ -152,6 +158,88 @@ def create_exension():
 
     return [ca_module], dlls
 
+
+class build_ext_pgo(build_ext):
+    """
+    Build the extension with profile guided and link time optimization if CACHANNEL_PGO is set.
+    The extension is first built with instrumentation and trained with a workload,
+
+    - offline: the DBR conversion benchmark, *tests/benchmark_codec.py*
+    - ioc: in addition the soft IOC benchmark, *tests/benchmark.py*, which needs softIoc
+
+    then rebuilt using the profile. Only gcc and clang are supported.
+    """
+    def build_extensions(self):
+        workload = os.environ.get('CACHANNEL_PGO')
+        if not workload:
+            build_ext.build_extensions(self)
+            return
+        if workload not in ('offline', 'ioc'):
+            raise ValueError('CACHANNEL_PGO must be "offline" or "ioc", not "%s"' % workload)
+        if self.compiler.compiler_type != 'unix':
+            warnings.warn('profile guided optimization is only supported with gcc and clang')
+            build_ext.build_extensions(self)
+            return
+
+        clang = platform.system() == 'Darwin' or 'clang' in ' '.join(self.compiler.compiler_so)
+        profile_dir = os.path.abspath(os.path.join(self.build_temp, 'pgo'))
+        shutil.rmtree(profile_dir, ignore_errors=True)
+        os.makedirs(profile_dir)
+        # the objects must be rebuilt in each step
+        self.force = True
+
+        self.set_flags(['-fprofile-generate=%s' % profile_dir], [])
+        build_ext.build_extensions(self)
+        self.train(workload)
+
+        if clang:
+            profdata = os.path.join(profile_dir, 'default.profdata')
+            subprocess.check_call(['llvm-profdata', 'merge', '-output=%s' % profdata] +
+                                  [os.path.join(profile_dir, f) for f in os.listdir(profile_dir)
+                                   if f.endswith('.profraw')])
+            flags = ['-fprofile-use=%s' % profdata]
+        else:
+            flags = ['-fprofile-use=%s' % profile_dir, '-fprofile-correction']
+        self.set_flags(flags + ['-flto'], [('CACHANNEL_PGO', '1'), ('CACHANNEL_LTO', '1')])
+        build_ext.build_extensions(self)
+
+    def set_flags(self, flags, macros):
+        """add *flags* to the original compile and link arguments, and record them in ca.build_info"""
+        for ext in self.extensions:
+            if not hasattr(ext, 'original_args'):
+                ext.original_args = (ext.extra_compile_args, ext.extra_link_args, ext.define_macros)
+            cflags, lflags, defines = ext.original_args
+            ext.extra_compile_args = cflags + flags
+            ext.extra_link_args = lflags + flags
+            ext.define_macros = defines + macros + [('CACHANNEL_BUILD_FLAGS', '"%s"' % ' '.join(flags))]
+
+    def train(self, workload):
+        """run the workload with the instrumented extension in a temporary copy of the package"""
+        directory = tempfile.mkdtemp(prefix='cachannel-pgo')
+        try:
+            package = os.path.join(directory, 'CaChannel')
+            os.makedirs(package)
+            for filename in os.listdir('src/CaChannel'):
+                if filename.endswith('.py'):
+                    shutil.copy(os.path.join('src/CaChannel', filename), package)
+            for ext in self.extensions:
+                shutil.copy(self.get_ext_fullpath(ext.name), package)
+
+            env = dict(os.environ, PYTHONPATH=directory)
+            commands = [
+                ['tests/benchmark_codec.py', '--max-count', '10000', '--elements', '1000000'],
+                ['tests/benchmark_codec.py', '--max-count', '10000', '--elements', '1000000', '--callback-args'],
+                ['tests/benchmark_codec.py', '--max-count', '10000', '--elements', '1000000', '--callback-args', '--numpy'],
+            ]
+            if workload == 'ioc':
+                commands.append(['tests/benchmark.py', '--scalars', '100', '--duration', '2', '-o', os.devnull])
+            with open(os.devnull, 'w') as devnull:
+                for command in commands:
+                    subprocess.check_call([sys.executable] + command, env=env, stdout=devnull)
+        finally:
+            shutil.rmtree(directory, ignore_errors=True)
+
+
 _version = load_module('_version', 'src/CaChannel/_version.py')
 
 if build_ca_ext:
@@ -189,6 +277,7 @@ setup(name="CaChannel",
       package_dir={"": "src", "CaChannel": "src/CaChannel"},
       py_modules=["ca", "epicsPV", "epicsMotor"],
       ext_modules=ext_module,
+      cmdclass={'build_ext': build_ext_pgo},
       package_data={'CaChannel': package_data},
       install_requires=requirements
       )
@@ -17,6 +17,13 @@ else:
 import CaChannel as PACKAGE
 from . import ca
 
+_ensure_attached = ca.ensure_attached
+
+# the C extension returns the values with the CaChannel field names and char arrays as string,
+# and calls the user callbacks with their user arguments directly.
+# with caffi they are converted and dispatched in Python
+_C_EXTENSION = hasattr(ca, 'build_info')
+
 
 class CaChannelException(Exception):
     def __init__(self, status):
@@ -72,11 +79,7 @@ class CaChannel(object):
     def attach_ca_context(func):
         @wraps(func)
         def wrapper(*args, **kwargs):
-            if CaChannel.__context is None:
-                ca.create_context(True)
-                CaChannel.__context = ca.current_context()
-            else:
-                ca.attach_context(CaChannel.__context)
+            CaChannel.__context = _ensure_attached(CaChannel.__context)
             return func(*args, **kwargs)
 
         return wrapper
@@ -432,7 +435,7 @@ class CaChannel(object):
         if status != ca.ECA_NORMAL:
             raise CaChannelException(status)
 
-    def array_put_callback(self, value, req_type, count, callback, *user_args):
+    def array_put_callback(self, value, req_type, count, callback, *user_args, **keywords):
         """Write a value or array of values to a channel and execute the user
         supplied callback after the put has completed.
 
@@ -441,6 +444,14 @@ class CaChannel(object):
         :param count:           number of data values to write, Defaults to be the native count.
         :param callback:        function called when the write is completed.
         :param user_args:       user provided arguments that are passed to callback when it is invoked.
+        :param keywords:        optional arguments assigned by keywords
+
+                                ===========   ===================================================
+                                keyword       value
+                                ===========   ===================================================
+                                completion    completion from :py:meth:`ca.completion_create`,
+                                              signalled after the callback returns.
+                                ===========   ===================================================
         :type value: int, float, bytes, str, list, tuple, array
         :type req_type: int, None
         :type count: int, None
@@ -489,7 +500,15 @@ class CaChannel(object):
         >>> status = chan.pend_event(1)
         cawavec put completed
         """
-        status = ca.put(self._chid, value, req_type, count, lambda epics_args: callback(epics_args, user_args))
+        if _C_EXTENSION:
+            put_callback = (callback, user_args)
+        else:
+            put_callback = lambda epics_args: callback(epics_args, user_args)
+        completion = keywords.get('completion')
+        if completion is None:
+            status = ca.put(self._chid, value, req_type, count, put_callback)
+        else:
+            status = ca.put(self._chid, value, req_type, count, put_callback, completion=completion)
         if status != ca.ECA_NORMAL:
             raise CaChannelException(status)
     #
@@ -529,6 +548,9 @@ class CaChannel(object):
         if self._dbrvalue is None:
             return
 
+        if _C_EXTENSION:
+            return self._dbrvalue.get()
+
         dbrvalue = self._dbrvalue.get()
         if isinstance(dbrvalue, dict):
             value = {}
@@ -580,7 +602,12 @@ class CaChannel(object):
         123.0
         """
         use_numpy = keywords.get('use_numpy', PACKAGE.USE_NUMPY)
-        status, self._dbrvalue = ca.get(self._chid, req_type, count, None, use_numpy)
+        if _C_EXTENSION:
+            # as_string is set by getw for char arrays
+            status, self._dbrvalue = ca.get(self._chid, req_type, count, None, use_numpy,
+                                            as_string=keywords.get('as_string', False), pv_fields=True)
+        else:
+            status, self._dbrvalue = ca.get(self._chid, req_type, count, None, use_numpy)
         if status != ca.ECA_NORMAL:
             raise CaChannelException(status)
 
@@ -599,6 +626,8 @@ class CaChannel(object):
                             ===========   ===================================================
                             use_numpy     True if waveform should be returned as numpy array.
                                           Default :data:`CaChannel.USE_NUMPY`.
+                            completion    completion from :py:meth:`ca.completion_create`,
+                                          signalled after the callback returns.
                             ===========   ===================================================
         :type req_type:     int, None
         :type count:        int, None
@@ -702,8 +731,15 @@ class CaChannel(object):
         pv_value 0
         """
         use_numpy = keywords.get('use_numpy', PACKAGE.USE_NUMPY)
-        self._callbacks['getCB'] = (callback, user_args, use_numpy)
-        status, _ = ca.get(self._chid, req_type, count, self._get_callback, use_numpy)
+        options = {}
+        if keywords.get('completion') is not None:
+            options['completion'] = keywords['completion']
+        if _C_EXTENSION:
+            options['pv_fields'] = True
+            status, _ = ca.get(self._chid, req_type, count, (callback, user_args), use_numpy, **options)
+        else:
+            self._callbacks['getCB'] = (callback, user_args, use_numpy)
+            status, _ = ca.get(self._chid, req_type, count, self._get_callback, use_numpy, **options)
         if status != ca.ECA_NORMAL:
             raise CaChannelException(status)
 
@@ -731,6 +767,7 @@ class CaChannel(object):
                             ===========   ===================================================
                             use_numpy     True if waveform should be returned as numpy array.
                                           Default :data:`CaChannel.USE_NUMPY`.
+                            as_string     True if char array should be returned as string.
                             ===========   ===================================================
         :type req_type: int, None
         :type count: int, None
@@ -776,9 +813,14 @@ class CaChannel(object):
             count = self.element_count()
 
         use_numpy = keywords.get('use_numpy', PACKAGE.USE_NUMPY)
-        self._callbacks['eventCB'] = (callback, user_args, use_numpy)
+        as_string = keywords.get('as_string', False)
 
-        status, self._evid = ca.create_subscription(self._chid, self._event_callback, req_type, count, mask, use_numpy)
+        if _C_EXTENSION:
+            status, self._evid = ca.create_subscription(self._chid, (callback, user_args), req_type, count, mask,
+                                                        use_numpy, as_string=as_string, pv_fields=True)
+        else:
+            self._callbacks['eventCB'] = (callback, user_args, use_numpy, as_string)
+            status, self._evid = ca.create_subscription(self._chid, self._event_callback, req_type, count, mask, use_numpy)
 
         if status != ca.ECA_NORMAL:
             raise CaChannelException(status)
@@ -1110,6 +1152,8 @@ class CaChannel(object):
             req_type = dbr_string_to_char[req_type]
             char_as_string = True
 
+        if _C_EXTENSION:
+            keywords['as_string'] = char_as_string
         self.array_get(req_type, count, **keywords)
         timeout = self.getTimeout()
         self.pend_io(timeout)
@@ -1117,7 +1161,7 @@ class CaChannel(object):
         value = self.getValue()
 
         # convert char
-        if char_as_string:
+        if char_as_string and not _C_EXTENSION:
             if isinstance(value, dict):
                 value['pv_value'] = CaChannel._ints_to_string(value['pv_value'])
             else:
@@ -1128,7 +1172,8 @@ class CaChannel(object):
     #
     # Callback functions
     #
-    # These functions hook user supplied callback functions to CA extension
+    # These functions hook user supplied callback functions to CA extension.
+    # The get, put and monitor callbacks are called by the C extension directly, with caffi through these.
 
     def _access_callback(self, epicsArgs):
         callback = self._callbacks.get('accessCB')
@@ -1202,8 +1247,10 @@ class CaChannel(object):
         callback = self._callbacks.get('eventCB')
         if callback is None:
             return
-        callbackFunc, userArgs, use_numpy = callback
+        callbackFunc, userArgs, use_numpy, as_string = callback
         epicsArgs = CaChannel._format_cb_args(epicsArgs, use_numpy)
+        if as_string and ca.dbr_type_is_CHAR(epicsArgs['type']):
+            epicsArgs['pv_value'] = CaChannel._ints_to_string(epicsArgs['pv_value'])
         try:
             callbackFunc(epicsArgs, userArgs)
         except:
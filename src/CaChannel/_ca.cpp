@@ -2,6 +2,10 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <algorithm>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,16 +15,124 @@
 #include <alarm.h>
 #undef epicsAlarmGLOBAL
 #include <cadef.h>
+#include <epicsVersion.h>
+#include <epicsTime.h>
+#include <epicsMutex.h>
+#include <epicsThread.h>
+#include <epicsEvent.h>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <signal.h>
+    #include <unistd.h>
+#endif
+#include <errno.h>
+
+/********************************************
+ *          libCom compatibility            *
+ ********************************************/
+#ifndef VERSION_INT
+    #define VERSION_INT(V,R,M,P) ( ((V)<<24) | ((R)<<16) | ((M)<<8) | (P))
+    #define EPICS_VERSION_INT VERSION_INT(EPICS_VERSION, EPICS_REVISION, EPICS_MODIFICATION, EPICS_PATCH_LEVEL)
+#endif
+
+#if EPICS_VERSION_INT >= VERSION_INT(3,15,0,0)
+    #include <epicsAtomic.h>
+#else
+/* epics base 3.14 has no epicsAtomic, emulate the few operations used with a global lock */
+static epicsMutexId ATOMIC_LOCK = NULL;
+static inline size_t epicsAtomicGetSizeT(const size_t *pTarget)
+{
+    epicsMutexMustLock(ATOMIC_LOCK);
+    size_t value = *pTarget;
+    epicsMutexUnlock(ATOMIC_LOCK);
+    return value;
+}
+static inline void epicsAtomicSetSizeT(size_t *pTarget, size_t value)
+{
+    epicsMutexMustLock(ATOMIC_LOCK);
+    *pTarget = value;
+    epicsMutexUnlock(ATOMIC_LOCK);
+}
+static inline size_t epicsAtomicAddSizeT(size_t *pTarget, size_t delta)
+{
+    epicsMutexMustLock(ATOMIC_LOCK);
+    size_t value = (*pTarget += delta);
+    epicsMutexUnlock(ATOMIC_LOCK);
+    return value;
+}
+static inline size_t epicsAtomicIncrSizeT(size_t *pTarget) { return epicsAtomicAddSizeT(pTarget, 1); }
+static inline size_t epicsAtomicDecrSizeT(size_t *pTarget) { return epicsAtomicAddSizeT(pTarget, (size_t)-1); }
+static inline size_t epicsAtomicCmpAndSwapSizeT(size_t *pTarget, size_t oldValue, size_t newValue)
+{
+    epicsMutexMustLock(ATOMIC_LOCK);
+    size_t value = *pTarget;
+    if (value == oldValue)
+        *pTarget = newValue;
+    epicsMutexUnlock(ATOMIC_LOCK);
+    return value;
+}
+#endif
+
+/* monotonic time in nanoseconds */
+static inline epicsUInt64 monotonic_ns()
+{
+#if EPICS_VERSION_INT >= VERSION_INT(3,16,1,0)
+    return epicsMonotonicGet();
+#else
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    return (epicsUInt64)now.secPastEpoch * 1000000000u + now.nsec;
+#endif
+}
 
 static bool HAS_NUMPY = false;
 static PyObject *MODULE = NULL;
 static PyObject *NUMPY = NULL;
+struct ContextStats;
 struct context_callback {
     PyObject *pExceptionCallback;
     PyObject *pPrintfHandler;
-    context_callback() : pExceptionCallback(NULL), pPrintfHandler(NULL) {}
+    ContextStats *pStats;
+    size_t logGeneration;   /* tag of its buffered exception records, never reused */
+    context_callback() : pExceptionCallback(NULL), pPrintfHandler(NULL), pStats(NULL), logGeneration(0) {}
 };
 static std::map<struct ca_client_context*, context_callback> CONTEXTS;
+static void ContextStats_release(ContextStats *pStats);
+static void connect_forget_context(ContextStats *pStats);
+struct Recorder;
+static void Recorder_release(Recorder *pRecorder);
+static void recorder_close(void *ptr);
+static void recorder_write(Recorder *pRecorder, epicsUInt32 channel, const struct event_handler_args &args);
+static epicsUInt32 recorder_add_channel(Recorder *pRecorder, const char *name);
+struct SharedMemory;
+static void SharedMemory_release(SharedMemory *pShm);
+static void shm_close(void *ptr);
+static void shm_write(SharedMemory *pShm, epicsUInt32 slot, const struct event_handler_args &args);
+static long shm_add_channel(SharedMemory *pShm, const char *name);
+struct Sampler;
+static void Sampler_release(Sampler *pSampler);
+static void sampler_close(void *ptr);
+static void sampler_update(Sampler *pSampler, size_t channel, const struct event_handler_args &args);
+static size_t sampler_add_channel(Sampler *pSampler, const char *name);
+template<typename DBRTYPE>
+PyObject *ValueToNumpyArray(void *vp, Py_ssize_t count, const char *nptype);
+template<>
+PyObject *ValueToNumpyArray<dbr_string_t>(void *vp, Py_ssize_t count, const char *nptype);
+struct Completion;
+static void Completion_release(Completion *pCompletion);
+static void completion_issue(Completion *pCompletion);
+static void completion_done(Completion *pCompletion);
 
 #ifndef MIN
      #define MIN(X,Y) ((X) < (Y) ? (X) : (Y))
@@ -44,6 +156,7 @@ static std::map<struct ca_client_context*, context_callback> CONTEXTS;
     #define CAPSULE_BUILD(ptr,name, destr) PyCapsule_New(ptr, name, destr)
     #define CAPSULE_CHECK(obj) PyCapsule_CheckExact(obj)
     #define CAPSULE_EXTRACT(obj,name) PyCapsule_GetPointer(obj, name)
+    #define CAPSULE_IS(obj,name) PyCapsule_IsValid(obj, name)
 #else
     #define PyBytes_Check PyString_Check
     #define PyBytes_FromString PyString_FromString
@@ -51,6 +164,16 @@ static std::map<struct ca_client_context*, context_callback> CONTEXTS;
     #define CAPSULE_BUILD(ptr,name, destr) PyCObject_FromVoidPtr(ptr, destr)
     #define CAPSULE_CHECK(obj) PyCObject_Check(obj)
     #define CAPSULE_EXTRACT(obj,name) PyCObject_AsVoidPtr(obj)
+    /* CObject carries no name, take it as a channel */
+    #define CAPSULE_IS(obj,name) (PyCObject_Check(obj) && strcmp(name, "chid") == 0)
+#endif
+
+/* the full API builds take the hot entry points with METH_FASTCALL and invoke callbacks with vectorcall */
+#if !defined(Py_LIMITED_API) && PY_VERSION_HEX >= 0x03070000
+    #define CA_FASTCALL
+#endif
+#if !defined(Py_LIMITED_API) && PY_VERSION_HEX >= 0x03090000
+    #define CA_VECTORCALL
 #endif
 
 static PyObject *Py_ca_create_context(PyObject *self, PyObject *args, PyObject *kws);
@@ -58,35 +181,77 @@ static PyObject *Py_ca_destroy_context(PyObject *self, PyObject *args);
 static PyObject *Py_ca_attach_context(PyObject *self, PyObject *args);
 static PyObject *Py_ca_detach_context(PyObject *self, PyObject *args);
 static PyObject *Py_ca_current_context(PyObject *self, PyObject *args);
+static PyObject *Py_ca_preemptive_callback_is_enabled(PyObject *self, PyObject *args);
+static PyObject *Py_ca_ensure_attached(PyObject *self, PyObject *args);
 static PyObject *Py_ca_show_context(PyObject *self, PyObject *args, PyObject *kws);
 
 static PyObject *Py_ca_create_channel(PyObject *self, PyObject *args, PyObject *kws);
 static PyObject *Py_ca_clear_channel(PyObject *self, PyObject *args);
 static PyObject *Py_ca_change_connection_event(PyObject *self, PyObject *args);
+#ifdef CA_FASTCALL
+static PyObject *Py_ca_get(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+static PyObject *Py_ca_put(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames);
+#else
 static PyObject *Py_ca_get(PyObject *self, PyObject *args, PyObject *kws);
 static PyObject *Py_ca_put(PyObject *self, PyObject *args, PyObject *kws);
+#endif
 static PyObject *Py_ca_create_subscription(PyObject *self, PyObject *args, PyObject *kws);
 static PyObject *Py_ca_clear_subscription(PyObject *self, PyObject *args);
 
 static PyObject *Py_ca_replace_access_rights_event(PyObject *self, PyObject *args);
-static PyObject *Py_ca_add_exception_event(PyObject *self, PyObject *args);
-static PyObject *Py_ca_replace_printf_handler(PyObject *self, PyObject *args);
+static PyObject *Py_ca_add_exception_event(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_replace_printf_handler(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_drain_log(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_log_stats(PyObject *self, PyObject *args);
 
 static PyObject *Py_ca_pend(PyObject *self, PyObject *args);
 static PyObject *Py_ca_flush_io(PyObject *self, PyObject *args);
 static PyObject *Py_ca_pend_io(PyObject *self, PyObject *args);
+#ifdef CA_FASTCALL
+static PyObject *Py_ca_pend_event(PyObject *self, PyObject *const *args, Py_ssize_t nargs);
+#else
 static PyObject *Py_ca_pend_event(PyObject *self, PyObject *args);
+#endif
 static PyObject *Py_ca_poll(PyObject *self, PyObject *args);
 static PyObject *Py_ca_test_io(PyObject *self, PyObject *args);
 
-static PyObject *Py_ca_field_type(PyObject *self, PyObject *args);
-static PyObject *Py_ca_element_count(PyObject *self, PyObject *args);
-static PyObject *Py_ca_name(PyObject *self, PyObject *args);
-static PyObject *Py_ca_state(PyObject *self, PyObject *args);
+static PyObject *Py_ca_field_type(PyObject *self, PyObject *pChid);
+static PyObject *Py_ca_element_count(PyObject *self, PyObject *pChid);
+static PyObject *Py_ca_name(PyObject *self, PyObject *pChid);
+static PyObject *Py_ca_state(PyObject *self, PyObject *pChid);
 static PyObject *Py_ca_host_name(PyObject *self, PyObject *args);
 static PyObject *Py_ca_read_access(PyObject *self, PyObject *args);
 static PyObject *Py_ca_write_access(PyObject *self, PyObject *args);
 static PyObject *Py_ca_version(PyObject *self, PyObject *args);
+static PyObject *Py_ca_build_info(PyObject *self, PyObject *args);
+static PyObject *Py_ca_stats(PyObject *self, PyObject *args);
+static PyObject *Py_ca_enable_latency_stats(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_latency_stats(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_connect_report(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_enable_memory_debug(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_memory_stats(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_trace_start(PyObject *self, PyObject *args);
+static PyObject *Py_ca_trace_stop(PyObject *self, PyObject *args);
+static PyObject *Py_ca_trace_dump(PyObject *self, PyObject *args);
+static PyObject *Py_ca_bench_decode(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_bench_encode(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_recorder_open(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_recorder_close(PyObject *self, PyObject *args);
+static PyObject *Py_ca_recorder_stats(PyObject *self, PyObject *args);
+static PyObject *Py_ca_replay(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_shm_create(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_shm_attach(PyObject *self, PyObject *args);
+static PyObject *Py_ca_shm_close(PyObject *self, PyObject *args);
+static PyObject *Py_ca_shm_channels(PyObject *self, PyObject *args);
+static PyObject *Py_ca_shm_read(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_shm_stats(PyObject *self, PyObject *args);
+static PyObject *Py_ca_sampler_create(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_sampler_close(PyObject *self, PyObject *args);
+static PyObject *Py_ca_sampler_sample(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_sampler_data(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_completion_create(PyObject *self, PyObject *args);
+static PyObject *Py_ca_completion_wait(PyObject *self, PyObject *args, PyObject *kws);
+static PyObject *Py_ca_completion_pending(PyObject *self, PyObject *args);
 
 static PyObject *Py_ca_sg_create(PyObject *self, PyObject *args);
 static PyObject *Py_ca_sg_delete(PyObject *self, PyObject *args);
@@ -125,50 +290,53 @@ static PyObject *Py_ca_message(PyObject *self, PyObject *args);
 static PyObject *Py_alarmSeverityString(PyObject *self, PyObject *args);
 static PyObject *Py_alarmStatusString(PyObject *self, PyObject *args);
 
-static PyObject *CBufferToPythonDict(chtype type, unsigned long count, const void *val, bool use_numpy);
+/* format flags of CBufferToPythonDict */
+#define FORMAT_AS_STRING    0x1     /* DBR_CHAR array as a string */
+#define FORMAT_PV_FIELDS    0x2     /* dict with the CaChannel field names, pv_value, pv_seconds etc */
+#define FORMAT_STAMP_NS     0x4     /* time stamp as nanoseconds since the POSIX epoch */
+#define FORMAT_FIXED_STRINGS 0x8    /* DBR_STRING array as numpy dtype 'S40' with use_numpy */
+
+static PyObject *CBufferToPythonDict(chtype type, unsigned long count, const void *val, bool use_numpy, int format=0);
+static void *PythonToCBuffer(PyObject *pValue, PyObject *pType, PyObject *pCount,
+                             chtype &dbrtype, unsigned long &count);
 static void *setup_put(chanId chid, PyObject *pValue, PyObject *pType, PyObject *pCount,
                        chtype &dbrtype, unsigned long &count);
 
 /********************************************
  *          Helper functions                *
  ********************************************/
-static void add_IntEnum(PyObject * pModule, const char *buffer)
+static PyObject* CharToPyStringOrBytes(const char *buffer)
 {
-    PyObject *pModuleDict = PyModule_GetDict(pModule);
-    PyObject *pGlobalDict = PyEval_GetGlobals();
-
-    PyObject *pDict = PyDict_New();
-    PyDict_Update(pDict, pGlobalDict);
-    PyDict_Update(pDict, pModuleDict);
-
-    #if PY_MAJOR_VERSION >= 3
-    PyObject * pCode = Py_CompileString(buffer, "<string>", Py_file_input);
-    #else
-    PyCodeObject * pCode = (PyCodeObject*)Py_CompileString(buffer, "<string>", Py_file_input);
-    #endif
-
-    if (pCode == NULL) {
+    PyObject * pString = PyString_FromString(buffer);
+    if (pString == NULL) {
         PyErr_Clear();
-    } else {
-        PyObject * pTemp = PyEval_EvalCode(pCode, pDict, pModuleDict);
-        if (pTemp == NULL)
-            PyErr_Clear();
-        else
-            Py_XDECREF(pTemp);
-        Py_XDECREF(pCode);
+        pString = PyBytes_FromString(buffer);
     }
-
-    Py_XDECREF(pDict);
+    return pString;
 }
 
-static PyObject* CharToPyStringOrBytes(const char *buffer)
+/* the string of a char array up to the first null character */
+static PyObject* CharArrayToPyStringOrBytes(const char *buffer, unsigned long count)
 {
-    PyObject * pString = PyString_FromString(buffer);
+    unsigned long length = 0;
+    while (length < count && buffer[length] != '\0')
+        length++;
+#if PY_MAJOR_VERSION >= 3
+    PyObject * pString = PyUnicode_DecodeUTF8(buffer, length, NULL);
     if (pString == NULL) {
         PyErr_Clear();
-        pString = PyBytes_FromString(buffer);
+        pString = PyBytes_FromStringAndSize(buffer, length);
     }
     return pString;
+#else
+    return PyString_FromStringAndSize(buffer, length);
+#endif
+}
+
+/* nanoseconds since the POSIX epoch */
+static epicsInt64 StampNanoseconds(const epicsTimeStamp &ts)
+{
+    return ((epicsInt64)ts.secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH) * 1000000000 + ts.nsec;
 }
 
 static long PyObjectToLong(PyObject *o)
@@ -181,6 +349,181 @@ static long PyObjectToLong(PyObject *o)
     return PyLong_AsLong(PyNumber_Long(o));
 }
 
+/* call a Python callback with a single argument, followed by the user arguments if given */
+static PyObject *call_callback(PyObject *pCallback, PyObject *pArg, PyObject *pUserArgs=NULL)
+{
+    if (pArg == NULL)
+        return NULL;
+#ifdef CA_VECTORCALL
+    PyObject *args[] = {pArg, pUserArgs};
+    return PyObject_Vectorcall(pCallback, args, pUserArgs == NULL ? 1 : 2, NULL);
+#else
+    return PyObject_CallFunctionObjArgs(pCallback, pArg, pUserArgs, NULL);
+#endif
+}
+
+/* a (callable, user_args) pair given as callback, user_args is passed as second argument */
+static bool is_callback_pair(PyObject *pCallback)
+{
+    return PyTuple_Check(pCallback) && PyTuple_Size(pCallback) == 2 &&
+           PyCallable_Check(PyTuple_GetItem(pCallback, 0)) && PyTuple_Check(PyTuple_GetItem(pCallback, 1));
+}
+
+#ifdef CA_FASTCALL
+/*
+    Assign the arguments of a METH_FASTCALL|METH_KEYWORDS call to the slots of the parameters in kwlist,
+    like PyArg_ParseTupleAndKeywords does with "O" units. The slots of the omitted optional parameters
+    keep their defaults, the first required parameters must be given.
+*/
+static bool fastcall_parse(const char *function, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames,
+                           const char **kwlist, Py_ssize_t required, PyObject **values)
+{
+    Py_ssize_t nparams = 0;
+    while (kwlist[nparams] != NULL)
+        nparams++;
+
+    if (nargs > nparams) {
+        PyErr_Format(PyExc_TypeError, "%s() takes at most %zd arguments (%zd given)", function, nparams, nargs);
+        return false;
+    }
+    for (Py_ssize_t i = 0; i < nargs; i++)
+        values[i] = args[i];
+
+    Py_ssize_t nkws = kwnames == NULL ? 0 : PyTuple_GET_SIZE(kwnames);
+    for (Py_ssize_t k = 0; k < nkws; k++) {
+        const char *name = PyUnicode_AsUTF8(PyTuple_GET_ITEM(kwnames, k));
+        if (name == NULL)
+            return false;
+        Py_ssize_t i = 0;
+        while (i < nparams && strcmp(name, kwlist[i]) != 0)
+            i++;
+        if (i == nparams) {
+            PyErr_Format(PyExc_TypeError, "'%s' is an invalid keyword argument for %s()", name, function);
+            return false;
+        }
+        if (i < nargs) {
+            PyErr_Format(PyExc_TypeError, "argument for %s() given by name ('%s') and position (%zd)",
+                         function, name, i + 1);
+            return false;
+        }
+        values[i] = args[nargs + k];
+    }
+
+    for (Py_ssize_t i = 0; i < required; i++) {
+        if (values[i] == NULL) {
+            PyErr_Format(PyExc_TypeError, "%s() missing required argument '%s' (pos %zd)",
+                         function, kwlist[i], i + 1);
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+/********************************************
+ *          Memory accounting               *
+ ********************************************/
+/*
+    Memory held outside the Python allocators, thus invisible to tracemalloc: the DBR buffers
+    of DBRValue objects, the ChannelData objects of channels, subscriptions and outstanding
+    get/put callbacks, and the latency histograms. The counters are atomic.
+
+    In debug mode the Python source line that allocated each outstanding object is recorded,
+    so that a ChannelData whose callback never fired can be traced to its origin. Objects are
+    allocated and freed with the GIL held, which protects the site registry.
+*/
+enum MemoryKind { MEMORY_DBR_BUFFER, MEMORY_CHANNEL, MEMORY_GET, MEMORY_PUT, MEMORY_SUBSCRIPTION,
+                  MEMORY_HISTOGRAM, MEMORY_KINDS };
+static const char *MEMORY_KIND_NAMES[MEMORY_KINDS] = {
+    "dbr_buffer", "channel", "get_callback", "put_callback", "subscription", "histogram"
+};
+
+struct MemoryCounter {
+    size_t count;       /* objects alive */
+    size_t bytes;       /* bytes alive */
+    size_t peak_bytes;
+    size_t allocations; /* objects allocated since import */
+};
+
+struct MemorySite {
+    int kind;
+    size_t bytes;
+    std::string site;
+};
+
+static MemoryCounter MEMORY[MEMORY_KINDS];
+static int MEMORY_DEBUG_DEPTH = 0;  /* Python frames recorded per allocation, 0 if disabled */
+static std::map<const void*, MemorySite> MEMORY_SITES;
+
+/* "file:line" of the innermost Python frames, joined by " <- " */
+static std::string memory_site()
+{
+    std::string site;
+    PyObject *pGetFrame = PySys_GetObject((char *)"_getframe");
+    PyObject *pFrame = pGetFrame ? PyObject_CallObject(pGetFrame, NULL) : NULL;
+    if (pFrame == NULL) {
+        /* called back from a CA thread */
+        PyErr_Clear();
+        return "<ca callback>";
+    }
+    for (int depth = 0; depth < MEMORY_DEBUG_DEPTH && pFrame != Py_None; depth++) {
+        PyObject *pCode = PyObject_GetAttrString(pFrame, "f_code");
+        PyObject *pFilename = pCode ? PyObject_GetAttrString(pCode, "co_filename") : NULL;
+        PyObject *pLineno = PyObject_GetAttrString(pFrame, "f_lineno");
+        if (pFilename != NULL && pLineno != NULL) {
+            char line[32];
+            sprintf(line, ":%ld", PyLong_AsLong(pLineno));
+            if (!site.empty())
+                site += " <- ";
+            const char *filename = PyString_Check(pFilename) ? PyString_AsString(pFilename) : NULL;
+            site += filename ? filename : "<unknown>";
+            site += line;
+        }
+        Py_XDECREF(pLineno);
+        Py_XDECREF(pFilename);
+        Py_XDECREF(pCode);
+
+        PyObject *pBack = PyObject_GetAttrString(pFrame, "f_back");
+        Py_DECREF(pFrame);
+        pFrame = pBack;
+        if (pFrame == NULL)
+            break;
+    }
+    Py_XDECREF(pFrame);
+    PyErr_Clear();
+    return site;
+}
+
+static void memory_track(const void *ptr, int kind, size_t bytes)
+{
+    MemoryCounter *pCounter = &MEMORY[kind];
+    epicsAtomicIncrSizeT(&pCounter->count);
+    epicsAtomicIncrSizeT(&pCounter->allocations);
+    size_t total = epicsAtomicAddSizeT(&pCounter->bytes, bytes);
+    size_t peak = epicsAtomicGetSizeT(&pCounter->peak_bytes);
+    while (total > peak) {
+        size_t previous = epicsAtomicCmpAndSwapSizeT(&pCounter->peak_bytes, peak, total);
+        if (previous == peak)
+            break;
+        peak = previous;
+    }
+    if (MEMORY_DEBUG_DEPTH > 0) {
+        MemorySite &site = MEMORY_SITES[ptr];
+        site.kind = kind;
+        site.bytes = bytes;
+        site.site = memory_site();
+    }
+}
+
+static void memory_untrack(const void *ptr, int kind, size_t bytes)
+{
+    MemoryCounter *pCounter = &MEMORY[kind];
+    epicsAtomicDecrSizeT(&pCounter->count);
+    epicsAtomicAddSizeT(&pCounter->bytes, (size_t)0 - bytes);
+    if (!MEMORY_SITES.empty())
+        MEMORY_SITES.erase(ptr);
+}
+
 /********************************************
  *          DBRValue object type            *
  ********************************************/
@@ -195,12 +538,15 @@ typedef struct {
     unsigned long count;
     void *dbr;
     bool use_numpy;
+    int format;
 } DBRValueObject;
 
 static void DBRValue_dealloc(DBRValueObject* self)
 {
-    if (self->dbr)
+    if (self->dbr) {
+        memory_untrack(self->dbr, MEMORY_DBR_BUFFER, dbr_size_n(self->dbrtype, self->count));
         free(self->dbr);
+    }
 
 #ifdef Py_LIMITED_API
     ((freefunc)PyType_GetSlot(Py_TYPE((PyObject*)self), Py_tp_free))(self);
@@ -215,7 +561,7 @@ static PyObject *DBRValue_get(DBRValueObject *self)
         PyErr_SetString(PyExc_ValueError, "DBRValue_get called with null pointer");
         return NULL;
     }
-    PyObject *value = CBufferToPythonDict(self->dbrtype, self->count, self->dbr, self->use_numpy);
+    PyObject *value = CBufferToPythonDict(self->dbrtype, self->count, self->dbr, self->use_numpy, self->format);
 
     return value;
 }
@@ -302,7 +648,7 @@ static PyTypeObject DBRValueType = {
 };
 #endif
 
-static PyObject *DBRValue_New(chtype dbrtype, unsigned long count, void *dbr, bool use_numpy)
+static PyObject *DBRValue_New(chtype dbrtype, unsigned long count, void *dbr, bool use_numpy, int format=0)
 {
     DBRValueObject *self;
 #if PY_MAJOR_VERSION >= 3
@@ -318,6 +664,9 @@ static PyObject *DBRValue_New(chtype dbrtype, unsigned long count, void *dbr, bo
     self->count = count;
     self->dbr = dbr;
     self->use_numpy = use_numpy;
+    self->format = format;
+    if (dbr != NULL)
+        memory_track(dbr, MEMORY_DBR_BUFFER, dbr_size_n(dbrtype, count));
 
     return (PyObject *) self;
 }
@@ -330,33 +679,73 @@ static PyMethodDef CA_Methods[] = {
     {"attach_context",      Py_ca_attach_context,   METH_VARARGS, "Detach a CA context"},
     {"detach_context",      Py_ca_detach_context,   METH_VARARGS, "Attach to a CA context"},
     {"current_context",     Py_ca_current_context,  METH_VARARGS, "Get the current CA context"},
+    {"preemptive_callback_is_enabled", Py_ca_preemptive_callback_is_enabled, METH_VARARGS, "Check whether the current CA context has preemptive callbacks"},
+    {"ensure_attached",     Py_ca_ensure_attached,  METH_VARARGS, "Attach to a CA context unless already attached"},
     {"show_context", (PyCFunction)Py_ca_show_context,     METH_VARARGS|METH_KEYWORDS, "Show the CA context information"},
     /* Channel creation */
     {"create_channel", (PyCFunction)Py_ca_create_channel,   METH_VARARGS|METH_KEYWORDS, "Create a CA channel connection"},
     {"clear_channel",       Py_ca_clear_channel,    METH_VARARGS, "Shutdown a CA channel connection"},
     {"change_connection_event",  Py_ca_change_connection_event,    METH_VARARGS, "change connection callback function"},
+#ifdef CA_FASTCALL
+    {"get",          (PyCFunction)Py_ca_get,              METH_FASTCALL|METH_KEYWORDS, "Read PV's value"},
+    {"put",          (PyCFunction)Py_ca_put,              METH_FASTCALL|METH_KEYWORDS, "Write a value to PV"},
+#else
     {"get",          (PyCFunction)Py_ca_get,              METH_VARARGS|METH_KEYWORDS, "Read PV's value"},
     {"put",          (PyCFunction)Py_ca_put,              METH_VARARGS|METH_KEYWORDS, "Write a value to PV"},
+#endif
     {"create_subscription", (PyCFunction)Py_ca_create_subscription,METH_VARARGS|METH_KEYWORDS,"Subscribe for state changes"},
     {"clear_subscription",  Py_ca_clear_subscription, METH_VARARGS,"Unsubscribe for state changes"},
     {"replace_access_rights_event", Py_ca_replace_access_rights_event, METH_VARARGS, "Replace access right event"},
-    {"add_exception_event", Py_ca_add_exception_event, METH_VARARGS, "Replace exception event handler"},
-    {"replace_printf_handler", Py_ca_replace_printf_handler, METH_VARARGS, "Replace printf handler"},
+    {"add_exception_event", (PyCFunction)Py_ca_add_exception_event, METH_VARARGS|METH_KEYWORDS, "Replace exception event handler"},
+    {"replace_printf_handler", (PyCFunction)Py_ca_replace_printf_handler, METH_VARARGS|METH_KEYWORDS, "Replace printf handler"},
+    {"drain_log",   (PyCFunction)Py_ca_drain_log,  METH_VARARGS|METH_KEYWORDS, "Dispatch buffered printf and exception records"},
+    {"log_stats",   Py_ca_log_stats,    METH_VARARGS, "Statistics of the buffered log"},
     /* Info */
-    {"field_type",      Py_ca_field_type,       METH_VARARGS, "PV's native type"},
-    {"element_count",   Py_ca_element_count,    METH_VARARGS, "PV's array element count"},
-    {"name",            Py_ca_name,             METH_VARARGS, "PV's name"},
-    {"state",           Py_ca_state,            METH_VARARGS, "State of the CA channel connection"},
+    {"field_type",      Py_ca_field_type,       METH_O, "PV's native type"},
+    {"element_count",   Py_ca_element_count,    METH_O, "PV's array element count"},
+    {"name",            Py_ca_name,             METH_O, "PV's name"},
+    {"state",           Py_ca_state,            METH_O, "State of the CA channel connection"},
     {"host_name",       Py_ca_host_name,        METH_VARARGS, "Host to which the channel is connected"},
     {"read_access",     Py_ca_read_access,      METH_VARARGS, "PV's readability"},
     {"write_access",    Py_ca_write_access,     METH_VARARGS, "PV's writability"},
     {"version",         Py_ca_version,          METH_VARARGS, "CA version string"},
+    {"build_info",      Py_ca_build_info,       METH_VARARGS, "Compiler, flags and versions the extension was built with"},
+    {"stats",           Py_ca_stats,            METH_VARARGS, "Statistics of a channel or a context"},
+    {"enable_latency_stats", (PyCFunction)Py_ca_enable_latency_stats, METH_VARARGS | METH_KEYWORDS, "Enable callback latency histograms"},
+    {"latency_stats",   (PyCFunction)Py_ca_latency_stats, METH_VARARGS | METH_KEYWORDS, "Callback latency percentiles of a channel or a context"},
+    {"connect_report",  (PyCFunction)Py_ca_connect_report, METH_VARARGS | METH_KEYWORDS, "Connection timing of the channels"},
+    {"enable_memory_debug", (PyCFunction)Py_ca_enable_memory_debug, METH_VARARGS | METH_KEYWORDS, "Record the allocation sites of outstanding objects"},
+    {"memory_stats",    (PyCFunction)Py_ca_memory_stats, METH_VARARGS | METH_KEYWORDS, "Memory held by DBR buffers and callbacks"},
+    {"trace_start",     Py_ca_trace_start,      METH_VARARGS, "Start recording a timeline of CA operations"},
+    {"trace_stop",      Py_ca_trace_stop,       METH_VARARGS, "Stop recording the timeline"},
+    {"trace_dump",      Py_ca_trace_dump,       METH_VARARGS, "Write the timeline as Chrome trace JSON"},
+    {"recorder_open",   (PyCFunction)Py_ca_recorder_open, METH_VARARGS | METH_KEYWORDS, "Open a recorder of monitor updates"},
+    {"recorder_close",  Py_ca_recorder_close,   METH_VARARGS, "Seal the segment of a recorder and close it"},
+    {"recorder_stats",  Py_ca_recorder_stats,   METH_VARARGS, "Statistics of a recorder"},
+    {"replay",          (PyCFunction)Py_ca_replay, METH_VARARGS | METH_KEYWORDS, "Replay recorded monitor updates through callbacks"},
+    {"shm_create",      (PyCFunction)Py_ca_shm_create, METH_VARARGS | METH_KEYWORDS, "Create a shared memory to publish monitor updates"},
+    {"shm_attach",      Py_ca_shm_attach,       METH_VARARGS, "Attach to a published shared memory"},
+    {"shm_close",       Py_ca_shm_close,        METH_VARARGS, "Detach from or remove a shared memory"},
+    {"shm_channels",    Py_ca_shm_channels,     METH_VARARGS, "Channel names published in a shared memory"},
+    {"shm_read",        (PyCFunction)Py_ca_shm_read, METH_VARARGS | METH_KEYWORDS, "Read the latest updates from a shared memory"},
+    {"shm_stats",       Py_ca_shm_stats,        METH_VARARGS, "Statistics of a shared memory"},
+    {"sampler_create",  (PyCFunction)Py_ca_sampler_create, METH_VARARGS | METH_KEYWORDS, "Create a sampler of monitor updates"},
+    {"sampler_close",   Py_ca_sampler_close,    METH_VARARGS, "Stop a sampler"},
+    {"sampler_sample",  (PyCFunction)Py_ca_sampler_sample, METH_VARARGS | METH_KEYWORDS, "Take a sample of the latest updates"},
+    {"sampler_data",    (PyCFunction)Py_ca_sampler_data, METH_VARARGS | METH_KEYWORDS, "The samples taken as columns"},
+    {"completion_create", Py_ca_completion_create, METH_NOARGS, "Create a completion for get and put requests"},
+    {"completion_wait", (PyCFunction)Py_ca_completion_wait, METH_VARARGS | METH_KEYWORDS, "Wait for the requests of a completion"},
+    {"completion_pending", Py_ca_completion_pending, METH_VARARGS, "Number of requests of a completion not yet completed"},
     /* Execution */
     {"pend",        Py_ca_pend,         METH_VARARGS, "call pend_io if early is True otherwise pend_event is called"},
     {"flush_io",    Py_ca_flush_io,     METH_VARARGS, "flush IO requests"},
     {"pend_io",     Py_ca_pend_io,      METH_VARARGS, "wait pending connection and get"},
+#ifdef CA_FASTCALL
+    {"pend_event",  (PyCFunction)Py_ca_pend_event, METH_FASTCALL, "process background activities"},
+#else
     {"pend_event",  Py_ca_pend_event,   METH_VARARGS, "process background activities"},
-    {"poll",        Py_ca_poll,         METH_VARARGS, "process background activities for 1e-12s"},
+#endif
+    {"poll",        Py_ca_poll,         METH_NOARGS, "process background activities for 1e-12s"},
     {"test_io",     Py_ca_test_io,      METH_VARARGS, "check pending connection and get"},
     {"sg_create",   Py_ca_sg_create,    METH_VARARGS, "Create a synchronous group"},
     {"sg_delete",   Py_ca_sg_delete,    METH_VARARGS, "Delete a synchronous group"},
@@ -395,6 +784,9 @@ static PyMethodDef CA_Methods[] = {
     {"dbr_type_is_CHAR",    Py_dbr_type_is_CHAR,    METH_VARARGS, "dbr_type_is_CHAR"},
     {"dbr_type_is_LONG",    Py_dbr_type_is_LONG,    METH_VARARGS, "dbr_type_is_LONG"},
     {"dbr_type_is_DOUBLE",  Py_dbr_type_is_DOUBLE,  METH_VARARGS, "dbr_type_is_DOUBLE"},
+    /* Benchmark */
+    {"_bench_decode",   (PyCFunction)Py_ca_bench_decode,    METH_VARARGS | METH_KEYWORDS, "Decode synthetic DBR buffers"},
+    {"_bench_encode",   (PyCFunction)Py_ca_bench_encode,    METH_VARARGS | METH_KEYWORDS, "Encode values into DBR buffers"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -428,6 +820,514 @@ unsigned long PyObjectToULong(PyObject *o)
     return PyLong_AsUnsignedLong(PyNumber_Long(o));
 }
 
+/********************************************
+ *          Constants and enums             *
+ ********************************************/
+/*
+    The module constants and the IntEnum classes are defined by static tables. The classes are created
+    with the functional API of IntEnum, and their methods are the module functions bound with partialmethod.
+*/
+struct IntConstant {
+    const char *name;
+    long value;
+};
+
+struct EnumMethod {
+    const char *name;
+    const char *function;   /* module function called with the enum value */
+};
+
+struct EnumDef {
+    const char *name;
+    const IntConstant *members;
+    const EnumMethod *methods;
+    const char *doc;
+};
+
+#define INT_CONSTANT(c) {#c, c}
+
+static const IntConstant MODULE_CONSTANTS[] = {
+    INT_CONSTANT(TYPENOTCONN),
+    INT_CONSTANT(DBF_STRING),
+    INT_CONSTANT(DBF_SHORT),
+    INT_CONSTANT(DBF_INT),
+    INT_CONSTANT(DBF_FLOAT),
+    INT_CONSTANT(DBF_ENUM),
+    INT_CONSTANT(DBF_CHAR),
+    INT_CONSTANT(DBF_LONG),
+    INT_CONSTANT(DBF_DOUBLE),
+    INT_CONSTANT(DBR_STRING),
+    INT_CONSTANT(DBR_SHORT),
+    INT_CONSTANT(DBR_INT),
+    INT_CONSTANT(DBR_FLOAT),
+    INT_CONSTANT(DBR_ENUM),
+    INT_CONSTANT(DBR_CHAR),
+    INT_CONSTANT(DBR_LONG),
+    INT_CONSTANT(DBR_DOUBLE),
+    INT_CONSTANT(DBR_STS_STRING),
+    INT_CONSTANT(DBR_STS_SHORT),
+    INT_CONSTANT(DBR_STS_INT),
+    INT_CONSTANT(DBR_STS_FLOAT),
+    INT_CONSTANT(DBR_STS_ENUM),
+    INT_CONSTANT(DBR_STS_CHAR),
+    INT_CONSTANT(DBR_STS_LONG),
+    INT_CONSTANT(DBR_STS_DOUBLE),
+    INT_CONSTANT(DBR_TIME_STRING),
+    INT_CONSTANT(DBR_TIME_SHORT),
+    INT_CONSTANT(DBR_TIME_INT),
+    INT_CONSTANT(DBR_TIME_FLOAT),
+    INT_CONSTANT(DBR_TIME_ENUM),
+    INT_CONSTANT(DBR_TIME_CHAR),
+    INT_CONSTANT(DBR_TIME_LONG),
+    INT_CONSTANT(DBR_TIME_DOUBLE),
+    INT_CONSTANT(DBR_GR_STRING),
+    INT_CONSTANT(DBR_GR_SHORT),
+    INT_CONSTANT(DBR_GR_INT),
+    INT_CONSTANT(DBR_GR_FLOAT),
+    INT_CONSTANT(DBR_GR_ENUM),
+    INT_CONSTANT(DBR_GR_CHAR),
+    INT_CONSTANT(DBR_GR_LONG),
+    INT_CONSTANT(DBR_GR_DOUBLE),
+    INT_CONSTANT(DBR_CTRL_STRING),
+    INT_CONSTANT(DBR_CTRL_SHORT),
+    INT_CONSTANT(DBR_CTRL_INT),
+    INT_CONSTANT(DBR_CTRL_FLOAT),
+    INT_CONSTANT(DBR_CTRL_ENUM),
+    INT_CONSTANT(DBR_CTRL_CHAR),
+    INT_CONSTANT(DBR_CTRL_LONG),
+    INT_CONSTANT(DBR_CTRL_DOUBLE),
+    INT_CONSTANT(DBR_PUT_ACKT),
+    INT_CONSTANT(DBR_PUT_ACKS),
+    INT_CONSTANT(DBR_STSACK_STRING),
+    INT_CONSTANT(DBR_CLASS_NAME),
+    INT_CONSTANT(LAST_BUFFER_TYPE),
+    INT_CONSTANT(ECA_NORMAL),
+    INT_CONSTANT(ECA_MAXIOC),
+    INT_CONSTANT(ECA_UKNHOST),
+    INT_CONSTANT(ECA_UKNSERV),
+    INT_CONSTANT(ECA_SOCK),
+    INT_CONSTANT(ECA_CONN),
+    INT_CONSTANT(ECA_ALLOCMEM),
+    INT_CONSTANT(ECA_UKNCHAN),
+    INT_CONSTANT(ECA_UKNFIELD),
+    INT_CONSTANT(ECA_TOLARGE),
+    INT_CONSTANT(ECA_TIMEOUT),
+    INT_CONSTANT(ECA_NOSUPPORT),
+    INT_CONSTANT(ECA_STRTOBIG),
+    INT_CONSTANT(ECA_DISCONNCHID),
+    INT_CONSTANT(ECA_BADTYPE),
+    INT_CONSTANT(ECA_CHIDNOTFND),
+    INT_CONSTANT(ECA_CHIDRETRY),
+    INT_CONSTANT(ECA_INTERNAL),
+    INT_CONSTANT(ECA_DBLCLFAIL),
+    INT_CONSTANT(ECA_GETFAIL),
+    INT_CONSTANT(ECA_PUTFAIL),
+    INT_CONSTANT(ECA_ADDFAIL),
+    INT_CONSTANT(ECA_BADCOUNT),
+    INT_CONSTANT(ECA_BADSTR),
+    INT_CONSTANT(ECA_DISCONN),
+    INT_CONSTANT(ECA_DBLCHNL),
+    INT_CONSTANT(ECA_EVDISALLOW),
+    INT_CONSTANT(ECA_BUILDGET),
+    INT_CONSTANT(ECA_NEEDSFP),
+    INT_CONSTANT(ECA_OVEVFAIL),
+    INT_CONSTANT(ECA_BADMONID),
+    INT_CONSTANT(ECA_NEWADDR),
+    INT_CONSTANT(ECA_NEWCONN),
+    INT_CONSTANT(ECA_NOCACTX),
+    INT_CONSTANT(ECA_DEFUNCT),
+    INT_CONSTANT(ECA_EMPTYSTR),
+    INT_CONSTANT(ECA_NOREPEATER),
+    INT_CONSTANT(ECA_NOCHANMSG),
+    INT_CONSTANT(ECA_DLCKREST),
+    INT_CONSTANT(ECA_SERVBEHIND),
+    INT_CONSTANT(ECA_NOCAST),
+    INT_CONSTANT(ECA_BADMASK),
+    INT_CONSTANT(ECA_IODONE),
+    INT_CONSTANT(ECA_IOINPROGRESS),
+    INT_CONSTANT(ECA_BADSYNCGRP),
+    INT_CONSTANT(ECA_PUTCBINPROG),
+    INT_CONSTANT(ECA_NORDACCESS),
+    INT_CONSTANT(ECA_NOWTACCESS),
+    INT_CONSTANT(ECA_ANACHRONISM),
+    INT_CONSTANT(ECA_NOSEARCHADDR),
+    INT_CONSTANT(ECA_NOCONVERT),
+    INT_CONSTANT(ECA_BADCHID),
+    INT_CONSTANT(ECA_BADFUNCPTR),
+    INT_CONSTANT(ECA_ISATTACHED),
+    INT_CONSTANT(ECA_UNAVAILINSERV),
+    INT_CONSTANT(ECA_CHANDESTROY),
+    INT_CONSTANT(ECA_BADPRIORITY),
+    INT_CONSTANT(ECA_NOTTHREADED),
+    INT_CONSTANT(ECA_16KARRAYCLIENT),
+    INT_CONSTANT(ECA_CONNSEQTMO),
+    INT_CONSTANT(ECA_UNRESPTMO),
+    INT_CONSTANT(DBE_VALUE),
+    INT_CONSTANT(DBE_ARCHIVE),
+    INT_CONSTANT(DBE_LOG),
+    INT_CONSTANT(DBE_ALARM),
+    INT_CONSTANT(DBE_PROPERTY),
+    INT_CONSTANT(CA_OP_GET),
+    INT_CONSTANT(CA_OP_PUT),
+    INT_CONSTANT(CA_OP_CREATE_CHANNEL),
+    INT_CONSTANT(CA_OP_ADD_EVENT),
+    INT_CONSTANT(CA_OP_CLEAR_EVENT),
+    INT_CONSTANT(CA_OP_OTHER),
+    INT_CONSTANT(CA_OP_CONN_UP),
+    INT_CONSTANT(CA_OP_CONN_DOWN),
+    INT_CONSTANT(cs_never_conn),
+    INT_CONSTANT(cs_prev_conn),
+    INT_CONSTANT(cs_conn),
+    INT_CONSTANT(cs_closed),
+    {"cs_never_search", 4},
+    INT_CONSTANT(NO_ALARM),
+    INT_CONSTANT(MINOR_ALARM),
+    INT_CONSTANT(MAJOR_ALARM),
+    INT_CONSTANT(INVALID_ALARM),
+    INT_CONSTANT(READ_ALARM),
+    INT_CONSTANT(WRITE_ALARM),
+    INT_CONSTANT(HIHI_ALARM),
+    INT_CONSTANT(HIGH_ALARM),
+    INT_CONSTANT(LOLO_ALARM),
+    INT_CONSTANT(LOW_ALARM),
+    INT_CONSTANT(STATE_ALARM),
+    INT_CONSTANT(COS_ALARM),
+    INT_CONSTANT(COMM_ALARM),
+    INT_CONSTANT(TIMEOUT_ALARM),
+    INT_CONSTANT(HW_LIMIT_ALARM),
+    INT_CONSTANT(CALC_ALARM),
+    INT_CONSTANT(SCAN_ALARM),
+    INT_CONSTANT(LINK_ALARM),
+    INT_CONSTANT(SOFT_ALARM),
+    INT_CONSTANT(BAD_SUB_ALARM),
+    INT_CONSTANT(UDF_ALARM),
+    INT_CONSTANT(DISABLE_ALARM),
+    INT_CONSTANT(SIMM_ALARM),
+    INT_CONSTANT(READ_ACCESS_ALARM),
+    INT_CONSTANT(WRITE_ACCESS_ALARM),
+    INT_CONSTANT(POSIX_TIME_AT_EPICS_EPOCH),
+    INT_CONSTANT(CA_PRIORITY_MAX),
+    INT_CONSTANT(CA_PRIORITY_MIN),
+    INT_CONSTANT(CA_PRIORITY_DEFAULT),
+    INT_CONSTANT(CA_PRIORITY_DB_LINKS),
+    INT_CONSTANT(CA_PRIORITY_ARCHIVE),
+    INT_CONSTANT(CA_PRIORITY_OPI),
+    {NULL, 0}
+};
+
+static const IntConstant DBF_MEMBERS[] = {
+    {"NOTCONN", TYPENOTCONN},
+    {"INVALID", TYPENOTCONN},
+    {"STRING",  DBF_STRING},
+    {"SHORT",   DBF_SHORT},
+    {"INT",     DBF_INT},
+    {"FLOAT",   DBF_FLOAT},
+    {"ENUM",    DBF_ENUM},
+    {"CHAR",    DBF_CHAR},
+    {"LONG",    DBF_LONG},
+    {"DOUBLE",  DBF_DOUBLE},
+    {NULL, 0}
+};
+
+static const EnumMethod DBF_METHODS[] = {
+    {"toSTS", "dbf_type_to_DBR_STS"},
+    {"toTIME", "dbf_type_to_DBR_TIME"},
+    {"toGR", "dbf_type_to_DBR_GR"},
+    {"toCTRL", "dbf_type_to_DBR_CTRL"},
+    {NULL, NULL}
+};
+
+static const IntConstant DBR_MEMBERS[] = {
+    {"INVALID",          TYPENOTCONN},
+    {"STRING",           DBR_STRING},
+    {"SHORT",            DBR_SHORT},
+    {"INT",              DBR_INT},
+    {"FLOAT",            DBR_FLOAT},
+    {"ENUM",             DBR_ENUM},
+    {"CHAR",             DBR_CHAR},
+    {"LONG",             DBR_LONG},
+    {"DOUBLE",           DBR_DOUBLE},
+    {"STS_STRING",       DBR_STS_STRING},
+    {"STS_SHORT",        DBR_STS_SHORT},
+    {"STS_INT",          DBR_STS_INT},
+    {"STS_FLOAT",        DBR_STS_FLOAT},
+    {"STS_ENUM",         DBR_STS_ENUM},
+    {"STS_CHAR",         DBR_STS_CHAR},
+    {"STS_LONG",         DBR_STS_LONG},
+    {"STS_DOUBLE",       DBR_STS_DOUBLE},
+    {"TIME_STRING",      DBR_TIME_STRING},
+    {"TIME_SHORT",       DBR_TIME_SHORT},
+    {"TIME_INT",         DBR_TIME_INT},
+    {"TIME_FLOAT",       DBR_TIME_FLOAT},
+    {"TIME_ENUM",        DBR_TIME_ENUM},
+    {"TIME_CHAR",        DBR_TIME_CHAR},
+    {"TIME_LONG",        DBR_TIME_LONG},
+    {"TIME_DOUBLE",      DBR_TIME_DOUBLE},
+    {"GR_STRING",        DBR_GR_STRING},
+    {"GR_SHORT",         DBR_GR_SHORT},
+    {"GR_INT",           DBR_GR_INT},
+    {"GR_FLOAT",         DBR_GR_FLOAT},
+    {"GR_ENUM",          DBR_GR_ENUM},
+    {"GR_CHAR",          DBR_GR_CHAR},
+    {"GR_LONG",          DBR_GR_LONG},
+    {"GR_DOUBLE",        DBR_GR_DOUBLE},
+    {"CTRL_STRING",      DBR_CTRL_STRING},
+    {"CTRL_SHORT",       DBR_CTRL_SHORT},
+    {"CTRL_INT",         DBR_CTRL_INT},
+    {"CTRL_FLOAT",       DBR_CTRL_FLOAT},
+    {"CTRL_ENUM",        DBR_CTRL_ENUM},
+    {"CTRL_CHAR",        DBR_CTRL_CHAR},
+    {"CTRL_LONG",        DBR_CTRL_LONG},
+    {"CTRL_DOUBLE",      DBR_CTRL_DOUBLE},
+    {"PUT_ACKT",         DBR_PUT_ACKT},
+    {"PUT_ACKS",         DBR_PUT_ACKS},
+    {"STSACK_STRING",    DBR_STSACK_STRING},
+    {"CLASS_NAME",       DBR_CLASS_NAME},
+    {"LAST_BUFFER_TYPE", LAST_BUFFER_TYPE},
+    {NULL, 0}
+};
+
+static const EnumMethod DBR_METHODS[] = {
+    {"isSTRING", "dbr_type_is_STRING"},
+    {"isSHORT", "dbr_type_is_SHORT"},
+    {"isFLOAT", "dbr_type_is_FLOAT"},
+    {"isENUM", "dbr_type_is_ENUM"},
+    {"isCHAR", "dbr_type_is_CHAR"},
+    {"isLONG", "dbr_type_is_LONG"},
+    {"isDOUBLE", "dbr_type_is_DOUBLE"},
+    {"isPlain", "dbr_type_is_plain"},
+    {"isSTS", "dbr_type_is_STS"},
+    {"isTIME", "dbr_type_is_TIME"},
+    {"isGR", "dbr_type_is_GR"},
+    {"isCTRL", "dbr_type_is_CTRL"},
+    {NULL, NULL}
+};
+
+static const IntConstant ECA_MEMBERS[] = {
+    {"NORMAL",         ECA_NORMAL},
+    {"MAXIOC",         ECA_MAXIOC},
+    {"UKNHOST",        ECA_UKNHOST},
+    {"UKNSERV",        ECA_UKNSERV},
+    {"SOCK",           ECA_SOCK},
+    {"CONN",           ECA_CONN},
+    {"ALLOCMEM",       ECA_ALLOCMEM},
+    {"UKNCHAN",        ECA_UKNCHAN},
+    {"UKNFIELD",       ECA_UKNFIELD},
+    {"TOLARGE",        ECA_TOLARGE},
+    {"TIMEOUT",        ECA_TIMEOUT},
+    {"NOSUPPORT",      ECA_NOSUPPORT},
+    {"STRTOBIG",       ECA_STRTOBIG},
+    {"DISCONNCHID",    ECA_DISCONNCHID},
+    {"BADTYPE",        ECA_BADTYPE},
+    {"CHIDNOTFND",     ECA_CHIDNOTFND},
+    {"CHIDRETRY",      ECA_CHIDRETRY},
+    {"INTERNAL",       ECA_INTERNAL},
+    {"DBLCLFAIL",      ECA_DBLCLFAIL},
+    {"GETFAIL",        ECA_GETFAIL},
+    {"PUTFAIL",        ECA_PUTFAIL},
+    {"ADDFAIL",        ECA_ADDFAIL},
+    {"BADCOUNT",       ECA_BADCOUNT},
+    {"BADSTR",         ECA_BADSTR},
+    {"DISCONN",        ECA_DISCONN},
+    {"DBLCHNL",        ECA_DBLCHNL},
+    {"EVDISALLOW",     ECA_EVDISALLOW},
+    {"BUILDGET",       ECA_BUILDGET},
+    {"NEEDSFP",        ECA_NEEDSFP},
+    {"OVEVFAIL",       ECA_OVEVFAIL},
+    {"BADMONID",       ECA_BADMONID},
+    {"NEWADDR",        ECA_NEWADDR},
+    {"NEWCONN",        ECA_NEWCONN},
+    {"NOCACTX",        ECA_NOCACTX},
+    {"DEFUNCT",        ECA_DEFUNCT},
+    {"EMPTYSTR",       ECA_EMPTYSTR},
+    {"NOREPEATER",     ECA_NOREPEATER},
+    {"NOCHANMSG",      ECA_NOCHANMSG},
+    {"DLCKREST",       ECA_DLCKREST},
+    {"SERVBEHIND",     ECA_SERVBEHIND},
+    {"NOCAST",         ECA_NOCAST},
+    {"BADMASK",        ECA_BADMASK},
+    {"IODONE",         ECA_IODONE},
+    {"IOINPROGRESS",   ECA_IOINPROGRESS},
+    {"BADSYNCGRP",     ECA_BADSYNCGRP},
+    {"PUTCBINPROG",    ECA_PUTCBINPROG},
+    {"NORDACCESS",     ECA_NORDACCESS},
+    {"NOWTACCESS",     ECA_NOWTACCESS},
+    {"ANACHRONISM",    ECA_ANACHRONISM},
+    {"NOSEARCHADDR",   ECA_NOSEARCHADDR},
+    {"NOCONVERT",      ECA_NOCONVERT},
+    {"BADCHID",        ECA_BADCHID},
+    {"BADFUNCPTR",     ECA_BADFUNCPTR},
+    {"ISATTACHED",     ECA_ISATTACHED},
+    {"UNAVAILINSERV",  ECA_UNAVAILINSERV},
+    {"CHANDESTROY",    ECA_CHANDESTROY},
+    {"BADPRIORITY",    ECA_BADPRIORITY},
+    {"NOTTHREADED",    ECA_NOTTHREADED},
+    {"ARRAY16KCLIENT", ECA_16KARRAYCLIENT},
+    {"CONNSEQTMO",     ECA_CONNSEQTMO},
+    {"UNRESPTMO",      ECA_UNRESPTMO},
+    {NULL, 0}
+};
+
+static const EnumMethod ECA_METHODS[] = {
+    {"message", "message"},
+    {NULL, NULL}
+};
+
+static const IntConstant DBE_MEMBERS[] = {
+    {"VALUE",    DBE_VALUE},
+    {"ARCHIVE",  DBE_ARCHIVE},
+    {"LOG",      DBE_LOG},
+    {"ALARM",    DBE_ALARM},
+    {"PROPERTY", DBE_PROPERTY},
+    {NULL, 0}
+};
+
+static const IntConstant CA_OP_MEMBERS[] = {
+    {"GET",            CA_OP_GET},
+    {"PUT",            CA_OP_PUT},
+    {"CREATE_CHANNEL", CA_OP_CREATE_CHANNEL},
+    {"ADD_EVENT",      CA_OP_ADD_EVENT},
+    {"CLEAR_EVENT",    CA_OP_CLEAR_EVENT},
+    {"OTHER",          CA_OP_OTHER},
+    {"CONN_UP",        CA_OP_CONN_UP},
+    {"CONN_DOWN",      CA_OP_CONN_DOWN},
+    {NULL, 0}
+};
+
+static const IntConstant CHANNEL_STATE_MEMBERS[] = {
+    {"NEVER_CONN",   cs_never_conn},
+    {"PREV_CONN",    cs_prev_conn},
+    {"CONN",         cs_conn},
+    {"CLOSED",       cs_closed},
+    {"NEVER_SEARCH", 4},
+    {NULL, 0}
+};
+
+static const IntConstant ALARM_SEVERITY_MEMBERS[] = {
+    {"No",      NO_ALARM},
+    {"Minor",   MINOR_ALARM},
+    {"Major",   MAJOR_ALARM},
+    {"Invalid", INVALID_ALARM},
+    {NULL, 0}
+};
+
+static const IntConstant ALARM_CONDITION_MEMBERS[] = {
+    {"No",          NO_ALARM},
+    {"Read",        READ_ALARM},
+    {"Write",       WRITE_ALARM},
+    {"HiHi",        HIHI_ALARM},
+    {"High",        HIGH_ALARM},
+    {"Lolo",        LOLO_ALARM},
+    {"Low",         LOW_ALARM},
+    {"State",       STATE_ALARM},
+    {"Cos",         COS_ALARM},
+    {"Comm",        COMM_ALARM},
+    {"Timeout",     TIMEOUT_ALARM},
+    {"HwLimit",     HW_LIMIT_ALARM},
+    {"Calc",        CALC_ALARM},
+    {"Scam",        SCAN_ALARM},
+    {"Link",        LINK_ALARM},
+    {"Soft",        SOFT_ALARM},
+    {"BadSub",      BAD_SUB_ALARM},
+    {"UDF",         UDF_ALARM},
+    {"Disable",     DISABLE_ALARM},
+    {"Simm",        SIMM_ALARM},
+    {"ReadAccess",  READ_ACCESS_ALARM},
+    {"WriteAccess", WRITE_ACCESS_ALARM},
+    {NULL, 0}
+};
+
+static const IntConstant CA_PRIORITY_MEMBERS[] = {
+    {"MAX",      CA_PRIORITY_MAX},
+    {"MIN",      CA_PRIORITY_MIN},
+    {"DEFAULT",  CA_PRIORITY_DEFAULT},
+    {"DB_LINKS", CA_PRIORITY_DB_LINKS},
+    {"ARCHIVE",  CA_PRIORITY_ARCHIVE},
+    {"OPI",      CA_PRIORITY_OPI},
+    {NULL, 0}
+};
+
+static const EnumDef ENUMS[] = {
+    {"DBF", DBF_MEMBERS, DBF_METHODS, NULL},
+    {"DBR", DBR_MEMBERS, DBR_METHODS, NULL},
+    {"ECA", ECA_MEMBERS, ECA_METHODS, NULL},
+    {"DBE", DBE_MEMBERS, NULL, NULL},
+    {"CA_OP", CA_OP_MEMBERS, NULL, NULL},
+    {"ChannelState", CHANNEL_STATE_MEMBERS, NULL, NULL},
+    {"AlarmSeverity", ALARM_SEVERITY_MEMBERS, NULL, NULL},
+    {"AlarmCondition", ALARM_CONDITION_MEMBERS, NULL, NULL},
+    {"CA_PRIORITY", CA_PRIORITY_MEMBERS, NULL, "Enum redefined from CA_PRIORITY_XXX macros."},
+    {NULL, NULL, NULL, NULL}
+};
+
+/* Create the enum classes. Without the enum module, they are missing and IntToIntEnum returns integers. */
+static void add_IntEnums(PyObject *pModule, const EnumDef *pDefs)
+{
+    PyObject *pEnumModule = PyImport_ImportModule("enum");
+    PyObject *pIntEnum = pEnumModule ? PyObject_GetAttrString(pEnumModule, "IntEnum") : NULL;
+    Py_XDECREF(pEnumModule);
+    if (pIntEnum == NULL) {
+        PyErr_Clear();
+        return;
+    }
+#if PY_MAJOR_VERSION >= 3
+    PyObject *pFunctools = PyImport_ImportModule("functools");
+    PyObject *pPartialMethod = pFunctools ? PyObject_GetAttrString(pFunctools, "partialmethod") : NULL;
+    Py_XDECREF(pFunctools);
+    PyErr_Clear();
+#endif
+    PyObject *pModuleName = PyObject_GetAttrString(pModule, "__name__");
+
+    for (const EnumDef *pDef = pDefs; pDef->name != NULL; pDef++) {
+        PyObject *pMembers = PyList_New(0);
+        for (const IntConstant *pMember = pDef->members; pMember->name != NULL; pMember++) {
+            PyObject *pItem = Py_BuildValue("(sl)", pMember->name, pMember->value);
+            PyList_Append(pMembers, pItem);
+            Py_XDECREF(pItem);
+        }
+        PyObject *pArgs = Py_BuildValue("(sN)", pDef->name, pMembers);
+        PyObject *pKws = Py_BuildValue("{s:O}", "module", pModuleName);
+        PyObject *pEnum = PyObject_Call(pIntEnum, pArgs, pKws);
+        Py_XDECREF(pArgs);
+        Py_XDECREF(pKws);
+        if (pEnum == NULL) {
+            PyErr_Clear();
+            continue;
+        }
+
+        for (const EnumMethod *pMethod = pDef->methods; pMethod != NULL && pMethod->name != NULL; pMethod++) {
+            PyObject *pFunction = PyObject_GetAttrString(pModule, pMethod->function);
+            PyObject *pBound = NULL;
+#if PY_MAJOR_VERSION >= 3
+            if (pFunction != NULL && pPartialMethod != NULL)
+                pBound = PyObject_CallFunctionObjArgs(pPartialMethod, pFunction, NULL);
+#else
+            if (pFunction != NULL)
+                pBound = PyMethod_New(pFunction, NULL, pEnum);
+#endif
+            if (pBound == NULL || PyObject_SetAttrString(pEnum, pMethod->name, pBound) != 0)
+                PyErr_Clear();
+            Py_XDECREF(pBound);
+            Py_XDECREF(pFunction);
+        }
+
+        if (pDef->doc != NULL) {
+            PyObject *pDoc = PyString_FromString(pDef->doc);
+            if (pDoc == NULL || PyObject_SetAttrString(pEnum, "__doc__", pDoc) != 0)
+                PyErr_Clear();
+            Py_XDECREF(pDoc);
+        }
+
+        PyModule_AddObject(pModule, pDef->name, pEnum);
+    }
+
+    Py_XDECREF(pModuleName);
+#if PY_MAJOR_VERSION >= 3
+    Py_XDECREF(pPartialMethod);
+#endif
+    Py_DECREF(pIntEnum);
+}
+
 /* entry point for Python module initializer */
 
 MOD_INIT(_ca) {
@@ -439,6 +1339,10 @@ MOD_INIT(_ca) {
     }
     #endif
 
+    #if EPICS_VERSION_INT < VERSION_INT(3,15,0,0)
+    ATOMIC_LOCK = epicsMutexMustCreate();
+    #endif
+
     #if PY_MAJOR_VERSION >= 3
     pModule=PyModule_Create(&CA_Module);
     #else
@@ -459,436 +1363,10 @@ MOD_INIT(_ca) {
     }
     PyModule_AddIntConstant(pModule, "HAS_NUMPY", HAS_NUMPY);
 
-    PyModule_AddIntMacro(pModule, TYPENOTCONN);
-    PyModule_AddIntMacro(pModule, DBF_STRING);
-    PyModule_AddIntMacro(pModule, DBF_SHORT);
-    PyModule_AddIntMacro(pModule, DBF_INT);
-    PyModule_AddIntMacro(pModule, DBF_FLOAT);
-    PyModule_AddIntMacro(pModule, DBF_ENUM);
-    PyModule_AddIntMacro(pModule, DBF_CHAR);
-    PyModule_AddIntMacro(pModule, DBF_LONG);
-    PyModule_AddIntMacro(pModule, DBF_DOUBLE);
-
-    add_IntEnum(pModule,
-    "from enum import IntEnum\n"
-    "class DBF(IntEnum):\n"
-    "    NOTCONN= TYPENOTCONN\n"
-    "    INVALID= TYPENOTCONN\n"
-    "    STRING = DBF_STRING\n"
-    "    SHORT  = DBF_SHORT\n"
-    "    INT    = DBF_INT\n"
-    "    FLOAT  = DBF_FLOAT\n"
-    "    ENUM   = DBF_ENUM\n"
-    "    CHAR   = DBF_CHAR\n"
-    "    LONG   = DBF_LONG\n"
-    "    DOUBLE = DBF_DOUBLE\n"
-    "\n"
-    "    def toSTS(self):\n"
-    "        return dbf_type_to_DBR_STS(self.value)\n"
-    "    def toTIME(self):\n"
-    "        return dbf_type_to_DBR_TIME(self.value)\n"
-    "    def toGR(self):\n"
-    "        return dbf_type_to_DBR_GR(self.value)\n"
-    "    def toCTRL(self):\n"
-    "        return dbf_type_to_DBR_CTRL(self.value)\n"
-    );
+    for (const IntConstant *pConstant = MODULE_CONSTANTS; pConstant->name != NULL; pConstant++)
+        PyModule_AddIntConstant(pModule, pConstant->name, pConstant->value);
 
-    PyModule_AddIntMacro(pModule, DBR_STRING);
-    PyModule_AddIntMacro(pModule, DBR_SHORT);
-    PyModule_AddIntMacro(pModule, DBR_INT);
-    PyModule_AddIntMacro(pModule, DBR_FLOAT);
-    PyModule_AddIntMacro(pModule, DBR_ENUM);
-    PyModule_AddIntMacro(pModule, DBR_CHAR);
-    PyModule_AddIntMacro(pModule, DBR_LONG);
-    PyModule_AddIntMacro(pModule, DBR_DOUBLE);
-
-    PyModule_AddIntMacro(pModule, DBR_STS_STRING);
-    PyModule_AddIntMacro(pModule, DBR_STS_SHORT);
-    PyModule_AddIntMacro(pModule, DBR_STS_INT);
-    PyModule_AddIntMacro(pModule, DBR_STS_FLOAT);
-    PyModule_AddIntMacro(pModule, DBR_STS_ENUM);
-    PyModule_AddIntMacro(pModule, DBR_STS_CHAR);
-    PyModule_AddIntMacro(pModule, DBR_STS_LONG);
-    PyModule_AddIntMacro(pModule, DBR_STS_DOUBLE);
-
-    PyModule_AddIntMacro(pModule, DBR_TIME_STRING);
-    PyModule_AddIntMacro(pModule, DBR_TIME_SHORT);
-    PyModule_AddIntMacro(pModule, DBR_TIME_INT);
-    PyModule_AddIntMacro(pModule, DBR_TIME_FLOAT);
-    PyModule_AddIntMacro(pModule, DBR_TIME_ENUM);
-    PyModule_AddIntMacro(pModule, DBR_TIME_CHAR);
-    PyModule_AddIntMacro(pModule, DBR_TIME_LONG);
-    PyModule_AddIntMacro(pModule, DBR_TIME_DOUBLE);
-
-    PyModule_AddIntMacro(pModule, DBR_GR_STRING);
-    PyModule_AddIntMacro(pModule, DBR_GR_SHORT);
-    PyModule_AddIntMacro(pModule, DBR_GR_INT);
-    PyModule_AddIntMacro(pModule, DBR_GR_FLOAT);
-    PyModule_AddIntMacro(pModule, DBR_GR_ENUM);
-    PyModule_AddIntMacro(pModule, DBR_GR_CHAR);
-    PyModule_AddIntMacro(pModule, DBR_GR_LONG);
-    PyModule_AddIntMacro(pModule, DBR_GR_DOUBLE);
-
-    PyModule_AddIntMacro(pModule, DBR_CTRL_STRING);
-    PyModule_AddIntMacro(pModule, DBR_CTRL_SHORT);
-    PyModule_AddIntMacro(pModule, DBR_CTRL_INT);
-    PyModule_AddIntMacro(pModule, DBR_CTRL_FLOAT);
-    PyModule_AddIntMacro(pModule, DBR_CTRL_ENUM);
-    PyModule_AddIntMacro(pModule, DBR_CTRL_CHAR);
-    PyModule_AddIntMacro(pModule, DBR_CTRL_LONG);
-    PyModule_AddIntMacro(pModule, DBR_CTRL_DOUBLE);
-
-    PyModule_AddIntMacro(pModule, DBR_PUT_ACKT);
-    PyModule_AddIntMacro(pModule, DBR_PUT_ACKS);
-    PyModule_AddIntMacro(pModule, DBR_STSACK_STRING);
-    PyModule_AddIntMacro(pModule, DBR_CLASS_NAME);
-    PyModule_AddIntMacro(pModule, LAST_BUFFER_TYPE);
-
-    add_IntEnum(pModule,
-    "from enum import IntEnum\n"
-    "class DBR(IntEnum):\n"
-    "    INVALID= TYPENOTCONN\n"
-    "\n"
-    "    STRING = DBR_STRING\n"
-    "    SHORT  = DBR_SHORT\n"
-    "    INT    = DBR_INT\n"
-    "    FLOAT  = DBR_FLOAT\n"
-    "    ENUM   = DBR_ENUM\n"
-    "    CHAR   = DBR_CHAR\n"
-    "    LONG   = DBR_LONG\n"
-    "    DOUBLE = DBR_DOUBLE\n"
-    "\n"
-    "    STS_STRING = DBR_STS_STRING\n"
-    "    STS_SHORT  = DBR_STS_SHORT\n"
-    "    STS_INT    = DBR_STS_INT\n"
-    "    STS_FLOAT  = DBR_STS_FLOAT\n"
-    "    STS_ENUM   = DBR_STS_ENUM\n"
-    "    STS_CHAR   = DBR_STS_CHAR\n"
-    "    STS_LONG   = DBR_STS_LONG\n"
-    "    STS_DOUBLE = DBR_STS_DOUBLE\n"
-    "\n"
-    "    TIME_STRING = DBR_TIME_STRING\n"
-    "    TIME_SHORT  = DBR_TIME_SHORT\n"
-    "    TIME_INT    = DBR_TIME_INT\n"
-    "    TIME_FLOAT  = DBR_TIME_FLOAT\n"
-    "    TIME_ENUM   = DBR_TIME_ENUM\n"
-    "    TIME_CHAR   = DBR_TIME_CHAR\n"
-    "    TIME_LONG   = DBR_TIME_LONG\n"
-    "    TIME_DOUBLE = DBR_TIME_DOUBLE\n"
-    "\n"
-    "    GR_STRING = DBR_GR_STRING\n"
-    "    GR_SHORT  = DBR_GR_SHORT\n"
-    "    GR_INT    = DBR_GR_INT\n"
-    "    GR_FLOAT  = DBR_GR_FLOAT\n"
-    "    GR_ENUM   = DBR_GR_ENUM\n"
-    "    GR_CHAR   = DBR_GR_CHAR\n"
-    "    GR_LONG   = DBR_GR_LONG\n"
-    "    GR_DOUBLE = DBR_GR_DOUBLE\n"
-    "\n"
-    "    CTRL_STRING = DBR_CTRL_STRING\n"
-    "    CTRL_SHORT  = DBR_CTRL_SHORT\n"
-    "    CTRL_INT    = DBR_CTRL_INT\n"
-    "    CTRL_FLOAT  = DBR_CTRL_FLOAT\n"
-    "    CTRL_ENUM   = DBR_CTRL_ENUM\n"
-    "    CTRL_CHAR   = DBR_CTRL_CHAR\n"
-    "    CTRL_LONG   = DBR_CTRL_LONG\n"
-    "    CTRL_DOUBLE = DBR_CTRL_DOUBLE\n"
-    "\n"
-    "    PUT_ACKT  = DBR_PUT_ACKT\n"
-    "    PUT_ACKS  = DBR_PUT_ACKS\n"
-    "    STSACK_STRING = DBR_STSACK_STRING\n"
-    "    CLASS_NAME = DBR_CLASS_NAME\n"
-    "    LAST_BUFFER_TYPE = LAST_BUFFER_TYPE\n"
-    "\n"
-    "    def isSTRING(self):\n"
-    "        return dbr_type_is_STRING(self.value)\n"
-    "    def isSHORT(self):\n"
-    "        return dbr_type_is_SHORT(self.value)\n"
-    "    def isFLOAT(self):\n"
-    "        return dbr_type_is_FLOAT(self.value)\n"
-    "    def isENUM(self):\n"
-    "        return dbr_type_is_ENUM(self.value)\n"
-    "    def isCHAR(self):\n"
-    "        return dbr_type_is_CHAR(self.value)\n"
-    "    def isLONG(self):\n"
-    "        return dbr_type_is_LONG(self.value)\n"
-    "    def isDOUBLE(self):\n"
-    "        return dbr_type_is_DOUBLE(self.value)\n"
-    "    def isPlain(self):\n"
-    "        return dbr_type_is_plain(self.value)\n"
-    "    def isSTS(self):\n"
-    "        return dbr_type_is_STS(self.value)\n"
-    "    def isTIME(self):\n"
-    "        return dbr_type_is_TIME(self.value)\n"
-    "    def isGR(self):\n"
-    "        return dbr_type_is_GR(self.value)\n"
-    "    def isCTRL(self):\n"
-    "        return dbr_type_is_CTRL(self.value)");
-
-    PyModule_AddIntMacro(pModule, ECA_NORMAL);
-    PyModule_AddIntMacro(pModule, ECA_MAXIOC);        
-    PyModule_AddIntMacro(pModule, ECA_UKNHOST);     
-    PyModule_AddIntMacro(pModule, ECA_UKNSERV);       
-    PyModule_AddIntMacro(pModule, ECA_SOCK);          
-    PyModule_AddIntMacro(pModule, ECA_CONN);          
-    PyModule_AddIntMacro(pModule, ECA_ALLOCMEM);      
-    PyModule_AddIntMacro(pModule, ECA_UKNCHAN);       
-    PyModule_AddIntMacro(pModule, ECA_UKNFIELD);
-    PyModule_AddIntMacro(pModule, ECA_TOLARGE);
-    PyModule_AddIntMacro(pModule, ECA_TIMEOUT);
-    PyModule_AddIntMacro(pModule, ECA_NOSUPPORT);
-    PyModule_AddIntMacro(pModule, ECA_STRTOBIG);
-    PyModule_AddIntMacro(pModule, ECA_DISCONNCHID);
-    PyModule_AddIntMacro(pModule, ECA_BADTYPE);
-    PyModule_AddIntMacro(pModule, ECA_CHIDNOTFND);
-    PyModule_AddIntMacro(pModule, ECA_CHIDRETRY);
-    PyModule_AddIntMacro(pModule, ECA_INTERNAL);
-    PyModule_AddIntMacro(pModule, ECA_DBLCLFAIL);
-    PyModule_AddIntMacro(pModule, ECA_GETFAIL);
-    PyModule_AddIntMacro(pModule, ECA_PUTFAIL);
-    PyModule_AddIntMacro(pModule, ECA_ADDFAIL);
-    PyModule_AddIntMacro(pModule, ECA_BADCOUNT);
-    PyModule_AddIntMacro(pModule, ECA_BADSTR);
-    PyModule_AddIntMacro(pModule, ECA_DISCONN);
-    PyModule_AddIntMacro(pModule, ECA_DBLCHNL);
-    PyModule_AddIntMacro(pModule, ECA_EVDISALLOW);
-    PyModule_AddIntMacro(pModule, ECA_BUILDGET);
-    PyModule_AddIntMacro(pModule, ECA_NEEDSFP);
-    PyModule_AddIntMacro(pModule, ECA_OVEVFAIL);
-    PyModule_AddIntMacro(pModule, ECA_BADMONID);
-    PyModule_AddIntMacro(pModule, ECA_NEWADDR);
-    PyModule_AddIntMacro(pModule, ECA_NEWCONN);
-    PyModule_AddIntMacro(pModule, ECA_NOCACTX);
-    PyModule_AddIntMacro(pModule, ECA_DEFUNCT);
-    PyModule_AddIntMacro(pModule, ECA_EMPTYSTR);
-    PyModule_AddIntMacro(pModule, ECA_NOREPEATER);
-    PyModule_AddIntMacro(pModule, ECA_NOCHANMSG);
-    PyModule_AddIntMacro(pModule, ECA_DLCKREST);
-    PyModule_AddIntMacro(pModule, ECA_SERVBEHIND);
-    PyModule_AddIntMacro(pModule, ECA_NOCAST);
-    PyModule_AddIntMacro(pModule, ECA_BADMASK);
-    PyModule_AddIntMacro(pModule, ECA_IODONE);
-    PyModule_AddIntMacro(pModule, ECA_IOINPROGRESS);
-    PyModule_AddIntMacro(pModule, ECA_BADSYNCGRP);
-    PyModule_AddIntMacro(pModule, ECA_PUTCBINPROG);
-    PyModule_AddIntMacro(pModule, ECA_NORDACCESS);
-    PyModule_AddIntMacro(pModule, ECA_NOWTACCESS);
-    PyModule_AddIntMacro(pModule, ECA_ANACHRONISM);
-    PyModule_AddIntMacro(pModule, ECA_NOSEARCHADDR);
-    PyModule_AddIntMacro(pModule, ECA_NOCONVERT);
-    PyModule_AddIntMacro(pModule, ECA_BADCHID);
-    PyModule_AddIntMacro(pModule, ECA_BADFUNCPTR);
-    PyModule_AddIntMacro(pModule, ECA_ISATTACHED);
-    PyModule_AddIntMacro(pModule, ECA_UNAVAILINSERV);
-    PyModule_AddIntMacro(pModule, ECA_CHANDESTROY);
-    PyModule_AddIntMacro(pModule, ECA_BADPRIORITY);
-    PyModule_AddIntMacro(pModule, ECA_NOTTHREADED);
-    PyModule_AddIntMacro(pModule, ECA_16KARRAYCLIENT);
-    PyModule_AddIntMacro(pModule, ECA_CONNSEQTMO);
-    PyModule_AddIntMacro(pModule, ECA_UNRESPTMO);
-
-    add_IntEnum(pModule,
-    "from enum import IntEnum\n"
-    "class ECA(IntEnum):\n"
-    "    NORMAL          = ECA_NORMAL\n"
-    "    MAXIOC          = ECA_MAXIOC\n"
-    "    UKNHOST         = ECA_UKNHOST\n"
-    "    UKNSERV         = ECA_UKNSERV\n"
-    "    SOCK            = ECA_SOCK\n"
-    "    CONN            = ECA_CONN\n"
-    "    ALLOCMEM        = ECA_ALLOCMEM\n"
-    "    UKNCHAN         = ECA_UKNCHAN\n"
-    "    UKNFIELD        = ECA_UKNFIELD\n"
-    "    TOLARGE         = ECA_TOLARGE\n"
-    "    TIMEOUT         = ECA_TIMEOUT\n"
-    "    NOSUPPORT       = ECA_NOSUPPORT\n"
-    "    STRTOBIG        = ECA_STRTOBIG\n"
-    "    DISCONNCHID     = ECA_DISCONNCHID\n"
-    "    BADTYPE         = ECA_BADTYPE\n"
-    "    CHIDNOTFND      = ECA_CHIDNOTFND\n"
-    "    CHIDRETRY       = ECA_CHIDRETRY\n"
-    "    INTERNAL        = ECA_INTERNAL\n"
-    "    DBLCLFAIL       = ECA_DBLCLFAIL\n"
-    "    GETFAIL         = ECA_GETFAIL\n"
-    "    PUTFAIL         = ECA_PUTFAIL\n"
-    "    ADDFAIL         = ECA_ADDFAIL\n"
-    "    BADCOUNT        = ECA_BADCOUNT\n"
-    "    BADSTR          = ECA_BADSTR\n"
-    "    DISCONN         = ECA_DISCONN\n"
-    "    DBLCHNL         = ECA_DBLCHNL\n"
-    "    EVDISALLOW      = ECA_EVDISALLOW\n"
-    "    BUILDGET        = ECA_BUILDGET\n"
-    "    NEEDSFP         = ECA_NEEDSFP\n"
-    "    OVEVFAIL        = ECA_OVEVFAIL\n"
-    "    BADMONID        = ECA_BADMONID\n"
-    "    NEWADDR         = ECA_NEWADDR\n"
-    "    NEWCONN         = ECA_NEWCONN\n"
-    "    NOCACTX         = ECA_NOCACTX\n"
-    "    DEFUNCT         = ECA_DEFUNCT\n"
-    "    EMPTYSTR        = ECA_EMPTYSTR\n"
-    "    NOREPEATER      = ECA_NOREPEATER\n"
-    "    NOCHANMSG       = ECA_NOCHANMSG\n"
-    "    DLCKREST        = ECA_DLCKREST\n"
-    "    SERVBEHIND      = ECA_SERVBEHIND\n"
-    "    NOCAST          = ECA_NOCAST\n"
-    "    BADMASK         = ECA_BADMASK\n"
-    "    IODONE          = ECA_IODONE\n"
-    "    IOINPROGRESS    = ECA_IOINPROGRESS\n"
-    "    BADSYNCGRP      = ECA_BADSYNCGRP\n"
-    "    PUTCBINPROG     = ECA_PUTCBINPROG\n"
-    "    NORDACCESS      = ECA_NORDACCESS\n"
-    "    NOWTACCESS      = ECA_NOWTACCESS\n"
-    "    ANACHRONISM     = ECA_ANACHRONISM\n"
-    "    NOSEARCHADDR    = ECA_NOSEARCHADDR\n"
-    "    NOCONVERT       = ECA_NOCONVERT\n"
-    "    BADCHID         = ECA_BADCHID\n"
-    "    BADFUNCPTR      = ECA_BADFUNCPTR\n"
-    "    ISATTACHED      = ECA_ISATTACHED\n"
-    "    UNAVAILINSERV   = ECA_UNAVAILINSERV\n"
-    "    CHANDESTROY     = ECA_CHANDESTROY\n"
-    "    BADPRIORITY     = ECA_BADPRIORITY\n"
-    "    NOTTHREADED     = ECA_NOTTHREADED\n"
-    "    # 16KARRAYCLIEN is an invalid variable name\n"
-    "    ARRAY16KCLIENT  = ECA_16KARRAYCLIENT\n"
-    "    CONNSEQTMO      = ECA_CONNSEQTMO\n"
-    "    UNRESPTMO       = ECA_UNRESPTMO\n"
-    "\n"
-    "    def message(self):\n"
-    "        return globals()['message'](self.value)\n");
-
-    PyModule_AddIntMacro(pModule, DBE_VALUE);
-    PyModule_AddIntMacro(pModule, DBE_ARCHIVE);
-    PyModule_AddIntMacro(pModule, DBE_LOG);
-    PyModule_AddIntMacro(pModule, DBE_ALARM);
-    PyModule_AddIntMacro(pModule, DBE_PROPERTY);
-
-    add_IntEnum(pModule,
-    "from enum import IntEnum\n"
-    "class DBE(IntEnum):\n"
-    "    VALUE    = DBE_VALUE\n"
-    "    ARCHIVE  = DBE_ARCHIVE\n"
-    "    LOG      = DBE_LOG\n"
-    "    ALARM    = DBE_ALARM\n"
-    "    PROPERTY = DBE_PROPERTY");
-
-    PyModule_AddIntMacro(pModule, CA_OP_GET);
-    PyModule_AddIntMacro(pModule, CA_OP_PUT);
-    PyModule_AddIntMacro(pModule, CA_OP_CREATE_CHANNEL);
-    PyModule_AddIntMacro(pModule, CA_OP_ADD_EVENT);
-    PyModule_AddIntMacro(pModule, CA_OP_CLEAR_EVENT);
-    PyModule_AddIntMacro(pModule, CA_OP_OTHER);
-    PyModule_AddIntMacro(pModule, CA_OP_CONN_UP);
-    PyModule_AddIntMacro(pModule, CA_OP_CONN_DOWN);
-
-    add_IntEnum(pModule,
-    "from enum import IntEnum\n"
-    "class CA_OP(IntEnum):\n"
-    "    GET            = CA_OP_GET\n"
-    "    PUT            = CA_OP_PUT\n"
-    "    CREATE_CHANNEL = CA_OP_CREATE_CHANNEL\n"
-    "    ADD_EVENT      = CA_OP_ADD_EVENT\n"
-    "    CLEAR_EVENT    = CA_OP_CLEAR_EVENT\n"
-    "    OTHER          = CA_OP_OTHER\n"
-    "    CONN_UP        = CA_OP_CONN_UP\n"
-    "    CONN_DOWN      = CA_OP_CONN_DOWN");
-
-    PyModule_AddIntMacro(pModule, cs_never_conn);
-    PyModule_AddIntMacro(pModule, cs_prev_conn);
-    PyModule_AddIntMacro(pModule, cs_conn);
-    PyModule_AddIntMacro(pModule, cs_closed);
-    PyModule_AddIntConstant(pModule, "cs_never_search", 4);
-
-    add_IntEnum(pModule,
-    "from enum import IntEnum\n"
-    "class ChannelState(IntEnum):\n"
-    "    NEVER_CONN   = cs_never_conn\n"
-    "    PREV_CONN    = cs_prev_conn\n"
-    "    CONN         = cs_conn\n"
-    "    CLOSED       = cs_closed\n"
-    "    NEVER_SEARCH = 4");
-
-    PyModule_AddIntMacro(pModule, NO_ALARM);
-    PyModule_AddIntMacro(pModule, MINOR_ALARM);
-    PyModule_AddIntMacro(pModule, MAJOR_ALARM);
-    PyModule_AddIntMacro(pModule, INVALID_ALARM);
-
-    add_IntEnum(pModule,
-    "from enum import IntEnum\n"
-    "class AlarmSeverity(IntEnum):\n"
-    "    No      = NO_ALARM\n"
-    "    Minor   = MINOR_ALARM\n"
-    "    Major   = MAJOR_ALARM\n"
-    "    Invalid = INVALID_ALARM\n");
-
-    PyModule_AddIntMacro(pModule, READ_ALARM);
-    PyModule_AddIntMacro(pModule, WRITE_ALARM);
-    PyModule_AddIntMacro(pModule, HIHI_ALARM);
-    PyModule_AddIntMacro(pModule, HIGH_ALARM);
-    PyModule_AddIntMacro(pModule, LOLO_ALARM);
-    PyModule_AddIntMacro(pModule, LOW_ALARM);
-    PyModule_AddIntMacro(pModule, STATE_ALARM);
-    PyModule_AddIntMacro(pModule, COS_ALARM);
-    PyModule_AddIntMacro(pModule, COMM_ALARM);
-    PyModule_AddIntMacro(pModule, TIMEOUT_ALARM);
-    PyModule_AddIntMacro(pModule, HW_LIMIT_ALARM);
-    PyModule_AddIntMacro(pModule, CALC_ALARM);
-    PyModule_AddIntMacro(pModule, SCAN_ALARM);
-    PyModule_AddIntMacro(pModule, LINK_ALARM);
-    PyModule_AddIntMacro(pModule, SOFT_ALARM);
-    PyModule_AddIntMacro(pModule, BAD_SUB_ALARM);
-    PyModule_AddIntMacro(pModule, UDF_ALARM);
-    PyModule_AddIntMacro(pModule, DISABLE_ALARM);
-    PyModule_AddIntMacro(pModule, SIMM_ALARM);
-    PyModule_AddIntMacro(pModule, READ_ACCESS_ALARM);
-    PyModule_AddIntMacro(pModule, WRITE_ACCESS_ALARM);
-
-    add_IntEnum(pModule,
-    "from enum import IntEnum\n"
-    "class AlarmCondition(IntEnum):\n"
-    "    No          = NO_ALARM\n"
-    "    Read        = READ_ALARM\n"
-    "    Write       = WRITE_ALARM\n"
-    "    HiHi        = HIHI_ALARM\n"
-    "    High        = HIGH_ALARM\n"
-    "    Lolo        = LOLO_ALARM\n"
-    "    Low         = LOW_ALARM\n"
-    "    State       = STATE_ALARM\n"
-    "    Cos         = COS_ALARM\n"
-    "    Comm        = COMM_ALARM\n"
-    "    Timeout     = TIMEOUT_ALARM\n"
-    "    HwLimit     = HW_LIMIT_ALARM\n"
-    "    Calc        = CALC_ALARM\n"
-    "    Scam        = SCAN_ALARM\n"
-    "    Link        = LINK_ALARM\n"
-    "    Soft        = SOFT_ALARM\n"
-    "    BadSub      = BAD_SUB_ALARM\n"
-    "    UDF         = UDF_ALARM\n"
-    "    Disable     = DISABLE_ALARM\n"
-    "    Simm        = SIMM_ALARM\n"
-    "    ReadAccess  = READ_ACCESS_ALARM\n"
-    "    WriteAccess = WRITE_ACCESS_ALARM\n");
-
-    PyModule_AddIntMacro(pModule, POSIX_TIME_AT_EPICS_EPOCH);
-
-    PyModule_AddIntMacro(pModule, CA_PRIORITY_MAX);
-    PyModule_AddIntMacro(pModule, CA_PRIORITY_MIN);
-    PyModule_AddIntMacro(pModule, CA_PRIORITY_DEFAULT);
-    PyModule_AddIntMacro(pModule, CA_PRIORITY_DB_LINKS);
-    PyModule_AddIntMacro(pModule, CA_PRIORITY_ARCHIVE);
-    PyModule_AddIntMacro(pModule, CA_PRIORITY_OPI);
-
-    add_IntEnum(pModule,
-    "from enum import IntEnum\n"
-    "class CA_PRIORITY(IntEnum):\n"
-    "    \"\"\"\n"
-    "    Enum redefined from CA_PRIORITY_XXX macros.\n"
-    "    \"\"\"\n"
-    "    MAX     = CA_PRIORITY_MAX\n"
-    "    MIN     = CA_PRIORITY_MIN\n"
-    "    DEFAULT = CA_PRIORITY_DEFAULT\n"
-    "    DB_LINKS= CA_PRIORITY_DB_LINKS\n"
-    "    ARCHIVE = CA_PRIORITY_ARCHIVE\n"
-    "    OPI     = CA_PRIORITY_OPI");
+    add_IntEnums(pModule, ENUMS);
 
     MODULE = pModule;
     #if PY_MAJOR_VERSION >= 3
@@ -917,6 +1395,112 @@ static PyObject *IntToIntEnum(const char *type, long value)
     return pValue;
 }
 
+/*******************************************************
+ *                      Handles                        *
+ *******************************************************/
+
+/*
+    Recorders, shared memories and samplers are passed to Python as capsules of a Handle, which holds
+    the reference of the user. Closing the handle closes the object and gives up that reference, the
+    subscriptions still writing to it keep their own. A capsule dropped without being closed is closed
+    by its destructor, and a closed handle is rejected by the other functions.
+*/
+struct HandleType {
+    const char *name;               /* of the capsule */
+    const char *description;        /* in error messages */
+    void (*close)(void *ptr);       /* close and release the reference of the user, called with the GIL held */
+};
+
+struct Handle {
+    const HandleType *type;
+    void *ptr;
+    bool closed;
+};
+
+static const HandleType RECORDER_HANDLE = {"recorder", "recorder", recorder_close};
+static const HandleType SHM_HANDLE = {"shm", "shared memory", shm_close};
+static const HandleType SAMPLER_HANDLE = {"sampler", "sampler", sampler_close};
+
+static void handle_close(Handle *pHandle)
+{
+    if (!pHandle->closed) {
+        pHandle->closed = true;
+        pHandle->type->close(pHandle->ptr);
+    }
+}
+
+static void Handle_free(Handle *pHandle)
+{
+    handle_close(pHandle);
+    delete pHandle;
+}
+
+#if PY_MAJOR_VERSION >= 3
+static void Handle_destructor(PyObject *pCapsule)
+{
+    Handle_free((Handle *) PyCapsule_GetPointer(pCapsule, PyCapsule_GetName(pCapsule)));
+}
+#else
+static void Handle_destructor(void *ptr)
+{
+    Handle_free((Handle *) ptr);
+}
+#endif
+
+/* the capsule of a new object, which is closed if the capsule cannot be built */
+static PyObject *handle_new(const HandleType *pType, void *ptr)
+{
+    Handle *pHandle = new Handle();
+    pHandle->type = pType;
+    pHandle->ptr = ptr;
+    pHandle->closed = false;
+
+    PyObject *pCapsule = CAPSULE_BUILD(pHandle, pType->name, Handle_destructor);
+    if (pCapsule == NULL)
+        Handle_free(pHandle);
+    return pCapsule;
+}
+
+/* the open handle of a capsule, or NULL with an exception set */
+static Handle *handle_from_capsule(PyObject *pObject, const HandleType *pType)
+{
+    Handle *pHandle = (Handle *) CAPSULE_EXTRACT(pObject, pType->name);
+    if (pHandle == NULL)
+        return NULL;
+    if (pHandle->type != pType) {
+        PyErr_Format(PyExc_TypeError, "expect a %s", pType->description);
+        return NULL;
+    }
+    if (pHandle->closed) {
+        PyErr_Format(PyExc_ValueError, "%s is closed", pType->description);
+        return NULL;
+    }
+    return pHandle;
+}
+
+/* the object of an open handle, or NULL with an exception set */
+template<typename T>
+static T *handle_object(PyObject *pObject, const HandleType *pType)
+{
+    Handle *pHandle = handle_from_capsule(pObject, pType);
+    return pHandle == NULL ? NULL : (T *) pHandle->ptr;
+}
+
+/* close the handle of a capsule */
+static PyObject *handle_close_capsule(PyObject *args, const HandleType *pType)
+{
+    PyObject *pObject;
+    if(!PyArg_ParseTuple(args, "O", &pObject))
+        return NULL;
+
+    Handle *pHandle = handle_from_capsule(pObject, pType);
+    if (pHandle == NULL)
+        return NULL;
+    handle_close(pHandle);
+
+    Py_RETURN_NONE;
+}
+
 /*******************************************************
  *                    CA Context                       *
  *******************************************************/
@@ -946,11 +1530,14 @@ static PyObject *Py_ca_destroy_context(PyObject *self, PyObject *args)
     ca_context_destroy();
     Py_END_ALLOW_THREADS
 
-    /* remove it from the cache map associtaed with exception callback */
+    /* remove it from the cache map associtaed with exception callback,
+       its buffered exception records still queued find no callback by their generation */
     std::map<struct ca_client_context *, struct context_callback>::iterator it = CONTEXTS.find(pContext);
     if (it != CONTEXTS.end()) {
         Py_XDECREF(it->second.pExceptionCallback);
         Py_XDECREF(it->second.pPrintfHandler);
+        connect_forget_context(it->second.pStats);
+        ContextStats_release(it->second.pStats);
         CONTEXTS.erase(it);
     }
 
@@ -998,21 +1585,74 @@ static PyObject *Py_ca_current_context(PyObject *self, PyObject *args)
         return CAPSULE_BUILD(pContext, "ca_client_context", NULL);
 }
 
-static PyObject *Py_ca_show_context(PyObject *self, PyObject *args, PyObject *kws)
+/* False if the calling thread is not attached to a context */
+static PyObject *Py_ca_preemptive_callback_is_enabled(PyObject *self, PyObject *args)
 {
-    PyObject *pObject = Py_None;
-    int level = 0;
+    if (ca_preemtive_callback_is_enabled())
+        Py_RETURN_TRUE;
+    else
+        Py_RETURN_FALSE;
+}
 
-    const char *kwlist[] = {"context", "level",  NULL};
+/*
+    Attach the calling thread to the given context, or to a new preemptive context if None is given,
+    unless the thread is already attached.
 
-    if (!PyArg_ParseTupleAndKeywords(args, kws, "|Oi", (char **)kwlist, &pObject, &level))
+    libca keeps the attached context in a thread private variable. Reading it is cheap and does not block,
+    so the check is done without releasing the GIL. Only when the thread is not attached yet,
+    ca_attach_context or ca_context_create is called. The returned object is the context the caller should pass
+    on subsequent calls, i.e. the same object if it was given.
+*/
+static PyObject *Py_ca_ensure_attached(PyObject *self, PyObject *args)
+{
+    PyObject *pObject = Py_None;
+    if(!PyArg_ParseTuple(args, "|O", &pObject))
         return NULL;
 
+    struct ca_client_context *pCurrent = ca_current_context();
+
     if (pObject == Py_None) {
+        if (pCurrent == NULL) {
+            Py_BEGIN_ALLOW_THREADS
+            ca_context_create(ca_enable_preemptive_callback);
+            pCurrent = ca_current_context();
+            Py_END_ALLOW_THREADS
+        }
+        if (pCurrent == NULL)
+            Py_RETURN_NONE;
+        return CAPSULE_BUILD(pCurrent, "ca_client_context", NULL);
+    }
+
+    struct ca_client_context *pContext = (ca_client_context *) CAPSULE_EXTRACT(pObject, "ca_client_context");
+    if (pContext == NULL)
+        return NULL;
+
+    /* a thread attached to another context stays with it, as ca_attach_context would refuse */
+    if (pCurrent == NULL) {
         Py_BEGIN_ALLOW_THREADS
-        ca_client_status(level);
+        ca_attach_context(pContext);
         Py_END_ALLOW_THREADS
-    } else {
+    }
+
+    Py_INCREF(pObject);
+    return pObject;
+}
+
+static PyObject *Py_ca_show_context(PyObject *self, PyObject *args, PyObject *kws)
+{
+    PyObject *pObject = Py_None;
+    int level = 0;
+
+    const char *kwlist[] = {"context", "level",  NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kws, "|Oi", (char **)kwlist, &pObject, &level))
+        return NULL;
+
+    if (pObject == Py_None) {
+        Py_BEGIN_ALLOW_THREADS
+        ca_client_status(level);
+        Py_END_ALLOW_THREADS
+    } else {
         struct ca_client_context *pContext = (struct ca_client_context *)CAPSULE_EXTRACT(pObject, "ca_client_context");
         if (pContext == NULL)
             return NULL;
@@ -1030,40 +1670,606 @@ static PyObject *Py_ca_show_context(PyObject *self, PyObject *args, PyObject *kw
  *                    CA Channel                       *
  *******************************************************/
 
+/*******************************************************
+ *                    Statistics                       *
+ *******************************************************/
+
+/*
+    Counters are updated on the CA threads with atomic operations and read by ca.stats without locking.
+    The counters of a context are shared by reference between the context and the ChannelData
+    objects created in it, so that they outlive whichever is destroyed first.
+*/
+struct LatencyStats;
+struct LatencyHistogram;
+
+struct ChannelStats {
+    size_t updates;         /* values received by get and monitor callbacks */
+    size_t bytes;           /* DBR bytes received */
+    size_t callbacks;       /* Python callbacks invoked */
+    size_t errors;          /* Python callbacks raised an exception */
+    size_t connects;
+    size_t disconnects;
+    size_t last_update;     /* EPICS epoch seconds and nanoseconds of the last update */
+    size_t last_update_nsec;
+};
+
+struct ContextStats {
+    size_t refcount;
+    size_t channels;
+    size_t subscriptions;
+    size_t outstanding_gets;
+    size_t outstanding_puts;
+    size_t allocations;     /* ChannelData objects created */
+    size_t live_allocations;/* ChannelData objects alive */
+    ChannelStats totals;    /* sum of the channel counters */
+    LatencyStats *pLatency; /* callback latencies, allocated when first recorded */
+    LatencyHistogram *pConnect; /* time to first connection, allocated when first recorded */
+};
+
+static ContextStats *ContextStats_get(struct ca_client_context *pContext)
+{
+    if (pContext == NULL)
+        return NULL;
+    ContextStats *pStats = CONTEXTS[pContext].pStats;
+    if (pStats == NULL) {
+        pStats = new ContextStats();
+        memset(pStats, 0, sizeof(ContextStats));
+        pStats->refcount = 1;
+        CONTEXTS[pContext].pStats = pStats;
+    }
+    return pStats;
+}
+
+static void LatencyStats_delete(LatencyStats *pLatency);
+static void LatencyHistogram_delete(LatencyHistogram *pHistogram);
+
+static void ContextStats_release(ContextStats *pStats)
+{
+    if (pStats != NULL && epicsAtomicDecrSizeT(&pStats->refcount) == 0) {
+        LatencyStats_delete(pStats->pLatency);
+        LatencyHistogram_delete(pStats->pConnect);
+        delete pStats;
+    }
+}
+
+static inline void stats_incr(size_t *pCounter)
+{
+    epicsAtomicIncrSizeT(pCounter);
+}
+
+static inline void stats_decr(size_t *pCounter)
+{
+    epicsAtomicDecrSizeT(pCounter);
+}
+
+/*
+    Log-linear histograms in the manner of HdrHistogram. Latencies below LATENCY_SUB_COUNT ns
+    have a bucket each; above, every power of two is split into LATENCY_SUB_COUNT buckets,
+    which bounds the relative error of a percentile to 1/LATENCY_SUB_COUNT.
+
+    The callbacks take three time stamps: on entry, once the GIL is acquired and after the Python
+    callback returned. They are recorded into the histograms of the context and, optionally, of the channel.
+    Recording is disabled by default, which costs a flag test per callback.
+*/
+#define LATENCY_SUB_BITS    4
+#define LATENCY_SUB_COUNT   (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_BITS    40      /* about 18 minutes, longer latencies are clamped */
+#define LATENCY_BUCKETS     ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) * LATENCY_SUB_COUNT)
+
+enum LatencyMode { LATENCY_OFF, LATENCY_CONTEXT, LATENCY_CHANNEL };
+enum LatencyKind { LATENCY_GIL_WAIT, LATENCY_CALLBACK, LATENCY_TOTAL, LATENCY_KINDS };
+static const char *LATENCY_KIND_NAMES[LATENCY_KINDS] = {"gil_wait", "callback", "total"};
+
+static int LATENCY_MODE = LATENCY_OFF;
+
+struct LatencyHistogram {
+    size_t count;
+    size_t max;     /* ns, saturated at SIZE_MAX */
+    size_t buckets[LATENCY_BUCKETS];
+};
+
+struct LatencyStats {
+    LatencyHistogram histograms[LATENCY_KINDS];
+};
+
+static LatencyStats *LatencyStats_new()
+{
+    LatencyStats *pLatency = new LatencyStats();
+    memset(pLatency, 0, sizeof(LatencyStats));
+    memory_track(pLatency, MEMORY_HISTOGRAM, sizeof(LatencyStats));
+    return pLatency;
+}
+
+static void LatencyStats_delete(LatencyStats *pLatency)
+{
+    if (pLatency != NULL)
+        memory_untrack(pLatency, MEMORY_HISTOGRAM, sizeof(LatencyStats));
+    delete pLatency;
+}
+
+static LatencyHistogram *LatencyHistogram_new()
+{
+    LatencyHistogram *pHistogram = new LatencyHistogram();
+    memset(pHistogram, 0, sizeof(LatencyHistogram));
+    memory_track(pHistogram, MEMORY_HISTOGRAM, sizeof(LatencyHistogram));
+    return pHistogram;
+}
+
+static void LatencyHistogram_delete(LatencyHistogram *pHistogram)
+{
+    if (pHistogram != NULL)
+        memory_untrack(pHistogram, MEMORY_HISTOGRAM, sizeof(LatencyHistogram));
+    delete pHistogram;
+}
+
+static unsigned latency_bucket(epicsUInt64 value)
+{
+    if (value < LATENCY_SUB_COUNT)
+        return (unsigned) value;
+    unsigned msb = 0;
+    for (unsigned step = 32; step > 0; step >>= 1) {
+        if (value >> (msb + step))
+            msb += step;
+    }
+    if (msb >= LATENCY_MAX_BITS)
+        return LATENCY_BUCKETS - 1;
+    unsigned shift = msb - LATENCY_SUB_BITS;
+    return (shift + 1) * LATENCY_SUB_COUNT + (unsigned)(value >> shift) - LATENCY_SUB_COUNT;
+}
+
+/* the lowest value of a bucket, and the width of it */
+static epicsUInt64 latency_bucket_value(unsigned bucket, epicsUInt64 *pWidth)
+{
+    if (bucket < LATENCY_SUB_COUNT) {
+        *pWidth = 1;
+        return bucket;
+    }
+    unsigned shift = bucket / LATENCY_SUB_COUNT - 1;
+    *pWidth = (epicsUInt64)1 << shift;
+    return (epicsUInt64)(bucket % LATENCY_SUB_COUNT + LATENCY_SUB_COUNT) << shift;
+}
+
+static void latency_record(LatencyHistogram *pHistogram, epicsUInt64 value)
+{
+    size_t clamped = value > (epicsUInt64)(size_t)-1 ? (size_t)-1 : (size_t)value;
+    size_t max = epicsAtomicGetSizeT(&pHistogram->max);
+    while (clamped > max) {
+        size_t previous = epicsAtomicCmpAndSwapSizeT(&pHistogram->max, max, clamped);
+        if (previous == max)
+            break;
+        max = previous;
+    }
+    stats_incr(&pHistogram->buckets[latency_bucket(value)]);
+    stats_incr(&pHistogram->count);
+}
+
+static void latency_record_all(LatencyStats *pLatency, const epicsUInt64 *values)
+{
+    for (int kind = 0; kind < LATENCY_KINDS; kind++)
+        latency_record(&pLatency->histograms[kind], values[kind]);
+}
+
+/*
+    Timeline tracing, written out in the Chrome trace event format.
+
+    Every thread records into its own ring of TRACE_BUFFER_SIZE events, so the writers need no lock
+    and the most recent events are kept. A buffer is created on the first event of a thread and
+    linked into a list, which is the only step taken under a lock. trace_start begins a new epoch,
+    upon which the buffers of the previous one are reset by their own writers.
+*/
+#define TRACE_BUFFER_SIZE   16384
+#define TRACE_PV_SIZE       48
+
+struct TraceEvent {
+    epicsUInt64 ts;         /* monotonic ns */
+    epicsUInt64 dur;
+    const void *id;         /* of async events */
+    const char *name;       /* static string */
+    char phase;
+    char pv[TRACE_PV_SIZE];
+};
+
+struct TraceBuffer {
+    size_t epoch;
+    size_t head;            /* number of events written, the ring index is head % TRACE_BUFFER_SIZE */
+    size_t tid;
+    char thread_name[32];
+    TraceBuffer *next;
+    TraceEvent events[TRACE_BUFFER_SIZE];
+};
+
+static struct {
+    int enabled;
+    size_t epoch;
+    size_t threads;
+    epicsUInt64 origin;
+    epicsThreadPrivateId key;
+    epicsMutexId lock;
+    TraceBuffer *buffers;
+} TRACE = {0, 0, 0, 0, NULL, NULL, NULL};
+
+static inline epicsUInt64 trace_now()
+{
+    return TRACE.enabled ? monotonic_ns() : 0;
+}
+
+static TraceBuffer *trace_buffer()
+{
+    TraceBuffer *pBuffer = (TraceBuffer *) epicsThreadPrivateGet(TRACE.key);
+    if (pBuffer == NULL) {
+        pBuffer = (TraceBuffer *) calloc(1, sizeof(TraceBuffer));
+        if (pBuffer == NULL)
+            return NULL;
+        epicsThreadGetName(epicsThreadGetIdSelf(), pBuffer->thread_name, sizeof(pBuffer->thread_name));
+        epicsMutexMustLock(TRACE.lock);
+        pBuffer->tid = ++TRACE.threads;
+        pBuffer->epoch = TRACE.epoch;
+        pBuffer->next = TRACE.buffers;
+        TRACE.buffers = pBuffer;
+        epicsMutexUnlock(TRACE.lock);
+        epicsThreadPrivateSet(TRACE.key, pBuffer);
+    }
+    size_t epoch = epicsAtomicGetSizeT(&TRACE.epoch);
+    if (pBuffer->epoch != epoch) {
+        epicsAtomicSetSizeT(&pBuffer->head, 0);
+        pBuffer->epoch = epoch;
+    }
+    return pBuffer;
+}
+
+static void trace_record(char phase, const char *name, epicsUInt64 ts, epicsUInt64 dur,
+                         const void *id, const char *pv)
+{
+    if (!TRACE.enabled || ts == 0)
+        return;
+    TraceBuffer *pBuffer = trace_buffer();
+    if (pBuffer == NULL)
+        return;
+    size_t head = pBuffer->head;
+    TraceEvent *pEvent = &pBuffer->events[head % TRACE_BUFFER_SIZE];
+    pEvent->ts = ts;
+    pEvent->dur = dur;
+    pEvent->id = id;
+    pEvent->name = name;
+    pEvent->phase = phase;
+    pEvent->pv[0] = '\0';
+    if (pv != NULL) {
+        strncpy(pEvent->pv, pv, TRACE_PV_SIZE - 1);
+        pEvent->pv[TRACE_PV_SIZE - 1] = '\0';
+    }
+    epicsAtomicSetSizeT(&pBuffer->head, head + 1);
+}
+
+/* a complete event from start to end */
+static inline void trace_complete(const char *name, epicsUInt64 start, epicsUInt64 end, const char *pv)
+{
+    if (start != 0)
+        trace_record('X', name, start, end > start ? end - start : 0, NULL, pv);
+}
+
+static inline void trace_instant(const char *name, const char *pv)
+{
+    if (TRACE.enabled)
+        trace_record('i', name, monotonic_ns(), 0, NULL, pv);
+}
+
+/* begin ('b') or end ('e') of an asynchronous operation identified by id */
+static inline void trace_async(char phase, const char *name, const void *id, const char *pv)
+{
+    if (TRACE.enabled)
+        trace_record(phase, name, monotonic_ns(), 0, id, pv);
+}
+
+/*
+    Span of a CA call made with the GIL released, followed by the span to acquire the GIL again.
+
+        TraceSpan span("pend_io");
+        Py_BEGIN_ALLOW_THREADS
+        status = ca_pend_io(timeout);
+        span.returned();
+        Py_END_ALLOW_THREADS
+        span.end();
+*/
+struct TraceSpan {
+    const char *name;
+    const char *pv;
+    epicsUInt64 start;
+    epicsUInt64 stop;
+
+    TraceSpan(const char *name, const char *pv=NULL) : name(name), pv(pv), start(trace_now()), stop(0) {}
+    void returned() {
+        if (start != 0)
+            stop = monotonic_ns();
+    }
+    void end() {
+        if (start == 0)
+            return;
+        epicsUInt64 now = monotonic_ns();
+        if (stop == 0)
+            stop = now;
+        trace_complete(name, start, stop, pv);
+        trace_complete("gil", stop, now, pv);
+    }
+};
+
+/*
+    Time stamps of one callback invocation, taken if latency statistics or tracing are enabled.
+    The histograms are allocated on first use, so done must be called with the GIL held.
+*/
+struct LatencyProbe {
+    const char *name;
+    epicsUInt64 entry;
+    epicsUInt64 acquired;
+
+    LatencyProbe(const char *name) : name(name), entry(0), acquired(0) {
+        if (LATENCY_MODE != LATENCY_OFF || TRACE.enabled)
+            entry = monotonic_ns();
+    }
+    void gil_acquired() {
+        if (entry != 0)
+            acquired = monotonic_ns();
+    }
+    void done(chanId chid, ContextStats *pContextStats);
+};
+
+/*
+    Connection timing of a channel in monotonic ns, accessed with the GIL held.
+*/
+struct ConnectTiming {
+    chanId chid;
+    epicsUInt64 created;            /* ca_create_channel called */
+    epicsUInt64 connected;          /* first connection, 0 if never connected */
+    epicsUInt64 disconnected;       /* start of the current disconnection, 0 if connected */
+    epicsUInt64 disconnected_total; /* time disconnected after the first connection */
+    size_t reconnects;
+};
+
 /*
     Class to store user supplied callback function and argument objects.
     It is used in operations ca_create_channel, ca_get_callback, ca_put_callback and ca_create_subscription
 */
 class ChannelData {
 public:
-    ChannelData(PyObject *pCallback) : pAccessEventCallback(NULL), use_numpy(false) {
+    ChannelData(PyObject *pCallback, int kind=MEMORY_CHANNEL) : pAccessEventCallback(NULL), use_numpy(false), format(0),
+                pContextStats(NULL), pLatency(NULL), kind(kind), pRecorder(NULL), recorder_channel(0),
+                pShm(NULL), shm_slot(0), pSampler(NULL), sampler_channel(0),
+                pCompletion(NULL), pUserArgs(NULL) {
+        if (pCallback != NULL && is_callback_pair(pCallback)) {
+            pUserArgs = PyTuple_GetItem(pCallback, 1);
+            Py_INCREF(pUserArgs);
+            pCallback = PyTuple_GetItem(pCallback, 0);
+        }
         this->pCallback = pCallback;
         Py_XINCREF(pCallback);
+        memset(&stats, 0, sizeof(stats));
+        memset(&timing, 0, sizeof(timing));
+        memory_track(this, kind, sizeof(ChannelData));
     }
     ~ChannelData() {
+        memory_untrack(this, kind, sizeof(ChannelData));
         Py_XDECREF(pCallback);
+        Py_XDECREF(pUserArgs);
         Py_XDECREF(pAccessEventCallback);
+        LatencyStats_delete(pLatency);
+        Recorder_release(pRecorder);
+        SharedMemory_release(pShm);
+        Sampler_release(pSampler);
+        Completion_release(pCompletion);
+        if (pContextStats != NULL) {
+            stats_decr(&pContextStats->live_allocations);
+            ContextStats_release(pContextStats);
+        }
+    }
+
+    /* account this object to the context counters */
+    void set_context_stats(ContextStats *pStats) {
+        if (pStats == NULL)
+            return;
+        stats_incr(&pStats->refcount);
+        stats_incr(&pStats->allocations);
+        stats_incr(&pStats->live_allocations);
+        pContextStats = pStats;
     }
 
     PyObject *pCallback;
     evid eventID;
     PyObject *pAccessEventCallback;
     bool use_numpy;
+    int format;     /* format flags of the value */
+    ContextStats *pContextStats;
+    /* used by the channel object only */
+    ChannelStats stats;
+    LatencyStats *pLatency;
+    ConnectTiming timing;
+    int kind;       /* MemoryKind of the operation */
+    /* used by the subscription object only */
+    Recorder *pRecorder;
+    epicsUInt32 recorder_channel;
+    SharedMemory *pShm;
+    epicsUInt32 shm_slot;
+    Sampler *pSampler;
+    size_t sampler_channel;
+    /* used by the get/put callback objects only */
+    Completion *pCompletion;
+    /* user arguments of a (callable, user_args) callback of get, put and subscription */
+    PyObject *pUserArgs;
 };
 
+void LatencyProbe::done(chanId chid, ContextStats *pContextStats)
+{
+    if (entry == 0)
+        return;
+    epicsUInt64 now = monotonic_ns();
+
+    if (TRACE.enabled) {
+        const char *pv = ca_name(chid);
+        trace_complete("gil", entry, acquired, pv);
+        trace_complete(name, acquired, now, pv);
+    }
+    if (LATENCY_MODE == LATENCY_OFF)
+        return;
+
+    epicsUInt64 values[LATENCY_KINDS];
+    /* the time of day fallback of monotonic_ns may step backwards */
+    values[LATENCY_GIL_WAIT] = acquired > entry ? acquired - entry : 0;
+    values[LATENCY_CALLBACK] = now > acquired ? now - acquired : 0;
+    values[LATENCY_TOTAL] = now > entry ? now - entry : 0;
+
+    if (pContextStats != NULL) {
+        if (pContextStats->pLatency == NULL)
+            pContextStats->pLatency = LatencyStats_new();
+        latency_record_all(pContextStats->pLatency, values);
+    }
+    if (LATENCY_MODE == LATENCY_CHANNEL) {
+        ChannelData *pChannel = (ChannelData *) ca_puser(chid);
+        if (pChannel != NULL) {
+            if (pChannel->pLatency == NULL)
+                pChannel->pLatency = LatencyStats_new();
+            latency_record_all(pChannel->pLatency, values);
+        }
+    }
+}
+
+/* the context counters of the channel */
+static ContextStats *channel_context_stats(chanId chid)
+{
+    ChannelData *pChannel = (ChannelData *) ca_puser(chid);
+    if (pChannel == NULL)
+        return NULL;
+    return pChannel->pContextStats;
+}
+
+/* count a value received by a get or monitor callback */
+static void stats_count_update(const struct event_handler_args &args, ContextStats *pContextStats)
+{
+    if (args.status != ECA_NORMAL || args.dbr == NULL)
+        return;
+    size_t bytes = dbr_size_n(args.type, args.count);
+    ChannelData *pChannel = (ChannelData *) ca_puser(args.chid);
+    if (pChannel != NULL) {
+        epicsTimeStamp now;
+        epicsTimeGetCurrent(&now);
+        stats_incr(&pChannel->stats.updates);
+        epicsAtomicAddSizeT(&pChannel->stats.bytes, bytes);
+        epicsAtomicSetSizeT(&pChannel->stats.last_update, now.secPastEpoch);
+        epicsAtomicSetSizeT(&pChannel->stats.last_update_nsec, now.nsec);
+    }
+    if (pContextStats != NULL) {
+        stats_incr(&pContextStats->totals.updates);
+        epicsAtomicAddSizeT(&pContextStats->totals.bytes, bytes);
+    }
+}
+
+/* count a Python callback invoked and whether it failed */
+static void stats_count_callback(chanId chid, ContextStats *pContextStats, bool failed)
+{
+    ChannelData *pChannel = (ChannelData *) ca_puser(chid);
+    if (pChannel != NULL) {
+        stats_incr(&pChannel->stats.callbacks);
+        if (failed)
+            stats_incr(&pChannel->stats.errors);
+    }
+    if (pContextStats != NULL) {
+        stats_incr(&pContextStats->totals.callbacks);
+        if (failed)
+            stats_incr(&pContextStats->totals.errors);
+    }
+}
+
+/*
+    The channel objects by chid, and the channels without connection callback which have not connected yet.
+    CA does not notify the latter, so they are polled after the pend calls. Both are accessed with the GIL held.
+*/
+static std::map<chanId, ChannelData *> CHANNELS;
+static std::set<chanId> UNCONNECTED;
+
+static void connect_record_up(ChannelData *pData, epicsUInt64 now)
+{
+    ConnectTiming &timing = pData->timing;
+    if (timing.connected == 0) {
+        timing.connected = now;
+        UNCONNECTED.erase(timing.chid);
+        if (pData->pContextStats != NULL) {
+            if (pData->pContextStats->pConnect == NULL)
+                pData->pContextStats->pConnect = LatencyHistogram_new();
+            latency_record(pData->pContextStats->pConnect, now > timing.created ? now - timing.created : 0);
+        }
+    } else if (timing.disconnected != 0) {
+        timing.disconnected_total += now > timing.disconnected ? now - timing.disconnected : 0;
+        timing.disconnected = 0;
+        timing.reconnects++;
+    }
+}
+
+static void connect_record_down(ChannelData *pData, epicsUInt64 now)
+{
+    ConnectTiming &timing = pData->timing;
+    if (timing.connected != 0 && timing.disconnected == 0)
+        timing.disconnected = now;
+}
+
+/* the channels of a destroyed context were destroyed with it */
+static void connect_forget_context(ContextStats *pStats)
+{
+    if (pStats == NULL)
+        return;
+    std::map<chanId, ChannelData *>::iterator it = CHANNELS.begin();
+    while (it != CHANNELS.end()) {
+        if (it->second->pContextStats == pStats) {
+            UNCONNECTED.erase(it->first);
+            CHANNELS.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static void connect_sweep()
+{
+    if (UNCONNECTED.empty())
+        return;
+    epicsUInt64 now = monotonic_ns();
+    std::set<chanId>::iterator it = UNCONNECTED.begin();
+    while (it != UNCONNECTED.end()) {
+        chanId chid = *it++;
+        if (ca_state(chid) != cs_conn)
+            continue;
+        ChannelData *pData = (ChannelData *) ca_puser(chid);
+        if (pData != NULL)
+            connect_record_up(pData, now);
+        else
+            UNCONNECTED.erase(chid);
+    }
+}
+
 static void connection_callback(struct connection_handler_args args)
 {
     ChannelData *pData = (ChannelData *) ca_puser(args.chid);
     if (pData == NULL)
         return;
+    epicsUInt64 now = monotonic_ns();
+
+    if (args.op == CA_OP_CONN_UP) {
+        stats_incr(&pData->stats.connects);
+        trace_instant("connect", ca_name(args.chid));
+    } else {
+        stats_incr(&pData->stats.disconnects);
+        trace_instant("disconnect", ca_name(args.chid));
+    }
 
     PyGILState_STATE gstate = PyGILState_Ensure();
 
+    if (args.op == CA_OP_CONN_UP)
+        connect_record_up(pData, now);
+    else
+        connect_record_down(pData, now);
+
     if(PyCallable_Check(pData->pCallback)) {
         PyObject *pChid = CAPSULE_BUILD(args.chid, "chid", NULL);
-        PyObject *pArgs = Py_BuildValue("({s:O,s:N})", "chid", pChid, "op", IntToIntEnum("CA_OP", args.op));
+        PyObject *pArgs = Py_BuildValue("{s:O,s:N}", "chid", pChid, "op", IntToIntEnum("CA_OP", args.op));
 
-        PyObject *ret = PyObject_CallObject(pData->pCallback, pArgs);
+        PyObject *ret = call_callback(pData->pCallback, pArgs);
+        stats_count_callback(args.chid, pData->pContextStats, ret == NULL);
         if (ret == NULL) {
             PyErr_Print();
         }
@@ -1093,11 +2299,26 @@ static PyObject *Py_ca_create_channel(PyObject *self, PyObject *args, PyObject *
     if(PyCallable_Check(pCallback)) {
         pFunc = connection_callback;
     }
+    /* a preemptive context may call back before ca_create_channel returns */
+    pData->set_context_stats(ContextStats_get(ca_current_context()));
+    TraceSpan span("create_channel", pName);
+    pData->timing.created = monotonic_ns();
     Py_BEGIN_ALLOW_THREADS
     status = ca_create_channel(pName, pFunc, pData, priority, &chid);
+    span.returned();
     Py_END_ALLOW_THREADS
+    span.end();
 
     if (status == ECA_NORMAL) {
+        /* now a valid ca context is guaranteed */
+        if (pData->pContextStats == NULL)
+            pData->set_context_stats(ContextStats_get(ca_current_context()));
+        if (pData->pContextStats != NULL)
+            stats_incr(&pData->pContextStats->channels);
+        pData->timing.chid = chid;
+        CHANNELS[chid] = pData;
+        if (pFunc == NULL && pData->timing.connected == 0)
+            UNCONNECTED.insert(chid);
         return Py_BuildValue("NN", IntToIntEnum("ECA", status), CAPSULE_BUILD(chid, "chid", NULL));
     } else {
         delete pData;
@@ -1125,6 +2346,10 @@ static PyObject *Py_ca_clear_channel(PyObject *self, PyObject *args)
     status = ca_clear_channel(chid);
     Py_END_ALLOW_THREADS
 
+    if (pData != NULL && pData->pContextStats != NULL)
+        stats_decr(&pData->pContextStats->channels);
+    CHANNELS.erase(chid);
+    UNCONNECTED.erase(chid);
     delete pData;
 
     return IntToIntEnum("ECA", status);
@@ -1177,38 +2402,83 @@ static PyObject *Py_ca_change_connection_event(PyObject *self, PyObject *args)
  *                    CA Operation                     *
  *******************************************************/
 
+/* the argument dict of a get or monitor callback */
+static PyObject *EventCallbackArgs(const struct event_handler_args &args, bool use_numpy, int format=0)
+{
+    /* replayed updates have no channel */
+    PyObject *pChid;
+    if (args.chid != NULL) {
+        pChid = CAPSULE_BUILD(args.chid, "chid", NULL);
+    } else {
+        Py_INCREF(Py_None);
+        pChid = Py_None;
+    }
+    PyObject *pValue = CBufferToPythonDict(args.type,
+                args.count,
+                args.dbr,
+                use_numpy,
+                format);
+    PyObject *pArgs;
+    if (format & FORMAT_PV_FIELDS) {
+        /* the pv_ fields are merged into the argument dict */
+        pArgs = Py_BuildValue(
+            "{s:O,s:N,s:i,s:N}",
+            "chid", pChid,
+            "type", IntToIntEnum("DBR", args.type),
+            "count", args.count,
+            "status", IntToIntEnum("ECA", args.status)
+        );
+        if (pArgs != NULL && pValue != NULL) {
+            if (PyDict_Check(pValue))
+                PyDict_Update(pArgs, pValue);
+            else
+                PyDict_SetItemString(pArgs, "pv_value", pValue);
+        }
+    } else {
+        pArgs = Py_BuildValue(
+            "{s:O,s:N,s:i,s:N,s:O}",
+            "chid", pChid,
+            "type", IntToIntEnum("DBR", args.type),
+            "count", args.count,
+            "status", IntToIntEnum("ECA", args.status),
+            "value", pValue
+        );
+    }
+    Py_XDECREF(pValue);
+    Py_XDECREF(pChid);
+    return pArgs;
+}
+
 static void get_callback(struct event_handler_args args)
 {
     ChannelData *pData= (ChannelData *)args.usr;
+    LatencyProbe probe("get_callback");
     if (pData == NULL)
         return;
+    trace_async('e', "get", pData, ca_name(args.chid));
+
+    if (pData->pContextStats != NULL)
+        stats_decr(&pData->pContextStats->outstanding_gets);
+    stats_count_update(args, pData->pContextStats);
 
     PyGILState_STATE gstate = PyGILState_Ensure();
+    probe.gil_acquired();
 
     if (PyCallable_Check(pData->pCallback)) {
-        PyObject *pChid = CAPSULE_BUILD(args.chid, "chid", NULL);
-        PyObject *pValue = CBufferToPythonDict(args.type,
-                    args.count,
-                    args.dbr,
-                    pData->use_numpy);
-        PyObject *pArgs = Py_BuildValue(
-            "({s:O,s:N,s:i,s:N,s:O})",
-            "chid", pChid,
-            "type", IntToIntEnum("DBR", args.type),
-            "count", args.count,
-            "status", IntToIntEnum("ECA", args.status),
-            "value", pValue
-        );
-        PyObject *ret = PyObject_CallObject(pData->pCallback, pArgs);
+        PyObject *pArgs = EventCallbackArgs(args, pData->use_numpy, pData->format);
+        PyObject *ret = call_callback(pData->pCallback, pArgs, pData->pUserArgs);
+        stats_count_callback(args.chid, pData->pContextStats, ret == NULL);
         if (ret == NULL) {
             PyErr_Print();
         }
         Py_XDECREF(ret);
-        Py_XDECREF(pValue);
-        Py_XDECREF(pChid);
         Py_XDECREF(pArgs);
     }
 
+    probe.done(args.chid, pData->pContextStats);
+
+    if (pData->pCompletion != NULL)
+        completion_done(pData->pCompletion);
     delete pData;
 
     PyGILState_Release(gstate);
@@ -1216,59 +2486,61 @@ static void get_callback(struct event_handler_args args)
 
 static void event_callback(struct event_handler_args args)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
-
     ChannelData *pData= (ChannelData *)args.usr;
+    LatencyProbe probe("monitor");
+
+    stats_count_update(args, pData->pContextStats);
+
+    if (pData->pRecorder != NULL)
+        recorder_write(pData->pRecorder, pData->recorder_channel, args);
+    if (pData->pShm != NULL)
+        shm_write(pData->pShm, pData->shm_slot, args);
+    if (pData->pSampler != NULL)
+        sampler_update(pData->pSampler, pData->sampler_channel, args);
+    /* recording, publishing or sampling only, the GIL is not needed */
+    if (pData->pCallback == Py_None &&
+            (pData->pRecorder != NULL || pData->pShm != NULL || pData->pSampler != NULL))
+        return;
+
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    probe.gil_acquired();
 
     if (PyCallable_Check(pData->pCallback)) {
-        PyObject *pChid = CAPSULE_BUILD(args.chid, "chid", NULL);
-        PyObject *pValue = CBufferToPythonDict(args.type,
-                    args.count,
-                    args.dbr,
-                    pData->use_numpy);
-        PyObject *pArgs = Py_BuildValue(
-            "({s:O,s:N,s:i,s:N,s:O})",
-            "chid", pChid,
-            "type", IntToIntEnum("DBR", args.type),
-            "count", args.count,
-            "status", IntToIntEnum("ECA", args.status),
-            "value", pValue
-        );
-        PyObject *ret = PyObject_CallObject(pData->pCallback, pArgs);
+        PyObject *pArgs = EventCallbackArgs(args, pData->use_numpy, pData->format);
+        PyObject *ret = call_callback(pData->pCallback, pArgs, pData->pUserArgs);
+        stats_count_callback(args.chid, pData->pContextStats, ret == NULL);
         if (ret == NULL) {
             PyErr_Print();
         }
         Py_XDECREF(ret);
-        Py_XDECREF(pValue);
-        Py_XDECREF(pChid);
         Py_XDECREF(pArgs);
     }
 
+    probe.done(args.chid, pData->pContextStats);
+
     PyGILState_Release(gstate);
 }
 
 
-static PyObject *Py_ca_get(PyObject *self, PyObject *args, PyObject *kws)
+static PyObject *get_value(PyObject *pChid, PyObject *pType, PyObject *pCount, PyObject *pCallback, bool use_numpy,
+                           PyObject *pCompletion, int format)
 {
-    PyObject *pChid;
-    PyObject *pType = Py_None;
     chtype dbrtype = -1;
-    PyObject *pCount = Py_None;
     unsigned long count = 0;
-    PyObject *pCallback = Py_None;
-    bool use_numpy = false;
     int status;
 
-    const char *kwlist[] = {"chid", "chtype", "count", "callback", "use_numpy", NULL};
-
-    if (!PyArg_ParseTupleAndKeywords(args, kws, "O|OOOb", (char **)kwlist, &pChid, &pType, &pCount, &pCallback, &use_numpy))
-        return NULL;
-
     chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
     if (chid == NULL)
         return NULL;
 
-    Py_BEGIN_ALLOW_THREADS
+    Completion *completion = NULL;
+    if (pCompletion != Py_None) {
+        completion = (Completion *) CAPSULE_EXTRACT(pCompletion, "completion");
+        if (completion == NULL)
+            return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
     dbrtype = dbf_type_to_DBR(ca_field_type(chid));
     count = ca_element_count(chid);
     Py_END_ALLOW_THREADS
@@ -1285,13 +2557,28 @@ static PyObject *Py_ca_get(PyObject *self, PyObject *args, PyObject *kws)
             return NULL;
         count = MIN(req_count, count);
     }
-    if (PyCallable_Check(pCallback)) {
-        ChannelData *pData = new ChannelData(pCallback);
+    if (PyCallable_Check(pCallback) || is_callback_pair(pCallback) || completion != NULL) {
+        ChannelData *pData = new ChannelData(pCallback, MEMORY_GET);
         pData->use_numpy = use_numpy;
+        pData->format = format;
+        pData->set_context_stats(channel_context_stats(chid));
+        if (pData->pContextStats != NULL)
+            stats_incr(&pData->pContextStats->outstanding_gets);
+        if (completion != NULL) {
+            completion_issue(completion);
+            pData->pCompletion = completion;
+        }
+        /* the callback may run before ca_array_get_callback returns */
+        trace_async('b', "get", pData, ca_name(chid));
         Py_BEGIN_ALLOW_THREADS
         status = ca_array_get_callback(dbrtype, count, chid, get_callback, pData);
         Py_END_ALLOW_THREADS
         if (status != ECA_NORMAL) {
+            trace_async('e', "get", pData, ca_name(chid));
+            if (pData->pContextStats != NULL)
+                stats_decr(&pData->pContextStats->outstanding_gets);
+            if (completion != NULL)
+                completion_done(completion);
             delete pData;
         }
         Py_INCREF(Py_None);
@@ -1300,11 +2587,12 @@ static PyObject *Py_ca_get(PyObject *self, PyObject *args, PyObject *kws)
         // prepare the storage
         count = MAX(1, count);
         void * pValue = malloc(dbr_size_n(dbrtype, count));
+        trace_instant("get", ca_name(chid));
         Py_BEGIN_ALLOW_THREADS
         status = ca_array_get(dbrtype, count, chid, pValue);
         Py_END_ALLOW_THREADS
         if (status == ECA_NORMAL) {
-            return Py_BuildValue("(NN)", IntToIntEnum("ECA", status), DBRValue_New(dbrtype, count, pValue, use_numpy));
+            return Py_BuildValue("(NN)", IntToIntEnum("ECA", status), DBRValue_New(dbrtype, count, pValue, use_numpy, format));
         } else {
             free(pValue);
             Py_INCREF(Py_None);
@@ -1313,24 +2601,80 @@ static PyObject *Py_ca_get(PyObject *self, PyObject *args, PyObject *kws)
     }
 }
 
-static void put_callback(struct event_handler_args args)
+#ifdef CA_FASTCALL
+static PyObject *Py_ca_get(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
-    PyGILState_STATE gstate = PyGILState_Ensure();
+    PyObject *values[] = {NULL, Py_None, Py_None, Py_None, Py_False, Py_None, Py_False, Py_False, Py_False, Py_False};
+    const char *kwlist[] = {"chid", "chtype", "count", "callback", "use_numpy", "completion", "as_string", "pv_fields",
+                            "stamp_ns", "fixed_strings", NULL};
+
+    if (!fastcall_parse("get", args, nargs, kwnames, kwlist, 1, values))
+        return NULL;
+
+    long use_numpy = PyLong_AsLong(values[4]);
+    if (use_numpy == -1 && PyErr_Occurred())
+        return NULL;
+
+    int as_string = PyObject_IsTrue(values[6]);
+    int pv_fields = PyObject_IsTrue(values[7]);
+    int stamp_ns = PyObject_IsTrue(values[8]);
+    int fixed_strings = PyObject_IsTrue(values[9]);
+    if (as_string == -1 || pv_fields == -1 || stamp_ns == -1 || fixed_strings == -1)
+        return NULL;
+
+    return get_value(values[0], values[1], values[2], values[3], use_numpy != 0, values[5],
+                     (as_string ? FORMAT_AS_STRING : 0) | (pv_fields ? FORMAT_PV_FIELDS : 0) |
+                     (stamp_ns ? FORMAT_STAMP_NS : 0) | (fixed_strings ? FORMAT_FIXED_STRINGS : 0));
+}
+#else
+static PyObject *Py_ca_get(PyObject *self, PyObject *args, PyObject *kws)
+{
+    PyObject *pChid;
+    PyObject *pType = Py_None;
+    PyObject *pCount = Py_None;
+    PyObject *pCallback = Py_None;
+    bool use_numpy = false;
+    PyObject *pCompletion = Py_None;
+    bool as_string = false;
+    bool pv_fields = false;
+    bool stamp_ns = false;
+    bool fixed_strings = false;
 
+    const char *kwlist[] = {"chid", "chtype", "count", "callback", "use_numpy", "completion", "as_string", "pv_fields",
+                            "stamp_ns", "fixed_strings", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kws, "O|OOObObbbb", (char **)kwlist, &pChid, &pType, &pCount, &pCallback, &use_numpy, &pCompletion,
+                                     &as_string, &pv_fields, &stamp_ns, &fixed_strings))
+        return NULL;
+
+    return get_value(pChid, pType, pCount, pCallback, use_numpy, pCompletion,
+                     (as_string ? FORMAT_AS_STRING : 0) | (pv_fields ? FORMAT_PV_FIELDS : 0) |
+                     (stamp_ns ? FORMAT_STAMP_NS : 0) | (fixed_strings ? FORMAT_FIXED_STRINGS : 0));
+}
+#endif
+
+static void put_callback(struct event_handler_args args)
+{
     ChannelData *pData = (ChannelData *)args.usr;
+    LatencyProbe probe("put_callback");
+    trace_async('e', "put", pData, ca_name(args.chid));
+
+    if (pData->pContextStats != NULL)
+        stats_decr(&pData->pContextStats->outstanding_puts);
+
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    probe.gil_acquired();
 
     if (PyCallable_Check(pData->pCallback)) {
         PyObject *pArgs = Py_BuildValue(
-            "({s:N,s:N,s:i,s:N})",
+            "{s:N,s:N,s:i,s:N}",
             "chid", CAPSULE_BUILD(args.chid, "chid", NULL),
             "type", IntToIntEnum("DBR", args.type),
             "count", args.count,
             "status", IntToIntEnum("ECA", args.status)
         );
-        if (pArgs == NULL) {
-            PyErr_Print();
-        }
-        PyObject *ret = PyObject_CallObject(pData->pCallback, pArgs);
+        PyObject *ret = call_callback(pData->pCallback, pArgs, pData->pUserArgs);
+        stats_count_callback(args.chid, pData->pContextStats, ret == NULL);
         if (ret == NULL) {
             PyErr_Print();
         }
@@ -1338,33 +2682,35 @@ static void put_callback(struct event_handler_args args)
         Py_XDECREF(pArgs);
     }
 
+    probe.done(args.chid, pData->pContextStats);
+
+    if (pData->pCompletion != NULL)
+        completion_done(pData->pCompletion);
     delete pData;
 
     PyGILState_Release(gstate);
 }
 
 
-static PyObject *Py_ca_put(PyObject *self, PyObject *args, PyObject *kws)
+static PyObject *put_value(PyObject *pChid, PyObject *pValue, PyObject *pType, PyObject *pCount, PyObject *pCallback,
+                           PyObject *pCompletion)
 {
-    PyObject *pChid;
-    PyObject *pValue;
-    PyObject *pType = Py_None;
-    PyObject *pCount = Py_None;
     chtype dbrtype = -1;
     unsigned long count = 1;
-    PyObject *pCallback = Py_None;
     void *pbuf = NULL;
     int status;
 
-    const char *kwlist[] = {"chid", "value", "chtype", "count", "callback", NULL};
-
-    if (!PyArg_ParseTupleAndKeywords(args, kws, "OO|OOO", (char **)kwlist, &pChid, &pValue, &pType, &pCount, &pCallback))
-        return NULL;
-
     chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
     if (chid == NULL)
         return NULL;
 
+    Completion *completion = NULL;
+    if (pCompletion != Py_None) {
+        completion = (Completion *) CAPSULE_EXTRACT(pCompletion, "completion");
+        if (completion == NULL)
+            return NULL;
+    }
+
     pbuf = setup_put(chid, pValue, pType, pCount, dbrtype, count);
     if (pbuf == NULL) {
         if (PyErr_Occurred())
@@ -1373,14 +2719,29 @@ static PyObject *Py_ca_put(PyObject *self, PyObject *args, PyObject *kws)
             return IntToIntEnum("ECA", ECA_BADTYPE);
     }
 
-    if (PyCallable_Check(pCallback)) {
-        ChannelData *pData = new ChannelData(pCallback);
+    if (PyCallable_Check(pCallback) || is_callback_pair(pCallback) || completion != NULL) {
+        ChannelData *pData = new ChannelData(pCallback, MEMORY_PUT);
+        pData->set_context_stats(channel_context_stats(chid));
+        if (pData->pContextStats != NULL)
+            stats_incr(&pData->pContextStats->outstanding_puts);
+        if (completion != NULL) {
+            completion_issue(completion);
+            pData->pCompletion = completion;
+        }
+        trace_async('b', "put", pData, ca_name(chid));
         Py_BEGIN_ALLOW_THREADS
         status = ca_array_put_callback(dbrtype, count, chid, pbuf, put_callback, pData);
         Py_END_ALLOW_THREADS
-        if (status != ECA_NORMAL)
+        if (status != ECA_NORMAL) {
+            trace_async('e', "put", pData, ca_name(chid));
+            if (pData->pContextStats != NULL)
+                stats_decr(&pData->pContextStats->outstanding_puts);
+            if (completion != NULL)
+                completion_done(completion);
             delete pData;
+        }
     } else {
+        trace_instant("put", ca_name(chid));
         Py_BEGIN_ALLOW_THREADS
         status = ca_array_put(dbrtype, count, chid, pbuf);
         Py_END_ALLOW_THREADS
@@ -1391,6 +2752,36 @@ static PyObject *Py_ca_put(PyObject *self, PyObject *args, PyObject *kws)
     return IntToIntEnum("ECA", status);
 }
 
+#ifdef CA_FASTCALL
+static PyObject *Py_ca_put(PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    PyObject *values[] = {NULL, NULL, Py_None, Py_None, Py_None, Py_None};
+    const char *kwlist[] = {"chid", "value", "chtype", "count", "callback", "completion", NULL};
+
+    if (!fastcall_parse("put", args, nargs, kwnames, kwlist, 2, values))
+        return NULL;
+
+    return put_value(values[0], values[1], values[2], values[3], values[4], values[5]);
+}
+#else
+static PyObject *Py_ca_put(PyObject *self, PyObject *args, PyObject *kws)
+{
+    PyObject *pChid;
+    PyObject *pValue;
+    PyObject *pType = Py_None;
+    PyObject *pCount = Py_None;
+    PyObject *pCallback = Py_None;
+    PyObject *pCompletion = Py_None;
+
+    const char *kwlist[] = {"chid", "value", "chtype", "count", "callback", "completion", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kws, "OO|OOOO", (char **)kwlist, &pChid, &pValue, &pType, &pCount, &pCallback, &pCompletion))
+        return NULL;
+
+    return put_value(pChid, pValue, pType, pCount, pCallback, pCompletion);
+}
+#endif
+
 
 static PyObject *Py_ca_create_subscription(PyObject *self, PyObject *args, PyObject *kws)
 {
@@ -1399,19 +2790,49 @@ static PyObject *Py_ca_create_subscription(PyObject *self, PyObject *args, PyObj
     PyObject *pType = Py_None;
     PyObject *pCount = Py_None;
     PyObject *pMask = Py_None;
+    PyObject *pRecorder = Py_None;
+    PyObject *pPublisher = Py_None;
+    PyObject *pSampler = Py_None;
     chtype dbrtype = -1;
     unsigned long count = 0;
     unsigned long mask = DBE_VALUE | DBE_ALARM;
     bool use_numpy = false;
-    const char *kwlist[] = {"chid", "callback", "chtype", "count", "mask", "use_numpy", NULL};
-
-    if (!PyArg_ParseTupleAndKeywords(args, kws, "OO|OOOb", (char **)kwlist, &pChid,  &pCallback, &pType, &pCount, &pMask, &use_numpy))
+    bool as_string = false;
+    bool pv_fields = false;
+    bool stamp_ns = false;
+    bool fixed_strings = false;
+    const char *kwlist[] = {"chid", "callback", "chtype", "count", "mask", "use_numpy", "recorder", "shm", "sampler",
+                            "as_string", "pv_fields", "stamp_ns", "fixed_strings", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kws, "OO|OOObOOObbbb", (char **)kwlist, &pChid,  &pCallback, &pType, &pCount, &pMask, &use_numpy, &pRecorder, &pPublisher, &pSampler,
+                                     &as_string, &pv_fields, &stamp_ns, &fixed_strings))
         return NULL;
 
     chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
     if (chid == NULL)
         return NULL;
 
+    Recorder *recorder = NULL;
+    if (pRecorder != Py_None) {
+        recorder = handle_object<Recorder>(pRecorder, &RECORDER_HANDLE);
+        if (recorder == NULL)
+            return NULL;
+    }
+
+    SharedMemory *publisher = NULL;
+    if (pPublisher != Py_None) {
+        publisher = handle_object<SharedMemory>(pPublisher, &SHM_HANDLE);
+        if (publisher == NULL)
+            return NULL;
+    }
+
+    Sampler *sampler = NULL;
+    if (pSampler != Py_None) {
+        sampler = handle_object<Sampler>(pSampler, &SAMPLER_HANDLE);
+        if (sampler == NULL)
+            return NULL;
+    }
+
     Py_BEGIN_ALLOW_THREADS
     dbrtype = dbf_type_to_DBR(ca_field_type(chid));
     count = ca_element_count(chid);
@@ -1436,8 +2857,33 @@ static PyObject *Py_ca_create_subscription(PyObject *self, PyObject *args, PyObj
             return NULL;
     }
 
-    ChannelData *pData = new ChannelData(pCallback);
+    if (sampler != NULL && !dbr_type_is_TIME(dbrtype)) {
+        PyErr_SetString(PyExc_ValueError, "a sampler needs a DBR_TIME type");
+        return NULL;
+    }
+
+    ChannelData *pData = new ChannelData(pCallback, MEMORY_SUBSCRIPTION);
     pData->use_numpy = use_numpy;
+    pData->format = (as_string ? FORMAT_AS_STRING : 0) | (pv_fields ? FORMAT_PV_FIELDS : 0) |
+                    (stamp_ns ? FORMAT_STAMP_NS : 0) | (fixed_strings ? FORMAT_FIXED_STRINGS : 0);
+    pData->set_context_stats(channel_context_stats(chid));
+    if (recorder != NULL) {
+        pData->recorder_channel = recorder_add_channel(recorder, ca_name(chid));
+        pData->pRecorder = recorder;
+    }
+    if (publisher != NULL) {
+        long shm_slot = shm_add_channel(publisher, ca_name(chid));
+        if (shm_slot < 0) {
+            delete pData;
+            return NULL;
+        }
+        pData->shm_slot = (epicsUInt32)shm_slot;
+        pData->pShm = publisher;
+    }
+    if (sampler != NULL) {
+        pData->sampler_channel = sampler_add_channel(sampler, ca_name(chid));
+        pData->pSampler = sampler;
+    }
 
     evid eventID;
     int status;
@@ -1447,6 +2893,8 @@ static PyObject *Py_ca_create_subscription(PyObject *self, PyObject *args, PyObj
 
     if (status == ECA_NORMAL) {
         pData->eventID = eventID;
+        if (pData->pContextStats != NULL)
+            stats_incr(&pData->pContextStats->subscriptions);
         return Py_BuildValue("(NN)", IntToIntEnum("ECA", status), CAPSULE_BUILD(pData, "evid", NULL));
     } else {
         delete pData;
@@ -1471,6 +2919,8 @@ static PyObject *Py_ca_clear_subscription(PyObject *self, PyObject *args)
     status = ca_clear_subscription(pData->eventID);
     Py_END_ALLOW_THREADS
 
+    if (pData->pContextStats != NULL)
+        stats_decr(&pData->pContextStats->subscriptions);
     delete pData;
 
     return IntToIntEnum("ECA", status);
@@ -1486,12 +2936,12 @@ static void access_rights_handler(struct access_rights_handler_args args)
 
     if (PyCallable_Check(pData->pAccessEventCallback)) {
         PyObject *pArgs = Py_BuildValue(
-            "({s:N,s:N,s:N})",
+            "{s:N,s:N,s:N}",
             "chid", CAPSULE_BUILD(args.chid, "chid", NULL),
             "read_access", PyBool_FromLong(args.ar.read_access),
             "write_access", PyBool_FromLong(args.ar.write_access)
         );
-        PyObject *ret = PyObject_CallObject(pData->pAccessEventCallback, pArgs);
+        PyObject *ret = call_callback(pData->pAccessEventCallback, pArgs);
         if (ret == NULL) {
             PyErr_Print();
         }
@@ -1581,22 +3031,209 @@ static void exception_handler(struct exception_handler_args args)
     PyGILState_Release(gstate);
 }
 
-static PyObject *Py_ca_add_exception_event(PyObject *self, PyObject *args)
+/*******************************************************
+ *                 Buffered log ring                   *
+ *******************************************************/
+
+/*
+    In buffered mode the printf and exception handlers do not take the GIL. They append a compact record
+    to a bounded lock free ring, multiple producers (the CA threads) and a single consumer (ca.drain_log),
+    following D. Vyukov's bounded queue. A record is dropped if the ring is full.
+
+    Records are rate limited per key, (op, status, channel) for exceptions and the format string for printf.
+    At most LOG.burst records of a key are queued within LOG.interval seconds, the rest are counted and
+    the count is reported with the next record queued for that key.
+*/
+#define LOG_RING_SIZE    1024   /* power of 2 */
+#define LOG_MESSAGE_SIZE 512
+#define LOG_KEY_SIZE     256    /* power of 2 */
+
+enum { LOG_PRINTF, LOG_EXCEPTION };
+
+struct LogRecord {
+    size_t sequence;
+    int kind;
+    size_t generation;      /* of the context, a destroyed context's address may be reused */
+    chanId chid;
+    long type;
+    long count;
+    long stat;
+    long op;
+    int lineNo;
+    size_t repeat;
+    epicsTimeStamp stamp;
+    char name[64];
+    char file[64];
+    char message[LOG_MESSAGE_SIZE];
+};
+
+struct LogKey {
+    size_t key;
+    size_t start;       /* window start in ms */
+    size_t count;       /* records within the window */
+    size_t suppressed;  /* records suppressed since the last queued one */
+};
+
+static struct {
+    LogRecord ring[LOG_RING_SIZE];
+    LogKey keys[LOG_KEY_SIZE];
+    size_t head;        /* next position to write */
+    size_t tail;        /* next position to read */
+    size_t queued;
+    size_t dropped;
+    size_t suppressed;
+    size_t burst;
+    size_t interval;    /* ms */
+    size_t generation;  /* last generation given to a context */
+    bool initialized;
+} LOG;
+
+static void log_init()
+{
+    if (LOG.initialized)
+        return;
+    for (size_t i=0; i<LOG_RING_SIZE; i++)
+        LOG.ring[i].sequence = i;
+    LOG.burst = 5;
+    LOG.interval = 1000;
+    LOG.initialized = true;
+}
+
+/* return true if a record of this key should be queued, and the number of records suppressed before it */
+static bool log_admit(size_t key, size_t &repeat)
+{
+    LogKey *pKey = &LOG.keys[(key ^ (key >> 12)) & (LOG_KEY_SIZE - 1)];
+    size_t now = (size_t)(monotonic_ns() / 1000000u);
+
+    repeat = 0;
+    /* races between threads only make the rate limit approximate */
+    if (epicsAtomicGetSizeT(&pKey->key) != key) {
+        epicsAtomicSetSizeT(&pKey->key, key);
+        epicsAtomicSetSizeT(&pKey->start, now);
+        epicsAtomicSetSizeT(&pKey->count, 1);
+        epicsAtomicSetSizeT(&pKey->suppressed, 0);
+        return true;
+    }
+    if (now - epicsAtomicGetSizeT(&pKey->start) >= LOG.interval) {
+        epicsAtomicSetSizeT(&pKey->start, now);
+        epicsAtomicSetSizeT(&pKey->count, 1);
+    } else if (epicsAtomicIncrSizeT(&pKey->count) > LOG.burst) {
+        epicsAtomicIncrSizeT(&pKey->suppressed);
+        epicsAtomicIncrSizeT(&LOG.suppressed);
+        return false;
+    }
+    size_t suppressed = epicsAtomicGetSizeT(&pKey->suppressed);
+    while (suppressed != 0) {
+        size_t previous = epicsAtomicCmpAndSwapSizeT(&pKey->suppressed, suppressed, 0);
+        if (previous == suppressed)
+            break;
+        suppressed = previous;
+    }
+    repeat = suppressed;
+    return true;
+}
+
+/* claim a free record, or return NULL if the ring is full */
+static LogRecord *log_claim()
+{
+    size_t pos = epicsAtomicGetSizeT(&LOG.head);
+    for (;;) {
+        LogRecord *pRecord = &LOG.ring[pos & (LOG_RING_SIZE - 1)];
+        size_t sequence = epicsAtomicGetSizeT(&pRecord->sequence);
+        if (sequence == pos) {
+            size_t previous = epicsAtomicCmpAndSwapSizeT(&LOG.head, pos, pos + 1);
+            if (previous == pos)
+                return pRecord;
+            pos = previous;
+        } else if ((ptrdiff_t)(sequence - pos) < 0) {
+            epicsAtomicIncrSizeT(&LOG.dropped);
+            return NULL;
+        } else {
+            pos = epicsAtomicGetSizeT(&LOG.head);
+        }
+    }
+}
+
+/* publish a record filled after log_claim */
+static void log_commit(LogRecord *pRecord)
+{
+    epicsAtomicIncrSizeT(&LOG.queued);
+    epicsAtomicSetSizeT(&pRecord->sequence, epicsAtomicGetSizeT(&pRecord->sequence) + 1);
+}
+
+static void copy_string(char *dest, const char *src, size_t size)
+{
+    if (src == NULL)
+        src = "";
+    strncpy(dest, src, size - 1);
+    dest[size - 1] = '\0';
+}
+
+static void buffered_exception_handler(struct exception_handler_args args)
+{
+    size_t repeat;
+    size_t key = ((size_t)args.op * 31 + (size_t)args.stat) * 1000003u ^ (size_t)args.chid;
+    if (!log_admit(key, repeat))
+        return;
+
+    LogRecord *pRecord = log_claim();
+    if (pRecord == NULL)
+        return;
+
+    pRecord->kind = LOG_EXCEPTION;
+    pRecord->generation = (size_t)args.usr;
+    pRecord->chid = args.chid;
+    pRecord->type = args.type;
+    pRecord->count = args.count;
+    pRecord->stat = args.stat;
+    pRecord->op = args.op;
+    pRecord->lineNo = args.lineNo;
+    pRecord->repeat = repeat;
+    epicsTimeGetCurrent(&pRecord->stamp);
+    /* the channel may be gone when the record is drained, its name tells */
+    copy_string(pRecord->name, args.chid ? ca_name(args.chid) : NULL, sizeof(pRecord->name));
+    copy_string(pRecord->file, args.pFile, sizeof(pRecord->file));
+    copy_string(pRecord->message, args.ctx, sizeof(pRecord->message));
+
+    log_commit(pRecord);
+}
+
+static PyObject *Py_ca_add_exception_event(PyObject *self, PyObject *args, PyObject *kws)
 {
     PyObject *pCallback = NULL;
-    if(!PyArg_ParseTuple(args, "|O", &pCallback))
+    int buffered = 0;
+    const char *kwlist[] = {"callback", "buffered", NULL};
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "|Oi", (char **)kwlist, &pCallback, &buffered))
         return NULL;
 
     caExceptionHandler *handler = NULL;
+    void *usr = NULL;
     if (PyCallable_Check(pCallback)) {
         handler = exception_handler;
+        usr = pCallback;
     } else {
         pCallback = NULL;
     }
 
     int status;
+    if (handler != NULL && buffered) {
+        log_init();
+        /* the records refer to the context by generation, whose callback is looked up when drained */
+        ca_client_context *pContext;
+        Py_BEGIN_ALLOW_THREADS
+        if (ca_current_context() == NULL)
+            ca_context_create(ca_disable_preemptive_callback);
+        pContext = ca_current_context();
+        Py_END_ALLOW_THREADS
+        size_t &generation = CONTEXTS[pContext].logGeneration;
+        if (generation == 0)
+            generation = ++LOG.generation;
+        handler = buffered_exception_handler;
+        usr = (void *)generation;
+    }
+
     Py_BEGIN_ALLOW_THREADS
-    status = ca_add_exception_event(handler, pCallback);
+    status = ca_add_exception_event(handler, usr);
     Py_END_ALLOW_THREADS
 
     if (status == ECA_NORMAL) {
@@ -1642,10 +3279,34 @@ int printf_handler(const char *pFormat, va_list args)
     return 0;
 }
 
-static PyObject *Py_ca_replace_printf_handler(PyObject *self, PyObject *args)
+int buffered_printf_handler(const char *pFormat, va_list args)
+{
+    size_t repeat;
+    /* the format string is mostly a literal, its address identifies the message */
+    if (!log_admit((size_t)pFormat, repeat))
+        return 0;
+
+    LogRecord *pRecord = log_claim();
+    if (pRecord == NULL)
+        return 0;
+
+    pRecord->kind = LOG_PRINTF;
+    pRecord->generation = 0;
+    pRecord->chid = NULL;
+    pRecord->repeat = repeat;
+    epicsTimeGetCurrent(&pRecord->stamp);
+    vsnprintf(pRecord->message, LOG_MESSAGE_SIZE, pFormat, args);
+
+    log_commit(pRecord);
+    return 0;
+}
+
+static PyObject *Py_ca_replace_printf_handler(PyObject *self, PyObject *args, PyObject *kws)
 {
     PyObject *pCallback = NULL;
-    if(!PyArg_ParseTuple(args, "|O", &pCallback))
+    int buffered = 0;
+    const char *kwlist[] = {"callback", "buffered", NULL};
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "|Oi", (char **)kwlist, &pCallback, &buffered))
         return NULL;
 
     /* release previous callback/args */
@@ -1658,7 +3319,12 @@ static PyObject *Py_ca_replace_printf_handler(PyObject *self, PyObject *args)
         Py_XINCREF(pCallback);
         pPrintfHandler = pCallback;
 
-        pFunc = printf_handler;
+        if (buffered) {
+            log_init();
+            pFunc = buffered_printf_handler;
+        } else {
+            pFunc = printf_handler;
+        }
     }
 
     int status;
@@ -1669,6 +3335,119 @@ static PyObject *Py_ca_replace_printf_handler(PyObject *self, PyObject *args)
     return IntToIntEnum("ECA", status);
 }
 
+static PyObject *LogRecordToPython(const LogRecord *pRecord)
+{
+    if (pRecord->kind == LOG_PRINTF) {
+        if (pRecord->repeat == 0)
+            return CharToPyStringOrBytes(pRecord->message);
+        char message[LOG_MESSAGE_SIZE + 64];
+        sprintf(message, "%s(%lu similar messages suppressed)\n", pRecord->message, (unsigned long)pRecord->repeat);
+        return CharToPyStringOrBytes(message);
+    }
+
+    PyObject *pName;
+    if (pRecord->name[0])
+        pName = CharToPyStringOrBytes(pRecord->name);
+    else {
+        pName = Py_None;
+        Py_INCREF(pName);
+    }
+    /* the channel as in the unbuffered callback, if it has not been cleared meanwhile */
+    PyObject *pChid;
+    if (pRecord->chid != NULL && CHANNELS.find(pRecord->chid) != CHANNELS.end() &&
+            strncmp(ca_name(pRecord->chid), pRecord->name, sizeof(pRecord->name) - 1) == 0)
+        pChid = CAPSULE_BUILD(pRecord->chid, "chid", NULL);
+    else {
+        pChid = Py_None;
+        Py_INCREF(pChid);
+    }
+    return Py_BuildValue(
+        "{s:N,s:N,s:N,s:l,s:N,s:N,s:N,s:N,s:i,s:k,s:d}",
+        "chid", pChid,
+        "name", pName,
+        "type", IntToIntEnum("DBR", pRecord->type),
+        "count", pRecord->count,
+        "state", IntToIntEnum("ECA", pRecord->stat),
+        "op", IntToIntEnum("CA_OP", pRecord->op),
+        "ctx", CharToPyStringOrBytes(pRecord->message),
+        "file", CharToPyStringOrBytes(pRecord->file),
+        "lineNo", pRecord->lineNo,
+        "repeat", (unsigned long)pRecord->repeat,
+        "timestamp", pRecord->stamp.secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH + pRecord->stamp.nsec * 1e-9
+    );
+}
+
+/*
+    Pop up to max_records records (0 for all queued) and pass them to the registered callbacks,
+    the printf handler receives the message string and the exception callback of the context the dict.
+    Return the number of records drained.
+*/
+static PyObject *Py_ca_drain_log(PyObject *self, PyObject *args, PyObject *kws)
+{
+    unsigned long max_records = 0;
+    const char *kwlist[] = {"max_records", NULL};
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "|k", (char **)kwlist, &max_records))
+        return NULL;
+
+    if (!LOG.initialized)
+        return PyInt_FromLong(0);
+
+    unsigned long drained = 0;
+    while (max_records == 0 || drained < max_records) {
+        size_t pos = LOG.tail;
+        LogRecord *pRecord = &LOG.ring[pos & (LOG_RING_SIZE - 1)];
+        if (epicsAtomicGetSizeT(&pRecord->sequence) != pos + 1)
+            break;
+
+        PyObject *pCallback = NULL;
+        if (pRecord->kind == LOG_PRINTF) {
+            pCallback = pPrintfHandler;
+        } else {
+            /* none if the context was destroyed since */
+            std::map<struct ca_client_context *, struct context_callback>::iterator it;
+            for (it = CONTEXTS.begin(); it != CONTEXTS.end(); ++it) {
+                if (it->second.logGeneration == pRecord->generation) {
+                    pCallback = it->second.pExceptionCallback;
+                    break;
+                }
+            }
+        }
+        PyObject *pArg = NULL;
+        if (pCallback != NULL)
+            pArg = LogRecordToPython(pRecord);
+
+        /* release the record before calling into Python */
+        LOG.tail = pos + 1;
+        epicsAtomicSetSizeT(&pRecord->sequence, pos + LOG_RING_SIZE);
+        drained++;
+
+        if (pArg == NULL) {
+            if (PyErr_Occurred())
+                PyErr_Print();
+            continue;
+        }
+        Py_INCREF(pCallback);
+        PyObject *ret = PyObject_CallFunctionObjArgs(pCallback, pArg, NULL);
+        if (ret == NULL)
+            PyErr_Print();
+        Py_XDECREF(ret);
+        Py_DECREF(pArg);
+        Py_DECREF(pCallback);
+    }
+
+    return PyLong_FromUnsignedLong(drained);
+}
+
+static PyObject *Py_ca_log_stats(PyObject *self, PyObject *args)
+{
+    return Py_BuildValue("{s:k,s:k,s:k,s:k}",
+        "queued", (unsigned long)epicsAtomicGetSizeT(&LOG.queued),
+        "dropped", (unsigned long)epicsAtomicGetSizeT(&LOG.dropped),
+        "suppressed", (unsigned long)epicsAtomicGetSizeT(&LOG.suppressed),
+        "pending", (unsigned long)(epicsAtomicGetSizeT(&LOG.head) - LOG.tail)
+    );
+}
+
 /*******************************************************
  *               CA Synchronous Group                  *
  *******************************************************/
@@ -1850,9 +3629,13 @@ static PyObject *Py_ca_pend(PyObject *self, PyObject *args)
 
     int status;
 
+    TraceSpan span("pend");
     Py_BEGIN_ALLOW_THREADS
     status = ca_pend(timeout, early);
+    span.returned();
     Py_END_ALLOW_THREADS
+    span.end();
+    connect_sweep();
 
     return IntToIntEnum("ECA", status);
 }
@@ -1868,195 +3651,2899 @@ static PyObject *Py_ca_flush_io(PyObject *self, PyObject *args)
     return IntToIntEnum("ECA", status);
 }
 
-static PyObject *Py_ca_pend_io(PyObject *self, PyObject *args)
+static PyObject *Py_ca_pend_io(PyObject *self, PyObject *args)
+{
+    double timeout;
+    if(!PyArg_ParseTuple(args, "d", &timeout))
+        return NULL;
+
+    int status;
+
+    TraceSpan span("pend_io");
+    Py_BEGIN_ALLOW_THREADS
+    status = ca_pend_io(timeout);
+    span.returned();
+    Py_END_ALLOW_THREADS
+    span.end();
+    connect_sweep();
+
+    return IntToIntEnum("ECA", status);
+}
+
+#ifdef CA_FASTCALL
+static PyObject *Py_ca_pend_event(PyObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if (nargs != 1) {
+        PyErr_Format(PyExc_TypeError, "pend_event() takes exactly one argument (%zd given)", nargs);
+        return NULL;
+    }
+    double timeout = PyFloat_AsDouble(args[0]);
+    if (timeout == -1.0 && PyErr_Occurred())
+        return NULL;
+#else
+static PyObject *Py_ca_pend_event(PyObject *self, PyObject *args)
+{
+    double timeout;
+    if(!PyArg_ParseTuple(args, "d", &timeout))
+        return NULL;
+#endif
+
+    int status;
+
+    TraceSpan span("pend_event");
+    Py_BEGIN_ALLOW_THREADS
+    status = ca_pend_event(timeout);
+    span.returned();
+    Py_END_ALLOW_THREADS
+    span.end();
+    connect_sweep();
+
+    return IntToIntEnum("ECA", status);
+}
+
+static PyObject *Py_ca_poll(PyObject *self, PyObject *args)
+{
+    int status;
+
+    TraceSpan span("poll");
+    Py_BEGIN_ALLOW_THREADS
+    status = ca_poll();
+    span.returned();
+    Py_END_ALLOW_THREADS
+    span.end();
+    connect_sweep();
+
+    return IntToIntEnum("ECA", status);
+}
+
+static PyObject *Py_ca_test_io(PyObject *self, PyObject *args)
+{
+    int status;
+
+    Py_BEGIN_ALLOW_THREADS
+    status = ca_test_io();
+    Py_END_ALLOW_THREADS
+
+    return IntToIntEnum("ECA", status);
+}
+
+
+/*******************************************************
+ *                      CA Info                        *
+ *******************************************************/
+
+static PyObject *Py_ca_field_type(PyObject *self, PyObject *pChid)
+{
+    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
+    if (chid == NULL)
+        return NULL;
+
+    chtype field_type;
+    Py_BEGIN_ALLOW_THREADS
+    field_type = ca_field_type(chid);
+    Py_END_ALLOW_THREADS
+
+    return IntToIntEnum("DBF", field_type);
+}
+
+static PyObject *Py_ca_element_count(PyObject *self, PyObject *pChid)
+{
+    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
+    if (chid == NULL)
+        return NULL;
+
+    unsigned long element_count;
+    Py_BEGIN_ALLOW_THREADS
+    element_count = ca_element_count(chid);
+    Py_END_ALLOW_THREADS
+
+    return Py_BuildValue("k", element_count);
+}
+
+static PyObject *Py_ca_name(PyObject *self, PyObject *pChid)
+{
+    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
+    if (chid == NULL)
+        return NULL;
+
+    const char *name;
+    Py_BEGIN_ALLOW_THREADS
+    name = ca_name(chid);
+    Py_END_ALLOW_THREADS
+
+    return CharToPyStringOrBytes(name);
+}
+
+static PyObject *Py_ca_state(PyObject *self, PyObject *pChid)
+{
+    if (pChid == Py_None) {
+        return IntToIntEnum("ChannelState", 4);
+    }
+
+    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
+    if (chid == NULL)
+        return NULL;
+
+    int state;
+    Py_BEGIN_ALLOW_THREADS
+    state = ca_state(chid);
+    Py_END_ALLOW_THREADS
+
+    return IntToIntEnum("ChannelState", state);
+}
+static PyObject *Py_ca_host_name(PyObject *self, PyObject *args)
+{
+    PyObject *pChid;
+    if(!PyArg_ParseTuple(args, "O", &pChid))
+        return NULL;
+
+    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
+    if (chid == NULL)
+        return NULL;
+
+    const char *host;
+    Py_BEGIN_ALLOW_THREADS
+    host = ca_host_name(chid);
+    Py_END_ALLOW_THREADS
+
+    return CharToPyStringOrBytes(host);
+}
+
+static PyObject *Py_ca_read_access(PyObject *self, PyObject *args)
+{
+    PyObject *pChid;
+    if(!PyArg_ParseTuple(args, "O", &pChid))
+        return NULL;
+
+    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
+    if (chid == NULL)
+        return NULL;
+
+    int access;
+    Py_BEGIN_ALLOW_THREADS
+    access = ca_read_access(chid);
+    Py_END_ALLOW_THREADS
+
+    return PyBool_FromLong(access);
+}
+
+static PyObject *Py_ca_write_access(PyObject *self, PyObject *args)
+{
+    PyObject *pChid;
+    if(!PyArg_ParseTuple(args, "O", &pChid))
+        return NULL;
+
+    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
+    if (chid == NULL)
+        return NULL;
+    
+    int access;
+    Py_BEGIN_ALLOW_THREADS
+    access = ca_write_access(chid);
+    Py_END_ALLOW_THREADS
+
+    return PyBool_FromLong(access);
+}
+
+static PyObject *Py_ca_version(PyObject *self, PyObject *args)
+{
+    return CharToPyStringOrBytes(ca_version());
+}
+
+/* extra flags passed by setup.py, e.g. for profile guided optimization */
+#ifndef CACHANNEL_BUILD_FLAGS
+    #define CACHANNEL_BUILD_FLAGS ""
+#endif
+
+static PyObject *Py_ca_build_info(PyObject *self, PyObject *args)
+{
+    char compiler[128];
+#if defined(__clang__)
+    sprintf(compiler, "clang %d.%d.%d", __clang_major__, __clang_minor__, __clang_patchlevel__);
+#elif defined(__GNUC__)
+    sprintf(compiler, "gcc %d.%d.%d", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__);
+#elif defined(_MSC_VER)
+    sprintf(compiler, "msvc %d", _MSC_VER);
+#else
+    strcpy(compiler, "unknown");
+#endif
+
+#ifdef CACHANNEL_PGO
+    PyObject *pPGO = Py_True;
+#else
+    PyObject *pPGO = Py_False;
+#endif
+#ifdef CACHANNEL_LTO
+    PyObject *pLTO = Py_True;
+#else
+    PyObject *pLTO = Py_False;
+#endif
+#ifdef Py_LIMITED_API
+    PyObject *pLimitedAPI = Py_True;
+#else
+    PyObject *pLimitedAPI = Py_False;
+#endif
+#ifdef NDEBUG
+    PyObject *pDebug = Py_False;
+#else
+    PyObject *pDebug = Py_True;
+#endif
+
+    return Py_BuildValue("{s:s,s:s,s:O,s:O,s:s,s:s,s:O,s:O}",
+        "compiler", compiler,
+        "flags", CACHANNEL_BUILD_FLAGS,
+        "pgo", pPGO,
+        "lto", pLTO,
+        "epics", EPICS_VERSION_STRING,
+        "python", PY_VERSION,
+        "limited_api", pLimitedAPI,
+        "debug", pDebug
+    );
+}
+
+static PyObject *ChannelStatsToPython(const ChannelStats *pStats)
+{
+    PyObject *pLastUpdate;
+    size_t seconds = epicsAtomicGetSizeT(&pStats->last_update);
+    if (seconds == 0) {
+        pLastUpdate = Py_None;
+        Py_INCREF(pLastUpdate);
+    } else {
+        pLastUpdate = PyFloat_FromDouble(seconds + POSIX_TIME_AT_EPICS_EPOCH +
+                                         epicsAtomicGetSizeT(&pStats->last_update_nsec) * 1e-9);
+    }
+    return Py_BuildValue("{s:k,s:k,s:k,s:k,s:k,s:k,s:N}",
+        "updates", (unsigned long)epicsAtomicGetSizeT(&pStats->updates),
+        "bytes", (unsigned long)epicsAtomicGetSizeT(&pStats->bytes),
+        "callbacks", (unsigned long)epicsAtomicGetSizeT(&pStats->callbacks),
+        "callback_errors", (unsigned long)epicsAtomicGetSizeT(&pStats->errors),
+        "connects", (unsigned long)epicsAtomicGetSizeT(&pStats->connects),
+        "disconnects", (unsigned long)epicsAtomicGetSizeT(&pStats->disconnects),
+        "last_update", pLastUpdate
+    );
+}
+
+/*
+    Resolve the object of a statistics query: a channel (chid), the channel of a subscription (evid),
+    or a context (the current context if None). Return -1 on error and 0 if there is no current context.
+*/
+static int stats_target(PyObject *pObject, chanId *pChid, struct ca_client_context **ppContext)
+{
+    *pChid = NULL;
+    *ppContext = NULL;
+
+    if (pObject == Py_None) {
+        *ppContext = ca_current_context();
+        return *ppContext != NULL;
+    } else if (CAPSULE_IS(pObject, "ca_client_context")) {
+        *ppContext = (struct ca_client_context *)CAPSULE_EXTRACT(pObject, "ca_client_context");
+    } else if (CAPSULE_IS(pObject, "evid")) {
+        ChannelData *pData = (ChannelData *)CAPSULE_EXTRACT(pObject, "evid");
+        *pChid = ca_evid_to_chid(pData->eventID);
+    } else {
+        *pChid = (chanId) CAPSULE_EXTRACT(pObject, "chid");
+        if (*pChid == NULL)
+            return -1;
+    }
+    return 1;
+}
+
+/*
+    Return the counters of a channel (chid), of the channel of a subscription (evid),
+    or of a context (the current context if None).
+*/
+static PyObject *Py_ca_stats(PyObject *self, PyObject *args)
+{
+    PyObject *pObject = Py_None;
+    if(!PyArg_ParseTuple(args, "|O", &pObject))
+        return NULL;
+
+    chanId chid;
+    struct ca_client_context *pContext;
+    int found = stats_target(pObject, &chid, &pContext);
+    if (found < 0)
+        return NULL;
+    if (found == 0)
+        Py_RETURN_NONE;
+
+    if (chid != NULL) {
+        ChannelData *pChannel = (ChannelData *) ca_puser(chid);
+        if (pChannel == NULL)
+            Py_RETURN_NONE;
+        PyObject *pStats = ChannelStatsToPython(&pChannel->stats);
+        if (pStats != NULL) {
+            PyObject *pName = CharToPyStringOrBytes(ca_name(chid));
+            PyDict_SetItemString(pStats, "name", pName);
+            Py_XDECREF(pName);
+        }
+        return pStats;
+    }
+
+    ContextStats *pStats = ContextStats_get(pContext);
+    PyObject *pTotals = ChannelStatsToPython(&pStats->totals);
+    if (pTotals == NULL)
+        return NULL;
+    PyDict_DelItemString(pTotals, "last_update");
+    PyDict_DelItemString(pTotals, "connects");
+    PyDict_DelItemString(pTotals, "disconnects");
+    return Py_BuildValue("{s:k,s:k,s:k,s:k,s:k,s:k,s:N}",
+        "channels", (unsigned long)epicsAtomicGetSizeT(&pStats->channels),
+        "subscriptions", (unsigned long)epicsAtomicGetSizeT(&pStats->subscriptions),
+        "outstanding_gets", (unsigned long)epicsAtomicGetSizeT(&pStats->outstanding_gets),
+        "outstanding_puts", (unsigned long)epicsAtomicGetSizeT(&pStats->outstanding_puts),
+        "allocations", (unsigned long)epicsAtomicGetSizeT(&pStats->allocations),
+        "live_allocations", (unsigned long)epicsAtomicGetSizeT(&pStats->live_allocations),
+        "totals", pTotals
+    );
+}
+
+static PyObject *Py_ca_enable_latency_stats(PyObject *self, PyObject *args, PyObject *kws)
+{
+    PyObject *pEnable = Py_True;
+    PyObject *pPerChannel = Py_False;
+    const char *kwlist[] = {"enable", "per_channel", NULL};
+
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "|OO", (char **)kwlist, &pEnable, &pPerChannel))
+        return NULL;
+
+    if (!PyObject_IsTrue(pEnable))
+        LATENCY_MODE = LATENCY_OFF;
+    else if (PyObject_IsTrue(pPerChannel))
+        LATENCY_MODE = LATENCY_CHANNEL;
+    else
+        LATENCY_MODE = LATENCY_CONTEXT;
+
+    Py_RETURN_NONE;
+}
+
+/* summary of a histogram, all values in seconds */
+static PyObject *LatencyHistogramToPython(const LatencyHistogram *pHistogram, PyObject *pPercentiles)
+{
+    size_t buckets[LATENCY_BUCKETS];
+    size_t count = 0;
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+        buckets[i] = epicsAtomicGetSizeT(&pHistogram->buckets[i]);
+        count += buckets[i];
+    }
+    double max = epicsAtomicGetSizeT(&pHistogram->max) * 1e-9;
+
+    PyObject *pResult = PyDict_New();
+    PyObject *pValues = PyDict_New();
+    if (pResult == NULL || pValues == NULL) {
+        Py_XDECREF(pResult);
+        Py_XDECREF(pValues);
+        return NULL;
+    }
+    PyDict_SetItemString(pResult, "percentiles", pValues);
+    Py_DECREF(pValues);
+
+    PyObject *pCount = PyLong_FromSize_t(count);
+    PyDict_SetItemString(pResult, "count", pCount);
+    Py_XDECREF(pCount);
+    if (count == 0) {
+        PyDict_SetItemString(pResult, "min", Py_None);
+        PyDict_SetItemString(pResult, "mean", Py_None);
+        PyDict_SetItemString(pResult, "max", Py_None);
+        return pResult;
+    }
+
+    /* the mean is taken at the bucket centers, the minimum at the lower bound of the first bucket */
+    double sum = 0, min = -1;
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+        if (buckets[i] == 0)
+            continue;
+        epicsUInt64 width;
+        epicsUInt64 value = latency_bucket_value(i, &width);
+        if (min < 0)
+            min = value * 1e-9;
+        sum += buckets[i] * (value + (width - 1) / 2.0);
+    }
+    PyObject *pMin = PyFloat_FromDouble(min);
+    PyObject *pMean = PyFloat_FromDouble(MIN(sum / count * 1e-9, max));
+    PyObject *pMax = PyFloat_FromDouble(max);
+    PyDict_SetItemString(pResult, "min", pMin);
+    PyDict_SetItemString(pResult, "mean", pMean);
+    PyDict_SetItemString(pResult, "max", pMax);
+    Py_XDECREF(pMin);
+    Py_XDECREF(pMean);
+    Py_XDECREF(pMax);
+
+    /* a percentile is reported as the highest value of the bucket holding its rank */
+    Py_ssize_t n = PySequence_Size(pPercentiles);
+    for (Py_ssize_t k = 0; k < n; k++) {
+        PyObject *pPercentile = PySequence_GetItem(pPercentiles, k);
+        if (pPercentile == NULL) {
+            Py_DECREF(pResult);
+            return NULL;
+        }
+        double percentile = PyFloat_AsDouble(pPercentile);
+        if (percentile == -1 && PyErr_Occurred()) {
+            Py_DECREF(pPercentile);
+            Py_DECREF(pResult);
+            return NULL;
+        }
+        double rank = percentile / 100.0 * count;
+        size_t seen = 0;
+        double value = max;
+        for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+            seen += buckets[i];
+            if (buckets[i] != 0 && seen >= rank) {
+                epicsUInt64 width;
+                value = MIN((latency_bucket_value(i, &width) + width - 1) * 1e-9, max);
+                break;
+            }
+        }
+        PyObject *pValue = PyFloat_FromDouble(value);
+        PyDict_SetItem(pValues, pPercentile, pValue);
+        Py_XDECREF(pValue);
+        Py_DECREF(pPercentile);
+    }
+    return pResult;
+}
+
+/*
+    Return the callback latency histograms of a channel (chid), of the channel of a subscription (evid),
+    or of a context (the current context if None). None if nothing has been recorded.
+*/
+static PyObject *Py_ca_latency_stats(PyObject *self, PyObject *args, PyObject *kws)
+{
+    PyObject *pObject = Py_None;
+    PyObject *pPercentiles = NULL;
+    PyObject *pReset = Py_False;
+    const char *kwlist[] = {"obj", "percentiles", "reset", NULL};
+
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "|OOO", (char **)kwlist, &pObject, &pPercentiles, &pReset))
+        return NULL;
+
+    if (pPercentiles == NULL || pPercentiles == Py_None) {
+        pPercentiles = Py_BuildValue("(dddd)", 50.0, 90.0, 99.0, 99.9);
+    } else {
+        if (!PySequence_Check(pPercentiles)) {
+            PyErr_SetString(PyExc_TypeError, "percentiles must be a sequence of numbers");
+            return NULL;
+        }
+        Py_INCREF(pPercentiles);
+    }
+    if (pPercentiles == NULL)
+        return NULL;
+
+    chanId chid;
+    struct ca_client_context *pContext;
+    int found = stats_target(pObject, &chid, &pContext);
+    LatencyStats *pLatency = NULL;
+    if (chid != NULL) {
+        ChannelData *pChannel = (ChannelData *) ca_puser(chid);
+        if (pChannel != NULL)
+            pLatency = pChannel->pLatency;
+    } else if (pContext != NULL) {
+        pLatency = ContextStats_get(pContext)->pLatency;
+    }
+    if (found < 0 || pLatency == NULL) {
+        Py_DECREF(pPercentiles);
+        if (found < 0)
+            return NULL;
+        Py_RETURN_NONE;
+    }
+
+    PyObject *pResult = PyDict_New();
+    for (int kind = 0; kind < LATENCY_KINDS && pResult != NULL; kind++) {
+        PyObject *pHistogram = LatencyHistogramToPython(&pLatency->histograms[kind], pPercentiles);
+        if (pHistogram == NULL) {
+            Py_CLEAR(pResult);
+            break;
+        }
+        PyDict_SetItemString(pResult, LATENCY_KIND_NAMES[kind], pHistogram);
+        Py_DECREF(pHistogram);
+    }
+    Py_DECREF(pPercentiles);
+
+    /* the histograms are recorded with the GIL held, so this does not lose concurrent records */
+    if (pResult != NULL && PyObject_IsTrue(pReset))
+        memset(pLatency, 0, sizeof(LatencyStats));
+
+    return pResult;
+}
+
+struct ConnectEntry {
+    ChannelData *pData;
+    double seconds;     /* to connect, or waiting so far */
+    bool operator<(const ConnectEntry &other) const { return seconds > other.seconds; }
+};
+
+struct HostSummary {
+    std::string host;
+    size_t channels;
+    size_t reconnects;
+    double max;
+    double total;
+    double disconnected;
+    bool operator<(const HostSummary &other) const { return max > other.max; }
+};
+
+/*
+    Report the connection timing of the channels of a context, or of all contexts if None:
+    the histogram of the time to first connection, and the n slowest channels and servers.
+    Channels not yet connected are ranked by the time they have been waiting.
+*/
+static PyObject *Py_ca_connect_report(PyObject *self, PyObject *args, PyObject *kws)
+{
+    unsigned int n = 10;
+    PyObject *pObject = Py_None;
+    const char *kwlist[] = {"n", "context", NULL};
+
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "|IO", (char **)kwlist, &n, &pObject))
+        return NULL;
+
+    ContextStats *pFilter = NULL;
+    if (pObject != Py_None) {
+        struct ca_client_context *pContext = (struct ca_client_context *)CAPSULE_EXTRACT(pObject, "ca_client_context");
+        if (pContext == NULL)
+            return NULL;
+        pFilter = ContextStats_get(pContext);
+    }
+
+    connect_sweep();
+    epicsUInt64 now = monotonic_ns();
+
+    /* the histograms are recorded with the GIL held */
+    LatencyHistogram *pMerged = LatencyHistogram_new();
+    std::map<struct ca_client_context*, context_callback>::iterator context;
+    for (context = CONTEXTS.begin(); context != CONTEXTS.end(); ++context) {
+        ContextStats *pStats = context->second.pStats;
+        if (pStats == NULL || pStats->pConnect == NULL || (pFilter != NULL && pStats != pFilter))
+            continue;
+        pMerged->count += pStats->pConnect->count;
+        pMerged->max = MAX(pMerged->max, pStats->pConnect->max);
+        for (unsigned i = 0; i < LATENCY_BUCKETS; i++)
+            pMerged->buckets[i] += pStats->pConnect->buckets[i];
+    }
+
+    std::vector<ConnectEntry> entries;
+    std::map<std::string, HostSummary> hosts;
+    size_t connected = 0, reconnects = 0;
+    std::map<chanId, ChannelData *>::iterator it;
+    for (it = CHANNELS.begin(); it != CHANNELS.end(); ++it) {
+        ChannelData *pData = it->second;
+        if (pFilter != NULL && pData->pContextStats != pFilter)
+            continue;
+        const ConnectTiming &timing = pData->timing;
+        ConnectEntry entry;
+        entry.pData = pData;
+        entry.seconds = ((timing.connected ? timing.connected : now) - timing.created) * 1e-9;
+        entries.push_back(entry);
+        if (timing.connected == 0)
+            continue;
+
+        connected++;
+        reconnects += timing.reconnects;
+        std::string host = ca_host_name(it->first);
+        HostSummary &summary = hosts[host];
+        summary.host = host;
+        summary.channels++;
+        summary.reconnects += timing.reconnects;
+        summary.max = MAX(summary.max, entry.seconds);
+        summary.total += entry.seconds;
+        summary.disconnected += (timing.disconnected_total + (timing.disconnected ? now - timing.disconnected : 0)) * 1e-9;
+    }
+
+    std::sort(entries.begin(), entries.end());
+    PyObject *pSlowest = PyList_New(0);
+    for (size_t i = 0; i < entries.size() && i < n; i++) {
+        const ConnectTiming &timing = entries[i].pData->timing;
+        PyObject *pEntry = Py_BuildValue("{s:N,s:N,s:O,s:d,s:k,s:d}",
+            "name", CharToPyStringOrBytes(ca_name(timing.chid)),
+            "host", CharToPyStringOrBytes(ca_host_name(timing.chid)),
+            "connected", timing.connected ? Py_True : Py_False,
+            "connect_time", entries[i].seconds,
+            "reconnects", (unsigned long)timing.reconnects,
+            "disconnected_time", (timing.disconnected_total + (timing.disconnected ? now - timing.disconnected : 0)) * 1e-9
+        );
+        PyList_Append(pSlowest, pEntry);
+        Py_XDECREF(pEntry);
+    }
+
+    std::vector<HostSummary> summaries;
+    std::map<std::string, HostSummary>::iterator host;
+    for (host = hosts.begin(); host != hosts.end(); ++host)
+        summaries.push_back(host->second);
+    std::sort(summaries.begin(), summaries.end());
+    PyObject *pHosts = PyList_New(0);
+    for (size_t i = 0; i < summaries.size() && i < n; i++) {
+        PyObject *pHost = Py_BuildValue("{s:N,s:k,s:d,s:d,s:k,s:d}",
+            "host", CharToPyStringOrBytes(summaries[i].host.c_str()),
+            "channels", (unsigned long)summaries[i].channels,
+            "max_connect_time", summaries[i].max,
+            "mean_connect_time", summaries[i].total / summaries[i].channels,
+            "reconnects", (unsigned long)summaries[i].reconnects,
+            "disconnected_time", summaries[i].disconnected
+        );
+        PyList_Append(pHosts, pHost);
+        Py_XDECREF(pHost);
+    }
+
+    PyObject *pPercentiles = Py_BuildValue("(dddd)", 50.0, 90.0, 99.0, 99.9);
+    PyObject *pHistogram = LatencyHistogramToPython(pMerged, pPercentiles);
+    Py_XDECREF(pPercentiles);
+    LatencyHistogram_delete(pMerged);
+    if (pHistogram == NULL) {
+        Py_XDECREF(pSlowest);
+        Py_XDECREF(pHosts);
+        return NULL;
+    }
+
+    return Py_BuildValue("{s:k,s:k,s:k,s:k,s:N,s:N,s:N}",
+        "channels", (unsigned long)entries.size(),
+        "connected", (unsigned long)connected,
+        "unconnected", (unsigned long)(entries.size() - connected),
+        "reconnects", (unsigned long)reconnects,
+        "connect_time", pHistogram,
+        "slowest", pSlowest,
+        "hosts", pHosts
+    );
+}
+
+static PyObject *Py_ca_enable_memory_debug(PyObject *self, PyObject *args, PyObject *kws)
+{
+    PyObject *pEnable = Py_True;
+    int depth = 1;
+    const char *kwlist[] = {"enable", "depth", NULL};
+
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "|Oi", (char **)kwlist, &pEnable, &depth))
+        return NULL;
+
+    if (PyObject_IsTrue(pEnable)) {
+        MEMORY_DEBUG_DEPTH = MAX(1, depth);
+    } else {
+        MEMORY_DEBUG_DEPTH = 0;
+        MEMORY_SITES.clear();
+    }
+
+    Py_RETURN_NONE;
+}
+
+struct SiteSummary {
+    const std::string *pSite;
+    int kind;
+    size_t count;
+    size_t bytes;
+    bool operator<(const SiteSummary &other) const { return bytes > other.bytes; }
+};
+
+static PyObject *Py_ca_memory_stats(PyObject *self, PyObject *args, PyObject *kws)
+{
+    int n = 10;
+    const char *kwlist[] = {"n", NULL};
+
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "|i", (char **)kwlist, &n))
+        return NULL;
+
+    PyObject *pResult = PyDict_New();
+    if (pResult == NULL)
+        return NULL;
+
+    size_t count = 0, bytes = 0;
+    for (int kind = 0; kind < MEMORY_KINDS; kind++) {
+        MemoryCounter *pCounter = &MEMORY[kind];
+        size_t kind_count = epicsAtomicGetSizeT(&pCounter->count);
+        size_t kind_bytes = epicsAtomicGetSizeT(&pCounter->bytes);
+        PyObject *pKind = Py_BuildValue("{s:k,s:k,s:k,s:k}",
+            "count", (unsigned long)kind_count,
+            "bytes", (unsigned long)kind_bytes,
+            "peak_bytes", (unsigned long)epicsAtomicGetSizeT(&pCounter->peak_bytes),
+            "allocations", (unsigned long)epicsAtomicGetSizeT(&pCounter->allocations)
+        );
+        if (pKind == NULL) {
+            Py_DECREF(pResult);
+            return NULL;
+        }
+        PyDict_SetItemString(pResult, MEMORY_KIND_NAMES[kind], pKind);
+        Py_DECREF(pKind);
+        count += kind_count;
+        bytes += kind_bytes;
+    }
+
+    PyObject *pSites = Py_None;
+    Py_INCREF(Py_None);
+    if (MEMORY_DEBUG_DEPTH > 0) {
+        /* group the outstanding objects by site and kind, largest first */
+        std::map<std::pair<std::string, int>, size_t> index;
+        std::vector<SiteSummary> summaries;
+        std::map<const void*, MemorySite>::const_iterator it;
+        for (it = MEMORY_SITES.begin(); it != MEMORY_SITES.end(); ++it) {
+            std::pair<std::string, int> key(it->second.site, it->second.kind);
+            std::map<std::pair<std::string, int>, size_t>::iterator found = index.find(key);
+            if (found == index.end()) {
+                SiteSummary summary = {&it->second.site, it->second.kind, 0, 0};
+                found = index.insert(std::make_pair(key, summaries.size())).first;
+                summaries.push_back(summary);
+            }
+            summaries[found->second].count += 1;
+            summaries[found->second].bytes += it->second.bytes;
+        }
+        std::sort(summaries.begin(), summaries.end());
+
+        Py_DECREF(pSites);
+        pSites = PyList_New(0);
+        for (size_t i = 0; i < summaries.size() && i < (size_t)MAX(0, n); i++) {
+            PyObject *pSite = Py_BuildValue("{s:N,s:s,s:k,s:k}",
+                "site", CharToPyStringOrBytes(summaries[i].pSite->c_str()),
+                "kind", MEMORY_KIND_NAMES[summaries[i].kind],
+                "count", (unsigned long)summaries[i].count,
+                "bytes", (unsigned long)summaries[i].bytes
+            );
+            if (pSite != NULL) {
+                PyList_Append(pSites, pSite);
+                Py_DECREF(pSite);
+            }
+        }
+    }
+
+    PyObject *pCount = PyLong_FromSize_t(count);
+    PyObject *pBytes = PyLong_FromSize_t(bytes);
+    PyDict_SetItemString(pResult, "count", pCount);
+    PyDict_SetItemString(pResult, "bytes", pBytes);
+    PyDict_SetItemString(pResult, "sites", pSites);
+    Py_XDECREF(pCount);
+    Py_XDECREF(pBytes);
+    Py_XDECREF(pSites);
+
+    return pResult;
+}
+
+/*
+    Start tracing. The events recorded since the previous trace_start are discarded.
+*/
+static PyObject *Py_ca_trace_start(PyObject *self, PyObject *args)
+{
+    if (TRACE.lock == NULL) {
+        TRACE.lock = epicsMutexMustCreate();
+        TRACE.key = epicsThreadPrivateCreate();
+    }
+    TRACE.origin = monotonic_ns();
+    epicsAtomicIncrSizeT(&TRACE.epoch);
+    TRACE.enabled = 1;
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *Py_ca_trace_stop(PyObject *self, PyObject *args)
+{
+    TRACE.enabled = 0;
+
+    Py_RETURN_NONE;
+}
+
+static void trace_write_string(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            fprintf(fp, "\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            fprintf(fp, "\\u%04x", *str);
+        else
+            fputc(*str, fp);
+    }
+    fputc('"', fp);
+}
+
+/*
+    Write the recorded events to path in the Chrome trace event format, which chrome://tracing
+    and https://ui.perfetto.dev load. Return the number of events written.
+    Events recorded while writing may be inconsistent, stop tracing first to avoid that.
+*/
+static PyObject *Py_ca_trace_dump(PyObject *self, PyObject *args)
+{
+    const char *path;
+    if(!PyArg_ParseTuple(args, "s", &path))
+        return NULL;
+
+    if (TRACE.lock == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "tracing has not been started");
+        return NULL;
+    }
+
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+        return PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
+
+    size_t written = 0;
+    size_t epoch = epicsAtomicGetSizeT(&TRACE.epoch);
+
+    Py_BEGIN_ALLOW_THREADS
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    epicsMutexMustLock(TRACE.lock);
+    for (TraceBuffer *pBuffer = TRACE.buffers; pBuffer != NULL; pBuffer = pBuffer->next) {
+        fprintf(fp, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":",
+                pBuffer == TRACE.buffers ? "" : ",\n", (unsigned long)pBuffer->tid);
+        trace_write_string(fp, pBuffer->thread_name);
+        fprintf(fp, "}}");
+
+        if (pBuffer->epoch != epoch)
+            continue;
+        size_t head = epicsAtomicGetSizeT(&pBuffer->head);
+        size_t first = head > TRACE_BUFFER_SIZE ? head - TRACE_BUFFER_SIZE : 0;
+        for (size_t i = first; i < head; i++) {
+            const TraceEvent *pEvent = &pBuffer->events[i % TRACE_BUFFER_SIZE];
+            if (pEvent->ts < TRACE.origin)
+                continue;
+            fprintf(fp, ",\n{\"ph\":\"%c\",\"cat\":\"ca\",\"name\":\"%s\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f",
+                    pEvent->phase, pEvent->name, (unsigned long)pBuffer->tid, (pEvent->ts - TRACE.origin) * 1e-3);
+            if (pEvent->phase == 'X')
+                fprintf(fp, ",\"dur\":%.3f", pEvent->dur * 1e-3);
+            else if (pEvent->phase == 'i')
+                fprintf(fp, ",\"s\":\"t\"");
+            else
+                fprintf(fp, ",\"id\":\"%p\"", pEvent->id);
+            if (pEvent->pv[0]) {
+                fprintf(fp, ",\"args\":{\"pv\":");
+                trace_write_string(fp, pEvent->pv);
+                fputc('}', fp);
+            }
+            fputc('}', fp);
+            written++;
+        }
+    }
+    epicsMutexUnlock(TRACE.lock);
+    fprintf(fp, "\n]}\n");
+    Py_END_ALLOW_THREADS
+
+    if (fclose(fp) != 0)
+        return PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
+
+    return PyLong_FromSize_t(written);
+}
+
+/*******************************************************
+ *                    Benchmark                        *
+ *******************************************************/
+
+/*
+    Test only entry points which run the conversion code over synthetic buffers, without network.
+    Allocations are counted by hooking the Python memory and object allocators. This is not possible
+    before Python 3.5 and with the limited API, and does not see numpy data buffers.
+*/
+#if PY_VERSION_HEX >= 0x03050000 && !defined(Py_LIMITED_API)
+#define BENCH_COUNT_ALLOCATIONS
+
+static size_t BENCH_ALLOCATIONS = 0;
+static PyMemAllocatorEx BENCH_ALLOCATORS[2];
+static const PyMemAllocatorDomain BENCH_DOMAINS[2] = {PYMEM_DOMAIN_MEM, PYMEM_DOMAIN_OBJ};
+
+static void *bench_malloc(void *ctx, size_t size)
+{
+    PyMemAllocatorEx *pAllocator = (PyMemAllocatorEx *)ctx;
+    BENCH_ALLOCATIONS++;
+    return pAllocator->malloc(pAllocator->ctx, size);
+}
+
+static void *bench_calloc(void *ctx, size_t nelem, size_t elsize)
+{
+    PyMemAllocatorEx *pAllocator = (PyMemAllocatorEx *)ctx;
+    BENCH_ALLOCATIONS++;
+    return pAllocator->calloc(pAllocator->ctx, nelem, elsize);
+}
+
+static void *bench_realloc(void *ctx, void *ptr, size_t new_size)
+{
+    PyMemAllocatorEx *pAllocator = (PyMemAllocatorEx *)ctx;
+    if (ptr == NULL)
+        BENCH_ALLOCATIONS++;
+    return pAllocator->realloc(pAllocator->ctx, ptr, new_size);
+}
+
+static void bench_free(void *ctx, void *ptr)
+{
+    PyMemAllocatorEx *pAllocator = (PyMemAllocatorEx *)ctx;
+    pAllocator->free(pAllocator->ctx, ptr);
+}
+
+/* the GIL is held throughout the measurement, so the counter needs no atomics */
+static void bench_hook_allocators(bool enable)
+{
+    for (int i = 0; i < 2; i++) {
+        if (enable) {
+            PyMem_GetAllocator(BENCH_DOMAINS[i], &BENCH_ALLOCATORS[i]);
+            PyMemAllocatorEx hook = {&BENCH_ALLOCATORS[i], bench_malloc, bench_calloc, bench_realloc, bench_free};
+            PyMem_SetAllocator(BENCH_DOMAINS[i], &hook);
+        } else {
+            PyMem_SetAllocator(BENCH_DOMAINS[i], &BENCH_ALLOCATORS[i]);
+        }
+    }
+}
+#endif
+
+/* a DBR buffer with the element values 0, 1, 2 ... */
+static void *bench_buffer(chtype dbrtype, unsigned long count)
+{
+    char *pBuffer = (char *)calloc(1, dbr_size_n(dbrtype, count));
+    if (pBuffer == NULL)
+        return NULL;
+
+    if (dbr_type_is_TIME(dbrtype)) {
+        epicsTimeGetCurrent(&((struct dbr_time_double *)pBuffer)->stamp);
+    } else if (dbrtype == DBR_GR_ENUM || dbrtype == DBR_CTRL_ENUM) {
+        struct dbr_gr_enum *pEnum = (struct dbr_gr_enum *)pBuffer;
+        pEnum->no_str = 4;
+        for (int i = 0; i < pEnum->no_str; i++)
+            sprintf(pEnum->strs[i], "state %d", i);
+    }
+
+    void *pValue = dbr_value_ptr(pBuffer, dbrtype);
+    for (unsigned long i = 0; i < count; i++) {
+        switch (dbrtype % (LAST_TYPE + 1)) {
+        case DBR_STRING:
+            sprintf(((dbr_string_t *)pValue)[i], "%lu", i);
+            break;
+        case DBR_SHORT:
+            ((dbr_short_t *)pValue)[i] = (dbr_short_t)i;
+            break;
+        case DBR_FLOAT:
+            ((dbr_float_t *)pValue)[i] = (dbr_float_t)i;
+            break;
+        case DBR_ENUM:
+            ((dbr_enum_t *)pValue)[i] = (dbr_enum_t)(i % 4);
+            break;
+        case DBR_CHAR:
+            ((dbr_char_t *)pValue)[i] = (dbr_char_t)(i % 128);
+            break;
+        case DBR_LONG:
+            ((dbr_long_t *)pValue)[i] = (dbr_long_t)i;
+            break;
+        case DBR_DOUBLE:
+            ((dbr_double_t *)pValue)[i] = (dbr_double_t)i;
+            break;
+        }
+    }
+    return pBuffer;
+}
+
+static PyObject *bench_result(epicsUInt64 elapsed, size_t allocations, unsigned long n)
+{
+#ifdef BENCH_COUNT_ALLOCATIONS
+    return Py_BuildValue("{s:d,s:d}",
+        "ns_per_op", (double)elapsed / n,
+        "allocations_per_op", (double)allocations / n);
+#else
+    return Py_BuildValue("{s:d,s:O}",
+        "ns_per_op", (double)elapsed / n,
+        "allocations_per_op", Py_None);
+#endif
+}
+
+/*
+    Decode a synthetic buffer of dbrtype and count n times, as a get or monitor callback does.
+    If callback_args is True, the complete callback argument is built.
+*/
+static PyObject *Py_ca_bench_decode(PyObject *self, PyObject *args, PyObject *kws)
+{
+    chtype dbrtype;
+    unsigned long count = 1;
+    unsigned long n = 1000;
+    PyObject *pUseNumpy = Py_False;
+    PyObject *pCallbackArgs = Py_False;
+    const char *kwlist[] = {"dbrtype", "count", "n", "use_numpy", "callback_args", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kws, "l|kkOO", (char **)kwlist,
+                &dbrtype, &count, &n, &pUseNumpy, &pCallbackArgs))
+        return NULL;
+
+    if (dbrtype < DBR_STRING || dbrtype > DBR_CTRL_DOUBLE) {
+        PyErr_SetString(PyExc_ValueError, "dbrtype must be one of the plain, STS, TIME, GR or CTRL types");
+        return NULL;
+    }
+    if (count < 1 || n < 1) {
+        PyErr_SetString(PyExc_ValueError, "count and n must be positive");
+        return NULL;
+    }
+    bool use_numpy = PyObject_IsTrue(pUseNumpy) == 1;
+    bool callback_args = PyObject_IsTrue(pCallbackArgs) == 1;
+
+    void *pBuffer = bench_buffer(dbrtype, count);
+    if (pBuffer == NULL)
+        return PyErr_NoMemory();
+
+    /* the channel identifier is only wrapped, never dereferenced */
+    struct event_handler_args event;
+    memset(&event, 0, sizeof(event));
+    event.chid = (chanId)pBuffer;
+    event.type = dbrtype;
+    event.count = count;
+    event.dbr = pBuffer;
+    event.status = ECA_NORMAL;
+
+    size_t allocations = 0;
+#ifdef BENCH_COUNT_ALLOCATIONS
+    BENCH_ALLOCATIONS = 0;
+    bench_hook_allocators(true);
+#endif
+    epicsUInt64 start = monotonic_ns();
+    for (unsigned long i = 0; i < n; i++) {
+        PyObject *pValue;
+        if (callback_args)
+            pValue = EventCallbackArgs(event, use_numpy);
+        else
+            pValue = CBufferToPythonDict(dbrtype, count, pBuffer, use_numpy);
+        if (pValue == NULL)
+            break;
+        Py_DECREF(pValue);
+    }
+    epicsUInt64 elapsed = monotonic_ns() - start;
+#ifdef BENCH_COUNT_ALLOCATIONS
+    bench_hook_allocators(false);
+    allocations = BENCH_ALLOCATIONS;
+#endif
+
+    free(pBuffer);
+    if (PyErr_Occurred())
+        return NULL;
+    return bench_result(elapsed, allocations, n);
+}
+
+/*
+    Encode value n times into a buffer, as a put to a channel of native dbrtype and count does.
+    The count defaults to the length of a sequence value.
+*/
+static PyObject *Py_ca_bench_encode(PyObject *self, PyObject *args, PyObject *kws)
+{
+    PyObject *pValue;
+    chtype native_type;
+    PyObject *pCount = Py_None;
+    unsigned long n = 1000;
+    const char *kwlist[] = {"value", "dbrtype", "count", "n", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kws, "Ol|Ok", (char **)kwlist,
+                &pValue, &native_type, &pCount, &n))
+        return NULL;
+
+    if (!dbr_type_is_plain(native_type)) {
+        PyErr_SetString(PyExc_ValueError, "dbrtype must be a plain type");
+        return NULL;
+    }
+    if (n < 1) {
+        PyErr_SetString(PyExc_ValueError, "n must be positive");
+        return NULL;
+    }
+    unsigned long native_count = 1;
+    if (pCount != Py_None) {
+        native_count = PyObjectToULong(pCount);
+        if (PyErr_Occurred())
+            return NULL;
+    } else if (PySequence_Check(pValue) && !PyUnicode_Check(pValue) && !PyBytes_Check(pValue)) {
+        native_count = (unsigned long)PySequence_Length(pValue);
+    } else if (PyUnicode_Check(pValue) || PyBytes_Check(pValue)) {
+        native_count = (unsigned long)PySequence_Length(pValue) + 1;
+    }
+
+    size_t allocations = 0;
+#ifdef BENCH_COUNT_ALLOCATIONS
+    BENCH_ALLOCATIONS = 0;
+    bench_hook_allocators(true);
+#endif
+    epicsUInt64 start = monotonic_ns();
+    for (unsigned long i = 0; i < n; i++) {
+        chtype dbrtype = native_type;
+        unsigned long count = native_count;
+        void *pBuffer = PythonToCBuffer(pValue, Py_None, Py_None, dbrtype, count);
+        if (pBuffer == NULL)
+            break;
+        free(pBuffer);
+    }
+    epicsUInt64 elapsed = monotonic_ns() - start;
+#ifdef BENCH_COUNT_ALLOCATIONS
+    bench_hook_allocators(false);
+    allocations = BENCH_ALLOCATIONS;
+#endif
+
+    if (PyErr_Occurred())
+        return NULL;
+    return bench_result(elapsed, allocations, n);
+}
+
+/*******************************************************
+ *                  Monitor recorder                   *
+ *******************************************************/
+
+/*
+    Subscriptions created with a recorder append their updates to memory-mapped segment files on the
+    CA thread, without the GIL. A segment <prefix>-NNNNNN.carec is created at its full size, filled with
+    records and truncated to the used size when sealed. Segments and records are in native byte order,
+    records are 8-byte aligned:
+
+        RecorderRecordHeader    size, channel, dbrtype, severity, count, value time stamp, receive time
+        payload                 the DBR buffer as received, or the name of a channel record
+
+    A channel record precedes the first update of a channel in every segment, so that each segment can
+    be read on its own. A record size of 0 ends a segment which was not sealed.
+
+    A sealed segment has an index <prefix>-NNNNNN.caidx with the name and update offsets of each channel:
+
+        magic[8], channels (u32), sequence (u32)
+        for each channel: channel (u32), name length (u16), name, updates (u32), offsets (u32 * updates)
+*/
+#define RECORDER_MAGIC          "CAREC01"
+#define RECORDER_INDEX_MAGIC    "CAIDX01"
+#define RECORDER_CHANNEL        0xFFFF      /* dbrtype of a channel record */
+#define RECORDER_ALIGN(size)    (((size) + 7) & ~(size_t)7)
+
+struct RecorderSegmentHeader {
+    char magic[8];
+    epicsUInt32 header_size;
+    epicsUInt32 sequence;
+    epicsUInt64 created;        /* ns since the POSIX epoch */
+};
+
+struct RecorderRecordHeader {
+    epicsUInt32 size;           /* bytes of header, payload and padding */
+    epicsUInt32 channel;        /* channel number of the recorder */
+    epicsUInt16 dbrtype;
+    epicsUInt16 severity;
+    epicsUInt32 count;          /* elements, or the name length of a channel record */
+    epicsUInt32 seconds;        /* value time stamp, EPICS epoch */
+    epicsUInt32 nanoseconds;
+    epicsUInt64 received;       /* ns since the POSIX epoch */
+};
+
+struct MappedFile {
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+    char *data;
+    size_t size;
+};
+
+/* create path with size bytes mapped for writing, set errno on failure */
+static bool mapped_file_create(MappedFile *pFile, const char *path, size_t size)
+{
+    pFile->size = size;
+#ifdef _WIN32
+    pFile->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (pFile->file == INVALID_HANDLE_VALUE) {
+        errno = EACCES;
+        return false;
+    }
+    pFile->mapping = CreateFileMappingA(pFile->file, NULL, PAGE_READWRITE,
+                                        (DWORD)((epicsUInt64)size >> 32), (DWORD)size, NULL);
+    pFile->data = pFile->mapping ? (char *)MapViewOfFile(pFile->mapping, FILE_MAP_WRITE, 0, 0, size) : NULL;
+    if (pFile->data == NULL) {
+        if (pFile->mapping)
+            CloseHandle(pFile->mapping);
+        CloseHandle(pFile->file);
+        errno = ENOSPC;
+        return false;
+    }
+#else
+    pFile->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (pFile->fd < 0)
+        return false;
+    if (ftruncate(pFile->fd, size) != 0) {
+        close(pFile->fd);
+        return false;
+    }
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, pFile->fd, 0);
+    if (data == MAP_FAILED) {
+        close(pFile->fd);
+        return false;
+    }
+    pFile->data = (char *)data;
+#endif
+    return true;
+}
+
+/* unmap and truncate to the used bytes */
+static void mapped_file_close(MappedFile *pFile, size_t used)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(pFile->data);
+    CloseHandle(pFile->mapping);
+    LARGE_INTEGER length;
+    length.QuadPart = used;
+    SetFilePointerEx(pFile->file, length, NULL, FILE_BEGIN);
+    SetEndOfFile(pFile->file);
+    CloseHandle(pFile->file);
+#else
+    munmap(pFile->data, pFile->size);
+    if (ftruncate(pFile->fd, used) != 0)
+        perror("CaChannel recorder");
+    close(pFile->fd);
+#endif
+    pFile->data = NULL;
+}
+
+struct Recorder {
+    size_t refcount;                /* the user until recorder_close, and every subscription */
+    epicsMutexId lock;
+    std::string prefix;
+    size_t segment_size;
+    bool open;                      /* a segment is mapped */
+    bool closed;
+    MappedFile file;
+    size_t used;                    /* bytes used in the current segment */
+    epicsUInt32 sequence;           /* number of the next segment */
+    std::vector<std::string> channels;
+    std::map<std::string, epicsUInt32> channel_numbers;
+    std::vector<std::vector<epicsUInt32> > offsets;    /* update offsets in the current segment */
+    std::vector<bool> defined;      /* channel record written to the current segment */
+    size_t records;
+    size_t bytes;
+    size_t dropped;
+    size_t segments;
+    size_t index_errors;            /* sealed segments without a complete index */
+    int error;                      /* errno of the last failure to create a segment or an index */
+};
+
+static std::string recorder_path(const Recorder *pRecorder, epicsUInt32 sequence, const char *extension)
+{
+    char suffix[32];
+    sprintf(suffix, "-%06u.%s", (unsigned)sequence, extension);
+    return pRecorder->prefix + suffix;
+}
+
+static epicsUInt64 recorder_now()
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    return ((epicsUInt64)now.secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH) * 1000000000u + now.nsec;
+}
+
+/* the following functions are called with the lock held */
+static bool recorder_segment_open(Recorder *pRecorder)
+{
+    std::string path = recorder_path(pRecorder, pRecorder->sequence, "carec");
+    if (!mapped_file_create(&pRecorder->file, path.c_str(), pRecorder->segment_size)) {
+        pRecorder->error = errno;
+        return false;
+    }
+    RecorderSegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RECORDER_MAGIC, sizeof(header.magic));
+    header.header_size = sizeof(header);
+    header.sequence = pRecorder->sequence;
+    header.created = recorder_now();
+    memcpy(pRecorder->file.data, &header, sizeof(header));
+
+    pRecorder->used = RECORDER_ALIGN(sizeof(header));
+    pRecorder->offsets.assign(pRecorder->channels.size(), std::vector<epicsUInt32>());
+    pRecorder->defined.assign(pRecorder->channels.size(), false);
+    pRecorder->open = true;
+    pRecorder->segments++;
+    return true;
+}
+
+static void recorder_segment_seal(Recorder *pRecorder)
+{
+    if (!pRecorder->open)
+        return;
+    mapped_file_close(&pRecorder->file, pRecorder->used);
+    pRecorder->open = false;
+
+    /* without the index the segment is still read by a sequential scan */
+    std::string path = recorder_path(pRecorder, pRecorder->sequence, "caidx");
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (fp == NULL) {
+        pRecorder->error = errno;
+        pRecorder->index_errors++;
+    } else {
+        epicsUInt32 channels = 0;
+        for (size_t i = 0; i < pRecorder->defined.size(); i++)
+            channels += pRecorder->defined[i];
+        fwrite(RECORDER_INDEX_MAGIC, 1, 8, fp);
+        fwrite(&channels, sizeof(channels), 1, fp);
+        fwrite(&pRecorder->sequence, sizeof(pRecorder->sequence), 1, fp);
+        for (epicsUInt32 channel = 0; channel < pRecorder->defined.size(); channel++) {
+            if (!pRecorder->defined[channel])
+                continue;
+            const std::string &name = pRecorder->channels[channel];
+            const std::vector<epicsUInt32> &offsets = pRecorder->offsets[channel];
+            epicsUInt16 length = (epicsUInt16)name.size();
+            epicsUInt32 updates = (epicsUInt32)offsets.size();
+            fwrite(&channel, sizeof(channel), 1, fp);
+            fwrite(&length, sizeof(length), 1, fp);
+            fwrite(name.data(), 1, length, fp);
+            fwrite(&updates, sizeof(updates), 1, fp);
+            if (updates > 0)
+                fwrite(&offsets[0], sizeof(epicsUInt32), updates, fp);
+        }
+        bool failed = ferror(fp) != 0;
+        if (fclose(fp) != 0 || failed) {
+            pRecorder->error = errno;
+            pRecorder->index_errors++;
+        }
+    }
+    pRecorder->sequence++;
+}
+
+static void recorder_append(Recorder *pRecorder, const RecorderRecordHeader &header, const void *payload, size_t size)
+{
+    char *pRecord = pRecorder->file.data + pRecorder->used;
+    memcpy(pRecord + sizeof(header), payload, size);
+    /* the header last, a reader of an unsealed segment stops at a zero size */
+    memcpy(pRecord, &header, sizeof(header));
+    pRecorder->used += header.size;
+}
+
+/* append an update, called on the CA thread without the GIL */
+static void recorder_write(Recorder *pRecorder, epicsUInt32 channel, const struct event_handler_args &args)
+{
+    if (args.status != ECA_NORMAL || args.dbr == NULL)
+        return;
+
+    RecorderRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    size_t payload = dbr_size_n(args.type, args.count);
+    header.size = (epicsUInt32)RECORDER_ALIGN(sizeof(header) + payload);
+    header.channel = channel;
+    header.dbrtype = (epicsUInt16)args.type;
+    header.count = (epicsUInt32)args.count;
+    header.received = recorder_now();
+    if (args.type >= DBR_STS_STRING && args.type <= DBR_CTRL_DOUBLE)
+        header.severity = ((const struct dbr_sts_char *)args.dbr)->severity;
+    if (dbr_type_is_TIME(args.type)) {
+        header.seconds = ((const struct dbr_time_char *)args.dbr)->stamp.secPastEpoch;
+        header.nanoseconds = ((const struct dbr_time_char *)args.dbr)->stamp.nsec;
+    }
+
+    epicsMutexMustLock(pRecorder->lock);
+    const std::string &name = pRecorder->channels[channel];
+    RecorderRecordHeader define;
+    memset(&define, 0, sizeof(define));
+    define.size = (epicsUInt32)RECORDER_ALIGN(sizeof(define) + name.size());
+    define.channel = channel;
+    define.dbrtype = RECORDER_CHANNEL;
+    define.count = (epicsUInt32)name.size();
+    define.received = header.received;
+
+    bool ok = !pRecorder->closed;
+    if (ok && pRecorder->open) {
+        size_t needed = header.size + (pRecorder->defined[channel] ? 0 : define.size);
+        if (pRecorder->used + needed > pRecorder->file.size)
+            recorder_segment_seal(pRecorder);
+    }
+    if (ok && !pRecorder->open)
+        ok = recorder_segment_open(pRecorder);
+    /* an update larger than a segment */
+    if (ok && pRecorder->used + header.size + define.size > pRecorder->file.size && !pRecorder->defined[channel])
+        ok = false;
+    if (ok && pRecorder->used + header.size > pRecorder->file.size)
+        ok = false;
+
+    if (ok) {
+        if (!pRecorder->defined[channel]) {
+            recorder_append(pRecorder, define, name.data(), name.size());
+            pRecorder->defined[channel] = true;
+        }
+        pRecorder->offsets[channel].push_back((epicsUInt32)pRecorder->used);
+        recorder_append(pRecorder, header, args.dbr, payload);
+        pRecorder->records++;
+        pRecorder->bytes += header.size;
+    } else {
+        pRecorder->dropped++;
+    }
+    epicsMutexUnlock(pRecorder->lock);
+}
+
+/* the channel number of name, called with the GIL held */
+static epicsUInt32 recorder_add_channel(Recorder *pRecorder, const char *name)
+{
+    epicsMutexMustLock(pRecorder->lock);
+    std::map<std::string, epicsUInt32>::iterator it = pRecorder->channel_numbers.find(name);
+    epicsUInt32 channel;
+    if (it != pRecorder->channel_numbers.end()) {
+        channel = it->second;
+    } else {
+        channel = (epicsUInt32)pRecorder->channels.size();
+        pRecorder->channels.push_back(name);
+        pRecorder->channel_numbers[name] = channel;
+        pRecorder->offsets.resize(pRecorder->channels.size());
+        pRecorder->defined.resize(pRecorder->channels.size(), false);
+    }
+    epicsAtomicIncrSizeT(&pRecorder->refcount);
+    epicsMutexUnlock(pRecorder->lock);
+    return channel;
+}
+
+static void Recorder_release(Recorder *pRecorder)
+{
+    if (pRecorder != NULL && epicsAtomicDecrSizeT(&pRecorder->refcount) == 0) {
+        epicsMutexDestroy(pRecorder->lock);
+        delete pRecorder;
+    }
+}
+
+/* seal the last segment, the subscriptions writing to it drop their updates from now on */
+static void recorder_close(void *ptr)
+{
+    Recorder *pRecorder = (Recorder *)ptr;
+    Py_BEGIN_ALLOW_THREADS
+    epicsMutexMustLock(pRecorder->lock);
+    recorder_segment_seal(pRecorder);
+    pRecorder->closed = true;
+    epicsMutexUnlock(pRecorder->lock);
+    Py_END_ALLOW_THREADS
+
+    Recorder_release(pRecorder);
+}
+
+static PyObject *Py_ca_recorder_open(PyObject *self, PyObject *args, PyObject *kws)
+{
+    const char *prefix;
+    unsigned long segment_size = 64 * 1024 * 1024;
+    const char *kwlist[] = {"prefix", "segment_size", NULL};
+
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "s|k", (char **)kwlist, &prefix, &segment_size))
+        return NULL;
+
+    /* the index stores 32 bit offsets */
+    if (segment_size < 4096 || segment_size > 0xFFFFFFFFul) {
+        PyErr_SetString(PyExc_ValueError, "segment_size must be between 4 KiB and 4 GiB");
+        return NULL;
+    }
+
+    Recorder *pRecorder = new Recorder();
+    pRecorder->refcount = 1;
+    pRecorder->lock = epicsMutexMustCreate();
+    pRecorder->prefix = prefix;
+    pRecorder->segment_size = segment_size;
+    pRecorder->open = false;
+    pRecorder->closed = false;
+    pRecorder->used = 0;
+    pRecorder->sequence = 0;
+    pRecorder->records = pRecorder->bytes = pRecorder->dropped = pRecorder->segments = 0;
+    pRecorder->index_errors = 0;
+    pRecorder->error = 0;
+
+    /* create the first segment now to report an unusable path */
+    if (!recorder_segment_open(pRecorder)) {
+        std::string path = recorder_path(pRecorder, 0, "carec");
+        errno = pRecorder->error;
+        Recorder_release(pRecorder);
+        return PyErr_SetFromErrnoWithFilename(PyExc_IOError, path.c_str());
+    }
+
+    return handle_new(&RECORDER_HANDLE, pRecorder);
+}
+
+static PyObject *Py_ca_recorder_close(PyObject *self, PyObject *args)
+{
+    return handle_close_capsule(args, &RECORDER_HANDLE);
+}
+
+static PyObject *Py_ca_recorder_stats(PyObject *self, PyObject *args)
+{
+    PyObject *pObject;
+    if(!PyArg_ParseTuple(args, "O", &pObject))
+        return NULL;
+
+    Recorder *pRecorder = handle_object<Recorder>(pObject, &RECORDER_HANDLE);
+    if (pRecorder == NULL)
+        return NULL;
+
+    epicsMutexMustLock(pRecorder->lock);
+    std::string segment = pRecorder->open ? recorder_path(pRecorder, pRecorder->sequence, "carec") : "";
+    PyObject *pStats = Py_BuildValue("{s:k,s:k,s:k,s:k,s:k,s:k,s:k,s:N}",
+        "records", (unsigned long)pRecorder->records,
+        "bytes", (unsigned long)pRecorder->bytes,
+        "dropped", (unsigned long)pRecorder->dropped,
+        "segments", (unsigned long)pRecorder->segments,
+        "index_errors", (unsigned long)pRecorder->index_errors,
+        "segment_used", (unsigned long)(pRecorder->open ? pRecorder->used : 0),
+        "channels", (unsigned long)pRecorder->channels.size(),
+        "segment", CharToPyStringOrBytes(segment.c_str())
+    );
+    epicsMutexUnlock(pRecorder->lock);
+
+    return pStats;
+}
+
+/* read a segment file into data, set errno on failure */
+static bool recorder_read_segment(const char *path, std::vector<char> &data)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return false;
+    data.clear();
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+        data.insert(data.end(), chunk, chunk + n);
+    bool ok = !ferror(fp);
+    fclose(fp);
+    return ok;
+}
+
+struct ReplayState {
+    PyObject *pCallback;            /* callable, or dict of channel name to callable */
+    std::set<std::string> channels; /* channels to replay, all if empty */
+    double speed;                   /* 0 to replay as fast as possible */
+    bool use_numpy;
+    bool started;
+    epicsUInt64 first_received;     /* receive time of the first update */
+    epicsUInt64 start;              /* monotonic time of the first update */
+    size_t records;
+    size_t callbacks;
+    size_t segments;
+};
+
+/* replay the updates of a segment, return false with an exception set */
+static bool replay_segment(ReplayState *pState, const char *path, const std::vector<char> &data)
+{
+    RecorderSegmentHeader segment;
+    if (data.size() < sizeof(segment) ||
+            memcmp(data.data(), RECORDER_MAGIC, sizeof(segment.magic)) != 0) {
+        PyErr_Format(PyExc_ValueError, "%s is not a recorder segment", path);
+        return false;
+    }
+    memcpy(&segment, data.data(), sizeof(segment));
+
+    std::map<epicsUInt32, std::string> names;
+    size_t offset = RECORDER_ALIGN(segment.header_size);
+    while (offset + sizeof(RecorderRecordHeader) <= data.size()) {
+        RecorderRecordHeader header;
+        memcpy(&header, &data[offset], sizeof(header));
+        /* the end of a segment which was not sealed */
+        if (header.size == 0)
+            break;
+        const char *payload = &data[offset] + sizeof(header);
+        size_t size = header.size - sizeof(header);
+        if (header.size < sizeof(header) || offset + header.size > data.size() ||
+                (header.dbrtype != RECORDER_CHANNEL && (!dbr_type_is_valid(header.dbrtype) ||
+                    dbr_size_n(header.dbrtype, header.count) > size))) {
+            PyErr_Format(PyExc_ValueError, "%s has a corrupt record at offset %lu", path, (unsigned long)offset);
+            return false;
+        }
+        offset += header.size;
+
+        if (header.dbrtype == RECORDER_CHANNEL) {
+            names[header.channel] = std::string(payload, MIN((size_t)header.count, size));
+            continue;
+        }
+        const std::string &name = names[header.channel];
+        if (!pState->channels.empty() && pState->channels.find(name) == pState->channels.end())
+            continue;
+
+        PyObject *pCallback = pState->pCallback;
+        if (PyDict_Check(pCallback)) {
+            PyObject *pName = CharToPyStringOrBytes(name.c_str());
+            pCallback = PyDict_GetItem(pState->pCallback, pName);
+            Py_XDECREF(pName);
+            if (pCallback == NULL)
+                continue;
+        }
+
+        /* wait for the original arrival time relative to the first update */
+        if (!pState->started) {
+            pState->started = true;
+            pState->first_received = header.received;
+            pState->start = monotonic_ns();
+        } else if (pState->speed > 0 && header.received > pState->first_received) {
+            epicsUInt64 due = pState->start + (epicsUInt64)((header.received - pState->first_received) / pState->speed);
+            epicsUInt64 now = monotonic_ns();
+            if (due > now) {
+                Py_BEGIN_ALLOW_THREADS
+                epicsThreadSleep((due - now) * 1e-9);
+                Py_END_ALLOW_THREADS
+                if (PyErr_CheckSignals() != 0)
+                    return false;
+            }
+        }
+        pState->records++;
+
+        /* the decoding and dispatch of a monitor callback, without a channel */
+        struct event_handler_args args;
+        memset(&args, 0, sizeof(args));
+        args.type = header.dbrtype;
+        args.count = header.count;
+        args.dbr = payload;
+        args.status = ECA_NORMAL;
+        PyObject *pArgs = EventCallbackArgs(args, pState->use_numpy);
+        if (pArgs == NULL)
+            return false;
+        PyObject *pName = CharToPyStringOrBytes(name.c_str());
+        PyObject *pReceived = PyFloat_FromDouble(header.received * 1e-9);
+        PyDict_SetItemString(pArgs, "name", pName);
+        PyDict_SetItemString(pArgs, "received", pReceived);
+        Py_XDECREF(pName);
+        Py_XDECREF(pReceived);
+
+        PyObject *ret = call_callback(pCallback, pArgs);
+        Py_DECREF(pArgs);
+        if (ret == NULL)
+            return false;
+        Py_DECREF(ret);
+        pState->callbacks++;
+    }
+    pState->segments++;
+    return true;
+}
+
+/*
+    Replay the updates of a recorder segment file, or of all segments <file>-NNNNNN.carec of a recorder prefix,
+    through the decoding and callback path of monitors. The original inter-arrival times are divided by speed,
+    speed None or "max" replays as fast as possible.
+*/
+static PyObject *Py_ca_replay(PyObject *self, PyObject *args, PyObject *kws)
+{
+    const char *file;
+    PyObject *pCallback;
+    PyObject *pSpeed = NULL;
+    PyObject *pChannels = Py_None;
+    bool use_numpy = false;
+    const char *kwlist[] = {"file", "callback", "speed", "channels", "use_numpy", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kws, "sO|OOb", (char **)kwlist,
+                &file, &pCallback, &pSpeed, &pChannels, &use_numpy))
+        return NULL;
+
+    if (!PyCallable_Check(pCallback) && !PyDict_Check(pCallback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable or a dict of channel names to callables");
+        return NULL;
+    }
+
+    ReplayState state;
+    state.pCallback = pCallback;
+    state.speed = 1.0;
+    state.use_numpy = use_numpy;
+    state.started = false;
+    state.first_received = state.start = 0;
+    state.records = state.callbacks = state.segments = 0;
+
+    if (pSpeed == NULL) {
+        ;
+    } else if (pSpeed == Py_None) {
+        state.speed = 0;
+    } else if (PyUnicode_Check(pSpeed) || PyBytes_Check(pSpeed)) {
+        PyObject *pMax = CharToPyStringOrBytes("max");
+        int is_max = PyObject_RichCompareBool(pSpeed, pMax, Py_EQ);
+        Py_XDECREF(pMax);
+        if (is_max != 1) {
+            PyErr_SetString(PyExc_ValueError, "speed must be a positive number or 'max'");
+            return NULL;
+        }
+        state.speed = 0;
+    } else {
+        state.speed = PyFloat_AsDouble(pSpeed);
+        if (PyErr_Occurred())
+            return NULL;
+        if (state.speed <= 0) {
+            PyErr_SetString(PyExc_ValueError, "speed must be a positive number or 'max'");
+            return NULL;
+        }
+    }
+
+    if (pChannels != Py_None) {
+        PyObject *pIter = PyObject_GetIter(pChannels);
+        if (pIter == NULL)
+            return NULL;
+        PyObject *pItem;
+        while ((pItem = PyIter_Next(pIter)) != NULL) {
+            PyObject *pBytes = PyUnicode_Check(pItem) ? PyUnicode_AsUTF8String(pItem) : (Py_INCREF(pItem), pItem);
+            Py_DECREF(pItem);
+            if (pBytes == NULL || !PyBytes_Check(pBytes)) {
+                Py_XDECREF(pBytes);
+                Py_DECREF(pIter);
+                if (!PyErr_Occurred())
+                    PyErr_SetString(PyExc_TypeError, "channels must be channel names");
+                return NULL;
+            }
+            state.channels.insert(PyBytes_AsString(pBytes));
+            Py_DECREF(pBytes);
+        }
+        Py_DECREF(pIter);
+        if (PyErr_Occurred())
+            return NULL;
+    }
+
+    /* a single segment, or the segments of a prefix in sequence */
+    std::vector<std::string> paths;
+    size_t length = strlen(file);
+    if (length > 6 && strcmp(file + length - 6, ".carec") == 0) {
+        paths.push_back(file);
+    } else {
+        for (unsigned sequence = 0; ; sequence++) {
+            char suffix[32];
+            sprintf(suffix, "-%06u.carec", sequence);
+            std::string path = std::string(file) + suffix;
+            FILE *fp = fopen(path.c_str(), "rb");
+            if (fp == NULL)
+                break;
+            fclose(fp);
+            paths.push_back(path);
+        }
+        if (paths.empty()) {
+            errno = ENOENT;
+            return PyErr_SetFromErrnoWithFilename(PyExc_IOError, (std::string(file) + "-000000.carec").c_str());
+        }
+    }
+
+    epicsUInt64 start = monotonic_ns();
+    std::vector<char> data;
+    for (size_t i = 0; i < paths.size(); i++) {
+        bool ok;
+        Py_BEGIN_ALLOW_THREADS
+        ok = recorder_read_segment(paths[i].c_str(), data);
+        Py_END_ALLOW_THREADS
+        if (!ok)
+            return PyErr_SetFromErrnoWithFilename(PyExc_IOError, paths[i].c_str());
+        if (!replay_segment(&state, paths[i].c_str(), data))
+            return NULL;
+    }
+    double seconds = (monotonic_ns() - start) * 1e-9;
+
+    return Py_BuildValue("{s:k,s:k,s:k,s:d,s:d}",
+        "segments", (unsigned long)state.segments,
+        "records", (unsigned long)state.records,
+        "callbacks", (unsigned long)state.callbacks,
+        "seconds", seconds,
+        "rate", seconds > 0 ? state.callbacks / seconds : 0.0
+    );
+}
+
+/*******************************************************
+ *                  Shared memory                      *
+ *******************************************************/
+
+/*
+    A publisher writes the latest update of its subscriptions into a shared memory region, on the CA thread
+    without the GIL, for other processes on the host to read. The region is laid out as
+
+        ShmHeader
+        ShmIndexEntry * slots       channel name of each slot, the first header.channels are used
+        slot * slots                ShmSlotHeader and the DBR buffer, slot_size bytes each
+
+    Each slot is guarded by a sequence lock: the publisher makes the sequence odd while it writes
+    and even when done, a reader copies the slot and retries if the sequence was odd or has changed.
+*/
+#define SHM_MAGIC           "CASHM01"
+#define SHM_NAME_SIZE       120
+#define SHM_ALIGN(size)     (((size) + 63) & ~(size_t)63)
+
+#ifdef _MSC_VER
+    #define SHM_FENCE() MemoryBarrier()
+#else
+    #define SHM_FENCE() __sync_synchronize()
+#endif
+
+struct ShmHeader {
+    char magic[8];
+    epicsUInt32 header_size;
+    epicsUInt32 slots;
+    epicsUInt32 slot_size;
+    volatile epicsUInt32 channels;  /* slots in use, incremented after the index entry is written */
+    epicsUInt64 created;            /* ns since the POSIX epoch */
+    epicsUInt64 pid;
+};
+
+struct ShmIndexEntry {
+    char name[SHM_NAME_SIZE];
+    epicsUInt32 slot;
+    epicsUInt32 reserved;
+};
+
+struct ShmSlotHeader {
+    volatile epicsUInt32 sequence;  /* odd while written, 0 if never written */
+    epicsUInt16 dbrtype;
+    epicsUInt16 reserved;
+    epicsUInt32 count;
+    epicsUInt32 size;               /* bytes of the DBR buffer */
+    epicsUInt64 updates;
+    epicsUInt64 received;           /* ns since the POSIX epoch */
+};
+
+struct SharedMemory {
+    size_t refcount;                /* the user until shm_close, and every subscription of a publisher */
+    bool publisher;
+    epicsMutexId lock;              /* serializes the writers of a publisher */
+    std::string name;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+    char *data;
+    size_t size;
+    /* the layout, copied from the header once validated, a reader does not trust the header after attach */
+    epicsUInt32 slots;
+    epicsUInt32 slot_size;
+    std::map<std::string, epicsUInt32> slot_numbers;
+    size_t updates;
+    size_t truncated;               /* updates with elements that did not fit a slot */
+    size_t dropped;                 /* updates with a header that did not fit a slot */
+};
+
+static ShmHeader *shm_header(const SharedMemory *pShm)
+{
+    return (ShmHeader *)pShm->data;
+}
+
+static ShmIndexEntry *shm_index(const SharedMemory *pShm, epicsUInt32 slot)
+{
+    return (ShmIndexEntry *)(pShm->data + SHM_ALIGN(sizeof(ShmHeader))) + slot;
+}
+
+static ShmSlotHeader *shm_slot(const SharedMemory *pShm, epicsUInt32 slot)
+{
+    return (ShmSlotHeader *)(pShm->data + SHM_ALIGN(sizeof(ShmHeader)) +
+            SHM_ALIGN(pShm->slots * sizeof(ShmIndexEntry)) + (size_t)slot * pShm->slot_size);
+}
+
+static size_t shm_region_size(epicsUInt32 slots, epicsUInt32 slot_size)
+{
+    return SHM_ALIGN(sizeof(ShmHeader)) + SHM_ALIGN(slots * sizeof(ShmIndexEntry)) + (size_t)slots * slot_size;
+}
+
+/* POSIX shared memory object names start with a slash */
+static std::string shm_object_name(const char *name)
+{
+#ifdef _WIN32
+    return name;
+#else
+    return name[0] == '/' ? std::string(name) : std::string("/") + name;
+#endif
+}
+
+#ifndef _WIN32
+/* whether the object is the region of a publisher which exited without shm_close */
+static bool shm_is_stale(const char *object)
+{
+    int fd = shm_open(object, O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    ShmHeader header;
+    bool stale = read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+        memcmp(header.magic, SHM_MAGIC, sizeof(header.magic)) == 0 &&
+        kill((pid_t)header.pid, 0) != 0 && errno == ESRCH;
+    close(fd);
+    return stale;
+}
+#endif
+
+/* create or open and map the region, set errno on failure */
+static bool shm_map(SharedMemory *pShm, size_t size)
+{
+    std::string object = shm_object_name(pShm->name.c_str());
+#ifdef _WIN32
+    if (pShm->publisher) {
+        pShm->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                           (DWORD)((epicsUInt64)size >> 32), (DWORD)size, object.c_str());
+        /* never take over the region of another publisher */
+        if (pShm->mapping != NULL && GetLastError() == ERROR_ALREADY_EXISTS) {
+            CloseHandle(pShm->mapping);
+            errno = EEXIST;
+            return false;
+        }
+    } else {
+        pShm->mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, object.c_str());
+    }
+    if (pShm->mapping == NULL) {
+        errno = ENOENT;
+        return false;
+    }
+    pShm->data = (char *)MapViewOfFile(pShm->mapping, pShm->publisher ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+    if (pShm->data == NULL) {
+        CloseHandle(pShm->mapping);
+        errno = ENOMEM;
+        return false;
+    }
+    if (size == 0) {
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(pShm->data, &info, sizeof(info));
+        size = info.RegionSize;
+    }
+#else
+    /* never resize the region of another publisher under its readers, only replace it if that publisher is gone */
+    int fd = shm_open(object.c_str(), pShm->publisher ? O_RDWR | O_CREAT | O_EXCL : O_RDONLY, 0644);
+    if (fd < 0 && pShm->publisher && errno == EEXIST && shm_is_stale(object.c_str())) {
+        shm_unlink(object.c_str());
+        fd = shm_open(object.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    }
+    if (fd < 0)
+        return false;
+    if (pShm->publisher) {
+        if (ftruncate(fd, size) != 0) {
+            close(fd);
+            shm_unlink(object.c_str());
+            return false;
+        }
+    } else {
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            return false;
+        }
+        size = info.st_size;
+    }
+    void *data = size == 0 ? MAP_FAILED :
+        mmap(NULL, size, pShm->publisher ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        if (size == 0)
+            errno = EINVAL;
+        if (pShm->publisher)
+            shm_unlink(object.c_str());
+        return false;
+    }
+    pShm->data = (char *)data;
+#endif
+    pShm->size = size;
+    return true;
+}
+
+static void shm_unmap(SharedMemory *pShm)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(pShm->data);
+    CloseHandle(pShm->mapping);
+#else
+    munmap(pShm->data, pShm->size);
+    if (pShm->publisher)
+        shm_unlink(shm_object_name(pShm->name.c_str()).c_str());
+#endif
+    pShm->data = NULL;
+}
+
+/* publish an update, called on the CA thread without the GIL */
+static void shm_write(SharedMemory *pShm, epicsUInt32 slot, const struct event_handler_args &args)
+{
+    if (args.status != ECA_NORMAL || args.dbr == NULL || !dbr_type_is_valid(args.type))
+        return;
+
+    epicsMutexMustLock(pShm->lock);
+    if (pShm->data == NULL) {
+        epicsMutexUnlock(pShm->lock);
+        return;
+    }
+    ShmSlotHeader *pSlot = shm_slot(pShm, slot);
+    size_t capacity = pShm->slot_size - sizeof(ShmSlotHeader);
+    unsigned long count = args.count;
+    if (capacity < dbr_size[args.type]) {
+        pShm->dropped++;
+        epicsMutexUnlock(pShm->lock);
+        return;
+    }
+    if (dbr_size_n(args.type, count) > capacity) {
+        /* the leading elements of an array which does not fit */
+        count = (capacity - dbr_size[args.type]) / dbr_value_size[args.type] + 1;
+        pShm->truncated++;
+    }
+    size_t size = dbr_size_n(args.type, count);
+
+    epicsUInt32 sequence = pSlot->sequence;
+    pSlot->sequence = sequence + 1;
+    SHM_FENCE();
+    pSlot->dbrtype = (epicsUInt16)args.type;
+    pSlot->count = (epicsUInt32)count;
+    pSlot->size = (epicsUInt32)size;
+    pSlot->updates++;
+    pSlot->received = recorder_now();
+    memcpy(pSlot + 1, args.dbr, size);
+    SHM_FENCE();
+    pSlot->sequence = sequence + 2;
+
+    pShm->updates++;
+    epicsMutexUnlock(pShm->lock);
+}
+
+/* the slot of channel name, or -1 with an exception set, called with the GIL held */
+static long shm_add_channel(SharedMemory *pShm, const char *name)
+{
+    if (!pShm->publisher) {
+        PyErr_SetString(PyExc_ValueError, "shared memory is attached for reading");
+        return -1;
+    }
+    if (strlen(name) >= SHM_NAME_SIZE) {
+        PyErr_Format(PyExc_ValueError, "channel name longer than %d characters", SHM_NAME_SIZE - 1);
+        return -1;
+    }
+    epicsMutexMustLock(pShm->lock);
+    ShmHeader *pHeader = shm_header(pShm);
+    std::map<std::string, epicsUInt32>::iterator it = pShm->slot_numbers.find(name);
+    long slot;
+    if (it != pShm->slot_numbers.end()) {
+        slot = it->second;
+    } else if (pHeader->channels < pShm->slots) {
+        slot = pHeader->channels;
+        ShmIndexEntry *pEntry = shm_index(pShm, slot);
+        strcpy(pEntry->name, name);
+        pEntry->slot = slot;
+        pShm->slot_numbers[name] = slot;
+        /* readers see the index entry before the count */
+        SHM_FENCE();
+        pHeader->channels = slot + 1;
+    } else {
+        slot = -1;
+    }
+    if (slot >= 0)
+        epicsAtomicIncrSizeT(&pShm->refcount);
+    epicsMutexUnlock(pShm->lock);
+
+    if (slot < 0)
+        PyErr_Format(PyExc_ValueError, "all %u slots of shared memory %s are in use",
+                     (unsigned)pShm->slots, pShm->name.c_str());
+    return slot;
+}
+
+static void SharedMemory_release(SharedMemory *pShm)
+{
+    if (pShm != NULL && epicsAtomicDecrSizeT(&pShm->refcount) == 0) {
+        epicsMutexDestroy(pShm->lock);
+        delete pShm;
+    }
+}
+
+/* unmap, and remove the region of a publisher */
+static void shm_close(void *ptr)
+{
+    SharedMemory *pShm = (SharedMemory *)ptr;
+    /* the writers on CA threads do not need the GIL */
+    epicsMutexMustLock(pShm->lock);
+    shm_unmap(pShm);
+    epicsMutexUnlock(pShm->lock);
+    SharedMemory_release(pShm);
+}
+
+static SharedMemory *SharedMemory_new(const char *name, bool publisher)
+{
+    SharedMemory *pShm = new SharedMemory();
+    pShm->refcount = 1;
+    pShm->publisher = publisher;
+    pShm->lock = epicsMutexMustCreate();
+    pShm->name = name;
+    pShm->data = NULL;
+    pShm->size = 0;
+    pShm->slots = pShm->slot_size = 0;
+    pShm->updates = pShm->truncated = pShm->dropped = 0;
+    return pShm;
+}
+
+static PyObject *Py_ca_shm_create(PyObject *self, PyObject *args, PyObject *kws)
+{
+    const char *name;
+    unsigned int slots = 256;
+    unsigned int slot_size = 4096;
+    const char *kwlist[] = {"name", "slots", "slot_size", NULL};
+
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "s|II", (char **)kwlist, &name, &slots, &slot_size))
+        return NULL;
+
+    if (slots < 1 || slots > 65536) {
+        PyErr_SetString(PyExc_ValueError, "slots must be between 1 and 65536");
+        return NULL;
+    }
+    if (slot_size < 64 || slot_size > 64 * 1024 * 1024) {
+        PyErr_SetString(PyExc_ValueError, "slot_size must be between 64 bytes and 64 MiB");
+        return NULL;
+    }
+    slot_size = (epicsUInt32)SHM_ALIGN(slot_size);
+
+    SharedMemory *pShm = SharedMemory_new(name, true);
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = shm_map(pShm, shm_region_size(slots, slot_size));
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        SharedMemory_release(pShm);
+        return PyErr_SetFromErrnoWithFilename(PyExc_IOError, name);
+    }
+
+    ShmHeader *pHeader = shm_header(pShm);
+    memset(pShm->data, 0, pShm->size);
+    pHeader->header_size = SHM_ALIGN(sizeof(ShmHeader));
+    pHeader->slots = pShm->slots = slots;
+    pHeader->slot_size = pShm->slot_size = slot_size;
+    pHeader->created = recorder_now();
+#ifdef _WIN32
+    pHeader->pid = GetCurrentProcessId();
+#else
+    pHeader->pid = getpid();
+#endif
+    /* the magic last, a reader never sees a partial header */
+    SHM_FENCE();
+    memcpy(pHeader->magic, SHM_MAGIC, sizeof(pHeader->magic));
+
+    return handle_new(&SHM_HANDLE, pShm);
+}
+
+static PyObject *Py_ca_shm_attach(PyObject *self, PyObject *args)
+{
+    const char *name;
+    if(!PyArg_ParseTuple(args, "s", &name))
+        return NULL;
+
+    SharedMemory *pShm = SharedMemory_new(name, false);
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = shm_map(pShm, 0);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        SharedMemory_release(pShm);
+        return PyErr_SetFromErrnoWithFilename(PyExc_IOError, name);
+    }
+
+    /* the layout must be the one shm_create writes, the offsets are computed from this validated copy */
+    ShmHeader header;
+    memset(&header, 0, sizeof(header));
+    if (pShm->size >= sizeof(header))
+        memcpy(&header, pShm->data, sizeof(header));
+    if (memcmp(header.magic, SHM_MAGIC, sizeof(header.magic)) != 0 ||
+            header.header_size != SHM_ALIGN(sizeof(ShmHeader)) ||
+            header.slots < 1 || header.slots > 65536 ||
+            header.slot_size < 64 || header.slot_size > 64 * 1024 * 1024 ||
+            header.slot_size != SHM_ALIGN(header.slot_size) ||
+            pShm->size < shm_region_size(header.slots, header.slot_size)) {
+        shm_unmap(pShm);
+        SharedMemory_release(pShm);
+        PyErr_Format(PyExc_ValueError, "%s is not a published shared memory", name);
+        return NULL;
+    }
+    pShm->slots = header.slots;
+    pShm->slot_size = header.slot_size;
+
+    return handle_new(&SHM_HANDLE, pShm);
+}
+
+static PyObject *Py_ca_shm_close(PyObject *self, PyObject *args)
+{
+    return handle_close_capsule(args, &SHM_HANDLE);
+}
+
+static PyObject *Py_ca_shm_channels(PyObject *self, PyObject *args)
+{
+    PyObject *pObject;
+    if(!PyArg_ParseTuple(args, "O", &pObject))
+        return NULL;
+
+    SharedMemory *pShm = handle_object<SharedMemory>(pObject, &SHM_HANDLE);
+    if (pShm == NULL)
+        return NULL;
+
+    const ShmHeader *pHeader = shm_header(pShm);
+    epicsUInt32 channels = MIN(pHeader->channels, pShm->slots);
+    SHM_FENCE();
+    PyObject *pList = PyList_New(channels);
+    for (epicsUInt32 slot = 0; slot < channels; slot++) {
+        char name[SHM_NAME_SIZE];
+        strncpy(name, shm_index(pShm, slot)->name, SHM_NAME_SIZE);
+        name[SHM_NAME_SIZE - 1] = '\0';
+        PyList_SetItem(pList, slot, CharToPyStringOrBytes(name));
+    }
+    return pList;
+}
+
+/*
+    a consistent copy of a slot, or None if never written. A publisher which died while writing leaves
+    the sequence odd, the reader gives up after SHM_READ_TIMEOUT seconds.
+*/
+#define SHM_READ_TIMEOUT    1.0
+
+static PyObject *shm_read_slot(SharedMemory *pShm, epicsUInt32 slot, bool use_numpy, std::vector<char> &buffer)
+{
+    size_t capacity = pShm->slot_size - sizeof(ShmSlotHeader);
+    ShmSlotHeader header;
+    buffer.resize(capacity);
+    epicsUInt64 deadline = 0;
+    for (unsigned attempt = 0; ; attempt++) {
+        const ShmSlotHeader *pSlot = shm_slot(pShm, slot);
+        epicsUInt32 sequence = pSlot->sequence;
+        SHM_FENCE();
+        if (sequence == 0)
+            Py_RETURN_NONE;
+        if ((sequence & 1) == 0) {
+            memcpy(&header, (const void *)pSlot, sizeof(header));
+            if (header.size <= capacity)
+                memcpy(&buffer[0], pSlot + 1, header.size);
+            SHM_FENCE();
+            if (pSlot->sequence == sequence && header.size <= capacity)
+                break;
+        }
+        /* the publisher is writing the slot, spin briefly before yielding the GIL */
+        if (attempt < 100)
+            continue;
+        epicsUInt64 now = monotonic_ns();
+        if (deadline == 0) {
+            deadline = now + (epicsUInt64)(SHM_READ_TIMEOUT * 1e9);
+        } else if (now >= deadline) {
+            PyErr_Format(PyExc_IOError, "slot %u of shared memory %s is not released by its publisher",
+                         (unsigned)slot, pShm->name.c_str());
+            return NULL;
+        }
+        /* another thread may close the shared memory meanwhile */
+        epicsAtomicIncrSizeT(&pShm->refcount);
+        Py_BEGIN_ALLOW_THREADS
+        epicsThreadSleep(0.001);
+        Py_END_ALLOW_THREADS
+        bool closed = pShm->data == NULL;
+        SharedMemory_release(pShm);
+        if (closed) {
+            PyErr_SetString(PyExc_ValueError, "shared memory is closed");
+            return NULL;
+        }
+        if (PyErr_CheckSignals() != 0)
+            return NULL;
+    }
+
+    /* the slot may have been written by something other than a publisher */
+    if (!dbr_type_is_valid(header.dbrtype) ||
+            dbr_size_n(header.dbrtype, header.count) != header.size) {
+        PyErr_Format(PyExc_ValueError, "slot %u of shared memory %s is corrupt",
+                     (unsigned)slot, pShm->name.c_str());
+        return NULL;
+    }
+
+    PyObject *pValue = CBufferToPythonDict(header.dbrtype, header.count, &buffer[0], use_numpy);
+    if (pValue == NULL)
+        return NULL;
+    return Py_BuildValue("{s:N,s:k,s:N,s:K,s:d}",
+        "type", IntToIntEnum("DBR", header.dbrtype),
+        "count", (unsigned long)header.count,
+        "value", pValue,
+        "updates", (unsigned PY_LONG_LONG)header.updates,
+        "received", header.received * 1e-9
+    );
+}
+
+/*
+    The latest update of channel name, or a dict of all channels if name is None.
+*/
+static PyObject *Py_ca_shm_read(PyObject *self, PyObject *args, PyObject *kws)
+{
+    PyObject *pObject;
+    const char *name = NULL;
+    bool use_numpy = false;
+    const char *kwlist[] = {"shm", "name", "use_numpy", NULL};
+
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "O|zb", (char **)kwlist, &pObject, &name, &use_numpy))
+        return NULL;
+
+    SharedMemory *pShm = handle_object<SharedMemory>(pObject, &SHM_HANDLE);
+    if (pShm == NULL)
+        return NULL;
+
+    const ShmHeader *pHeader = shm_header(pShm);
+    epicsUInt32 channels = MIN(pHeader->channels, pShm->slots);
+    SHM_FENCE();
+
+    std::vector<char> buffer;
+    PyObject *pDict = name == NULL ? PyDict_New() : NULL;
+    for (epicsUInt32 slot = 0; slot < channels; slot++) {
+        const ShmIndexEntry *pEntry = shm_index(pShm, slot);
+        if (name != NULL && strncmp(pEntry->name, name, SHM_NAME_SIZE) != 0)
+            continue;
+        PyObject *pValue = shm_read_slot(pShm, slot, use_numpy, buffer);
+        if (name != NULL || pValue == NULL) {
+            Py_XDECREF(pDict);
+            return pValue;
+        }
+        char entry_name[SHM_NAME_SIZE];
+        strncpy(entry_name, pEntry->name, SHM_NAME_SIZE);
+        entry_name[SHM_NAME_SIZE - 1] = '\0';
+        PyObject *pName = CharToPyStringOrBytes(entry_name);
+        PyDict_SetItem(pDict, pName, pValue);
+        Py_XDECREF(pName);
+        Py_DECREF(pValue);
+    }
+    if (name != NULL) {
+        PyErr_Format(PyExc_KeyError, "%s", name);
+        return NULL;
+    }
+    return pDict;
+}
+
+static PyObject *Py_ca_shm_stats(PyObject *self, PyObject *args)
+{
+    PyObject *pObject;
+    if(!PyArg_ParseTuple(args, "O", &pObject))
+        return NULL;
+
+    SharedMemory *pShm = handle_object<SharedMemory>(pObject, &SHM_HANDLE);
+    if (pShm == NULL)
+        return NULL;
+
+    const ShmHeader *pHeader = shm_header(pShm);
+    epicsMutexMustLock(pShm->lock);
+    PyObject *pStats = Py_BuildValue("{s:O,s:I,s:I,s:I,s:k,s:k,s:k,s:K}",
+        "publisher", pShm->publisher ? Py_True : Py_False,
+        "slots", (unsigned int)pShm->slots,
+        "slot_size", (unsigned int)pShm->slot_size,
+        "channels", (unsigned int)pHeader->channels,
+        "updates", (unsigned long)pShm->updates,
+        "truncated", (unsigned long)pShm->truncated,
+        "dropped", (unsigned long)pShm->dropped,
+        "pid", (unsigned PY_LONG_LONG)pHeader->pid
+    );
+    epicsMutexUnlock(pShm->lock);
+
+    return pStats;
+}
+
+/*******************************************************
+ *                      Sampler                        *
+ *******************************************************/
+
+/*
+    A sampler keeps the last few DBR_TIME updates of its subscriptions, on the CA thread without the GIL.
+    A sample at time t takes for every channel the latest update with a time stamp not after t. If that
+    is older than the tolerance, or there is none, the value is NaN. Samples are taken on demand or every
+    period by a timer thread and appended to columns of values, time stamps and severities.
+    Times are kept as nanoseconds since the POSIX epoch, a double of seconds resolves only about 0.25 us.
+*/
+#define SAMPLER_HISTORY 4
+
+/* the nanoseconds of a missing time stamp, numpy.datetime64('NaT') */
+#define SAMPLER_NO_STAMP (-9223372036854775807LL - 1)
+
+struct SamplerUpdate {
+    double value;
+    epicsInt64 stamp_ns;        /* POSIX nanoseconds */
+    epicsInt16 severity;
+};
+
+struct SamplerChannel {
+    std::string name;
+    SamplerUpdate history[SAMPLER_HISTORY];
+    size_t updates;             /* history[updates % SAMPLER_HISTORY] is the next to write */
+    std::vector<double> values;
+    std::vector<epicsInt64> stamps_ns;
+    std::vector<epicsInt16> severities;
+};
+
+struct Sampler {
+    size_t refcount;            /* the user until sampler_close, the timer thread and every subscription */
+    epicsMutexId lock;
+    double period;              /* seconds, 0 for samples on demand only */
+    double tolerance;           /* seconds, negative for no limit */
+    std::vector<SamplerChannel> channels;
+    std::map<std::string, size_t> channel_numbers;
+    std::vector<epicsInt64> times;  /* the sample times, POSIX nanoseconds */
+    size_t stale;
+    volatile bool stop;
+    epicsEventId wakeup;
+    epicsEventId exited;
+};
+
+static epicsInt64 sampler_now()
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    return StampNanoseconds(now);
+}
+
+/* POSIX seconds of nanoseconds, NaN for a missing time stamp */
+static double sampler_seconds(epicsInt64 ns)
+{
+    if (ns == SAMPLER_NO_STAMP)
+        return Py_NAN;
+    /* whole seconds apart, the fraction keeps the best resolution of a double */
+    epicsInt64 seconds = ns / 1000000000;
+    return (double)seconds + (ns - seconds * 1000000000) * 1e-9;
+}
+
+/* keep an update, called on the CA thread without the GIL */
+static void sampler_update(Sampler *pSampler, size_t channel, const struct event_handler_args &args)
+{
+    if (args.status != ECA_NORMAL || args.dbr == NULL || !dbr_type_is_TIME(args.type))
+        return;
+
+    const struct dbr_time_char *pTime = (const struct dbr_time_char *)args.dbr;
+    SamplerUpdate update;
+    update.stamp_ns = StampNanoseconds(pTime->stamp);
+    update.severity = pTime->severity;
+    switch (args.type) {
+    case DBR_TIME_SHORT:
+        update.value = ((const struct dbr_time_short *)args.dbr)->value;
+        break;
+    case DBR_TIME_FLOAT:
+        update.value = ((const struct dbr_time_float *)args.dbr)->value;
+        break;
+    case DBR_TIME_ENUM:
+        update.value = ((const struct dbr_time_enum *)args.dbr)->value;
+        break;
+    case DBR_TIME_CHAR:
+        update.value = ((const struct dbr_time_char *)args.dbr)->value;
+        break;
+    case DBR_TIME_LONG:
+        update.value = ((const struct dbr_time_long *)args.dbr)->value;
+        break;
+    case DBR_TIME_DOUBLE:
+        update.value = ((const struct dbr_time_double *)args.dbr)->value;
+        break;
+    default:
+        update.value = strtod(((const struct dbr_time_string *)args.dbr)->value, NULL);
+        break;
+    }
+
+    epicsMutexMustLock(pSampler->lock);
+    SamplerChannel &data = pSampler->channels[channel];
+    data.history[data.updates++ % SAMPLER_HISTORY] = update;
+    epicsMutexUnlock(pSampler->lock);
+}
+
+/* append a sample at time t, called with the lock held */
+static void sampler_sample(Sampler *pSampler, epicsInt64 t)
+{
+    pSampler->times.push_back(t);
+    for (size_t i = 0; i < pSampler->channels.size(); i++) {
+        SamplerChannel &data = pSampler->channels[i];
+        const SamplerUpdate *pUpdate = NULL;
+        size_t kept = MIN(data.updates, (size_t)SAMPLER_HISTORY);
+        for (size_t n = 1; n <= kept; n++) {
+            const SamplerUpdate &update = data.history[(data.updates - n) % SAMPLER_HISTORY];
+            if (update.stamp_ns <= t) {
+                pUpdate = &update;
+                break;
+            }
+        }
+        if (pUpdate == NULL) {
+            data.values.push_back(Py_NAN);
+            data.stamps_ns.push_back(SAMPLER_NO_STAMP);
+            data.severities.push_back(-1);
+            continue;
+        }
+        bool stale = pSampler->tolerance >= 0 && (t - pUpdate->stamp_ns) * 1e-9 > pSampler->tolerance;
+        if (stale)
+            pSampler->stale++;
+        data.values.push_back(stale ? Py_NAN : pUpdate->value);
+        data.stamps_ns.push_back(pUpdate->stamp_ns);
+        data.severities.push_back(pUpdate->severity);
+    }
+}
+
+static void Sampler_release(Sampler *pSampler)
+{
+    if (pSampler != NULL && epicsAtomicDecrSizeT(&pSampler->refcount) == 0) {
+        epicsEventDestroy(pSampler->wakeup);
+        epicsEventDestroy(pSampler->exited);
+        epicsMutexDestroy(pSampler->lock);
+        delete pSampler;
+    }
+}
+
+static void sampler_timer(void *arg)
+{
+    Sampler *pSampler = (Sampler *)arg;
+    epicsInt64 period = (epicsInt64)(pSampler->period * 1e9 + 0.5);
+    epicsInt64 due = sampler_now() + period;
+    while (true) {
+        epicsInt64 wait = due - sampler_now();
+        if (wait > 0)
+            epicsEventWaitWithTimeout(pSampler->wakeup, wait * 1e-9);
+        if (pSampler->stop)
+            break;
+        if (sampler_now() < due)
+            continue;
+        epicsMutexMustLock(pSampler->lock);
+        sampler_sample(pSampler, due);
+        epicsMutexUnlock(pSampler->lock);
+        due += period;
+    }
+    epicsEventMustTrigger(pSampler->exited);
+    Sampler_release(pSampler);
+}
+
+/* the channel number of name, called with the GIL held */
+static size_t sampler_add_channel(Sampler *pSampler, const char *name)
+{
+    epicsMutexMustLock(pSampler->lock);
+    std::map<std::string, size_t>::iterator it = pSampler->channel_numbers.find(name);
+    size_t channel;
+    if (it != pSampler->channel_numbers.end()) {
+        channel = it->second;
+    } else {
+        channel = pSampler->channels.size();
+        pSampler->channels.push_back(SamplerChannel());
+        SamplerChannel &data = pSampler->channels.back();
+        data.name = name;
+        data.updates = 0;
+        /* the samples before the channel was added */
+        data.values.assign(pSampler->times.size(), Py_NAN);
+        data.stamps_ns.assign(pSampler->times.size(), SAMPLER_NO_STAMP);
+        data.severities.assign(pSampler->times.size(), -1);
+        pSampler->channel_numbers[name] = channel;
+    }
+    epicsAtomicIncrSizeT(&pSampler->refcount);
+    epicsMutexUnlock(pSampler->lock);
+    return channel;
+}
+
+/* stop the timer thread, the subscriptions keep updating the latest values */
+static void sampler_close(void *ptr)
+{
+    Sampler *pSampler = (Sampler *)ptr;
+    if (pSampler->period > 0) {
+        pSampler->stop = true;
+        epicsEventMustTrigger(pSampler->wakeup);
+        Py_BEGIN_ALLOW_THREADS
+        epicsEventWait(pSampler->exited);
+        Py_END_ALLOW_THREADS
+    }
+    Sampler_release(pSampler);
+}
+
+static PyObject *Py_ca_sampler_create(PyObject *self, PyObject *args, PyObject *kws)
 {
-    double timeout;
-    if(!PyArg_ParseTuple(args, "d", &timeout))
+    double period = 0;
+    PyObject *pTolerance = Py_None;
+    const char *kwlist[] = {"period", "tolerance", NULL};
+
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "|dO", (char **)kwlist, &period, &pTolerance))
         return NULL;
 
-    int status;
+    double tolerance = -1;
+    if (pTolerance != Py_None) {
+        tolerance = PyFloat_AsDouble(pTolerance);
+        if (PyErr_Occurred())
+            return NULL;
+        if (tolerance < 0) {
+            PyErr_SetString(PyExc_ValueError, "tolerance must not be negative");
+            return NULL;
+        }
+    }
+    if (period < 0) {
+        PyErr_SetString(PyExc_ValueError, "period must not be negative");
+        return NULL;
+    }
 
-    Py_BEGIN_ALLOW_THREADS
-    status = ca_pend_io(timeout);
-    Py_END_ALLOW_THREADS
+    Sampler *pSampler = new Sampler();
+    pSampler->refcount = 1;
+    pSampler->lock = epicsMutexMustCreate();
+    pSampler->period = period;
+    pSampler->tolerance = tolerance;
+    pSampler->stale = 0;
+    pSampler->stop = false;
+    pSampler->wakeup = epicsEventMustCreate(epicsEventEmpty);
+    pSampler->exited = epicsEventMustCreate(epicsEventEmpty);
+
+    if (period > 0) {
+        epicsAtomicIncrSizeT(&pSampler->refcount);
+        epicsThreadMustCreate("CaChannel sampler", epicsThreadPriorityMedium,
+                              epicsThreadGetStackSize(epicsThreadStackSmall), sampler_timer, pSampler);
+    }
 
-    return IntToIntEnum("ECA", status);
+    return handle_new(&SAMPLER_HANDLE, pSampler);
 }
 
-static PyObject *Py_ca_pend_event(PyObject *self, PyObject *args)
+static PyObject *Py_ca_sampler_close(PyObject *self, PyObject *args)
 {
-    double timeout;
-    if(!PyArg_ParseTuple(args, "d", &timeout))
-        return NULL;
+    return handle_close_capsule(args, &SAMPLER_HANDLE);
+}
 
-    int status;
+/*
+    Take a sample at time at, POSIX seconds, or now. Returns the number of samples.
+*/
+static PyObject *Py_ca_sampler_sample(PyObject *self, PyObject *args, PyObject *kws)
+{
+    PyObject *pObject;
+    PyObject *pAt = Py_None;
+    const char *kwlist[] = {"sampler", "at", NULL};
 
-    Py_BEGIN_ALLOW_THREADS
-    status = ca_pend_event(timeout);
-    Py_END_ALLOW_THREADS
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "O|O", (char **)kwlist, &pObject, &pAt))
+        return NULL;
 
-    return IntToIntEnum("ECA", status);
-}
+    Sampler *pSampler = handle_object<Sampler>(pObject, &SAMPLER_HANDLE);
+    if (pSampler == NULL)
+        return NULL;
 
-static PyObject *Py_ca_poll(PyObject *self, PyObject *args)
-{
-    int status;
+    epicsInt64 t = sampler_now();
+    if (pAt != Py_None) {
+        double at = PyFloat_AsDouble(pAt);
+        if (PyErr_Occurred())
+            return NULL;
+        /* whole seconds apart, at * 1e9 would round to 256 ns */
+        double seconds = floor(at);
+        t = (epicsInt64)seconds * 1000000000 + (epicsInt64)((at - seconds) * 1e9 + 0.5);
+    }
 
-    Py_BEGIN_ALLOW_THREADS
-    status = ca_poll();
-    Py_END_ALLOW_THREADS
+    size_t samples;
+    epicsMutexMustLock(pSampler->lock);
+    sampler_sample(pSampler, t);
+    samples = pSampler->times.size();
+    epicsMutexUnlock(pSampler->lock);
 
-    return IntToIntEnum("ECA", status);
+    return PyLong_FromSize_t(samples);
 }
 
-static PyObject *Py_ca_test_io(PyObject *self, PyObject *args)
+static PyObject *sampler_item(double value) { return PyFloat_FromDouble(value); }
+static PyObject *sampler_item(epicsInt16 value) { return PyLong_FromLong(value); }
+static PyObject *sampler_item(epicsInt64 value)
 {
-    int status;
-
-    Py_BEGIN_ALLOW_THREADS
-    status = ca_test_io();
-    Py_END_ALLOW_THREADS
-
-    return IntToIntEnum("ECA", status);
+    if (value == SAMPLER_NO_STAMP) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return PyLong_FromLongLong(value);
 }
 
+/* view an int64 array of nanoseconds as datetime64[ns] */
+static PyObject *sampler_datetime64(PyObject *pArray)
+{
+    if (pArray == NULL || !HAS_NUMPY)
+        return pArray;
+    PyObject *pView = PyObject_CallMethod(pArray, (char*)"view", (char*)"s", "datetime64[ns]");
+    Py_DECREF(pArray);
+    return pView;
+}
 
-/*******************************************************
- *                      CA Info                        *
- *******************************************************/
+template<typename T>
+static T sampler_identity(T value) { return value; }
 
-static PyObject *Py_ca_field_type(PyObject *self, PyObject *args)
+/* a samples x channels array of the converted column, or a list of lists without numpy */
+template<typename T, typename S>
+static PyObject *sampler_column(const std::vector<SamplerChannel> &channels, size_t samples,
+                                std::vector<S> SamplerChannel::*column, T (*convert)(S), const char *nptype)
 {
-    PyObject *pChid;
-    if(!PyArg_ParseTuple(args, "O", &pChid))
-        return NULL;
-
-    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
-    if (chid == NULL)
-        return NULL;
+    size_t width = channels.size();
+    std::vector<T> table(samples * width);
+    for (size_t j = 0; j < width; j++) {
+        const std::vector<S> &data = channels[j].*column;
+        for (size_t i = 0; i < samples; i++)
+            table[i * width + j] = convert(data[i]);
+    }
 
-    chtype field_type;
-    Py_BEGIN_ALLOW_THREADS
-    field_type = ca_field_type(chid);
-    Py_END_ALLOW_THREADS
+    if (HAS_NUMPY) {
+        PyObject *pArray = ValueToNumpyArray<T>(table.empty() ? NULL : &table[0], table.size(), nptype);
+        if (pArray == NULL)
+            return NULL;
+        PyObject *pTable = PyObject_CallMethod(pArray, (char*)"reshape", (char*)"nn",
+                                               (Py_ssize_t)samples, (Py_ssize_t)width);
+        Py_DECREF(pArray);
+        return pTable;
+    }
 
-    return IntToIntEnum("DBF", field_type);
+    PyObject *pTable = PyList_New(samples);
+    for (size_t i = 0; i < samples; i++) {
+        PyObject *pRow = PyList_New(width);
+        for (size_t j = 0; j < width; j++)
+            PyList_SetItem(pRow, j, sampler_item(table[i * width + j]));
+        PyList_SetItem(pTable, i, pRow);
+    }
+    return pTable;
 }
 
-static PyObject *Py_ca_element_count(PyObject *self, PyObject *args)
+/*
+    The samples taken so far as columns: time (samples), value, timestamp, severity (samples x channels).
+    With clear=True the samples are removed. With stamp_ns=True time and timestamp are datetime64[ns] arrays,
+    or lists of nanoseconds since the POSIX epoch without numpy, instead of float seconds.
+*/
+static PyObject *Py_ca_sampler_data(PyObject *self, PyObject *args, PyObject *kws)
 {
-    PyObject *pChid;
-    if(!PyArg_ParseTuple(args, "O", &pChid))
+    PyObject *pObject;
+    bool clear = false;
+    bool stamp_ns = false;
+    const char *kwlist[] = {"sampler", "clear", "stamp_ns", NULL};
+
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "O|bb", (char **)kwlist, &pObject, &clear, &stamp_ns))
         return NULL;
 
-    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
-    if (chid == NULL)
+    Sampler *pSampler = handle_object<Sampler>(pObject, &SAMPLER_HANDLE);
+    if (pSampler == NULL)
         return NULL;
 
-    unsigned long element_count;
-    Py_BEGIN_ALLOW_THREADS
-    element_count = ca_element_count(chid);
-    Py_END_ALLOW_THREADS
+    /* copy the columns to build the Python objects without the lock */
+    std::vector<epicsInt64> times;
+    std::vector<SamplerChannel> channels;
+    size_t stale;
+    epicsMutexMustLock(pSampler->lock);
+    times = pSampler->times;
+    channels = pSampler->channels;
+    stale = pSampler->stale;
+    if (clear) {
+        pSampler->times.clear();
+        for (size_t j = 0; j < pSampler->channels.size(); j++) {
+            pSampler->channels[j].values.clear();
+            pSampler->channels[j].stamps_ns.clear();
+            pSampler->channels[j].severities.clear();
+        }
+        pSampler->stale = 0;
+    }
+    epicsMutexUnlock(pSampler->lock);
 
-    return Py_BuildValue("k", element_count);
-}
+    PyObject *pNames = PyList_New(channels.size());
+    for (size_t j = 0; j < channels.size(); j++)
+        PyList_SetItem(pNames, j, CharToPyStringOrBytes(channels[j].name.c_str()));
 
-static PyObject *Py_ca_name(PyObject *self, PyObject *args)
-{
-    PyObject *pChid;
-    if(!PyArg_ParseTuple(args, "O", &pChid))
+    PyObject *pTimes;
+    if (stamp_ns) {
+        if (HAS_NUMPY) {
+            pTimes = sampler_datetime64(
+                ValueToNumpyArray<epicsInt64>(times.empty() ? NULL : &times[0], times.size(), "i8"));
+        } else {
+            pTimes = PyList_New(times.size());
+            for (size_t i = 0; i < times.size(); i++)
+                PyList_SetItem(pTimes, i, PyLong_FromLongLong(times[i]));
+        }
+    } else {
+        std::vector<double> seconds(times.size());
+        for (size_t i = 0; i < times.size(); i++)
+            seconds[i] = sampler_seconds(times[i]);
+        if (HAS_NUMPY) {
+            pTimes = ValueToNumpyArray<double>(seconds.empty() ? NULL : &seconds[0], seconds.size(), "f8");
+        } else {
+            pTimes = PyList_New(seconds.size());
+            for (size_t i = 0; i < seconds.size(); i++)
+                PyList_SetItem(pTimes, i, PyFloat_FromDouble(seconds[i]));
+        }
+    }
+    PyObject *pValues = sampler_column(channels, times.size(), &SamplerChannel::values,
+                                       sampler_identity<double>, "f8");
+    PyObject *pStamps;
+    if (stamp_ns)
+        pStamps = sampler_datetime64(sampler_column(channels, times.size(), &SamplerChannel::stamps_ns,
+                                                    sampler_identity<epicsInt64>, "i8"));
+    else
+        pStamps = sampler_column(channels, times.size(), &SamplerChannel::stamps_ns, sampler_seconds, "f8");
+    PyObject *pSeverities = sampler_column(channels, times.size(), &SamplerChannel::severities,
+                                           sampler_identity<epicsInt16>, "i2");
+
+    if (pTimes == NULL || pValues == NULL || pStamps == NULL || pSeverities == NULL) {
+        Py_XDECREF(pNames);
+        Py_XDECREF(pTimes);
+        Py_XDECREF(pValues);
+        Py_XDECREF(pStamps);
+        Py_XDECREF(pSeverities);
         return NULL;
+    }
 
-    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
-    if (chid == NULL)
-        return NULL;
+    return Py_BuildValue("{s:N,s:N,s:N,s:N,s:N,s:k}",
+        "channels", pNames,
+        "time", pTimes,
+        "value", pValues,
+        "timestamp", pStamps,
+        "severity", pSeverities,
+        "stale", (unsigned long)stale
+    );
+}
 
-    const char *name;
-    Py_BEGIN_ALLOW_THREADS
-    name = ca_name(chid);
-    Py_END_ALLOW_THREADS
+/*******************************************************
+ *                    Completion                       *
+ *******************************************************/
 
-    return CharToPyStringOrBytes(name);
-}
+/*
+    A completion counts the get and put requests issued with it which have not yet completed.
+    The get and put callbacks decrement the count after the Python callback returned and signal
+    the event at zero, so a waiting thread wakes up as soon as the last reply is processed.
+*/
+struct Completion {
+    size_t refcount;            /* the capsule and every outstanding request */
+    size_t outstanding;
+    epicsEventId event;
+};
 
-static PyObject *Py_ca_state(PyObject *self, PyObject *args)
+static void Completion_release(Completion *pCompletion)
 {
-    PyObject *pChid;
-    if(!PyArg_ParseTuple(args, "O", &pChid))
-        return NULL;
-
-    if (pChid == Py_None) {
-        return IntToIntEnum("ChannelState", 4);
+    if (pCompletion != NULL && epicsAtomicDecrSizeT(&pCompletion->refcount) == 0) {
+        epicsEventDestroy(pCompletion->event);
+        delete pCompletion;
     }
+}
 
-    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
-    if (chid == NULL)
-        return NULL;
-
-    int state;
-    Py_BEGIN_ALLOW_THREADS
-    state = ca_state(chid);
-    Py_END_ALLOW_THREADS
-
-    return IntToIntEnum("ChannelState", state);
+#if PY_MAJOR_VERSION >= 3
+static void Completion_destructor(PyObject *pCapsule)
+{
+    Completion_release((Completion *) PyCapsule_GetPointer(pCapsule, "completion"));
 }
-static PyObject *Py_ca_host_name(PyObject *self, PyObject *args)
+#else
+static void Completion_destructor(void *ptr)
 {
-    PyObject *pChid;
-    if(!PyArg_ParseTuple(args, "O", &pChid))
-        return NULL;
+    Completion_release((Completion *) ptr);
+}
+#endif
 
-    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
-    if (chid == NULL)
-        return NULL;
+/* a request is issued, called with the GIL held */
+static void completion_issue(Completion *pCompletion)
+{
+    epicsAtomicIncrSizeT(&pCompletion->refcount);
+    epicsAtomicIncrSizeT(&pCompletion->outstanding);
+}
 
-    const char *host;
-    Py_BEGIN_ALLOW_THREADS
-    host = ca_host_name(chid);
-    Py_END_ALLOW_THREADS
+/* a request completed or failed to be issued */
+static void completion_done(Completion *pCompletion)
+{
+    if (epicsAtomicDecrSizeT(&pCompletion->outstanding) == 0)
+        epicsEventMustTrigger(pCompletion->event);
+}
 
-    return CharToPyStringOrBytes(host);
+static PyObject *Py_ca_completion_create(PyObject *self, PyObject *args)
+{
+    Completion *pCompletion = new Completion();
+    pCompletion->refcount = 1;
+    pCompletion->outstanding = 0;
+    pCompletion->event = epicsEventMustCreate(epicsEventEmpty);
+
+    PyObject *pCapsule = CAPSULE_BUILD(pCompletion, "completion", Completion_destructor);
+    if (pCapsule == NULL)
+        Completion_release(pCompletion);
+    return pCapsule;
 }
 
-static PyObject *Py_ca_read_access(PyObject *self, PyObject *args)
+/*
+    Wait until all requests issued with the completion have completed, at most timeout seconds.
+    The send buffer is flushed first. Without preemptive callbacks the callbacks only run in
+    ca_pend_event, which is then called in steps of poll seconds. Returns False on timeout.
+*/
+static PyObject *Py_ca_completion_wait(PyObject *self, PyObject *args, PyObject *kws)
 {
-    PyObject *pChid;
-    if(!PyArg_ParseTuple(args, "O", &pChid))
+    PyObject *pObject;
+    PyObject *pTimeout = Py_None;
+    double poll = 0.01;
+    const char *kwlist[] = {"completion", "timeout", "poll", NULL};
+
+    if(!PyArg_ParseTupleAndKeywords(args, kws, "O|Od", (char **)kwlist, &pObject, &pTimeout, &poll))
         return NULL;
 
-    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
-    if (chid == NULL)
+    Completion *pCompletion = (Completion *) CAPSULE_EXTRACT(pObject, "completion");
+    if (pCompletion == NULL)
         return NULL;
 
-    int access;
+    double timeout = -1;
+    if (pTimeout != Py_None) {
+        timeout = PyFloat_AsDouble(pTimeout);
+        if (PyErr_Occurred())
+            return NULL;
+    }
+    if (poll <= 0)
+        poll = 0.01;
+
+    epicsUInt64 deadline = timeout < 0 ? 0 : monotonic_ns() + (epicsUInt64)(timeout * 1e9);
+    bool preemptive;
     Py_BEGIN_ALLOW_THREADS
-    access = ca_read_access(chid);
+    preemptive = ca_current_context() != NULL && ca_preemtive_callback_is_enabled();
+    ca_flush_io();
     Py_END_ALLOW_THREADS
 
-    return PyBool_FromLong(access);
+    while (epicsAtomicGetSizeT(&pCompletion->outstanding) != 0) {
+        /* wake up regularly to handle signals */
+        double wait = 0.1;
+        if (deadline != 0) {
+            epicsUInt64 now = monotonic_ns();
+            if (now >= deadline)
+                Py_RETURN_FALSE;
+            wait = MIN(wait, (deadline - now) * 1e-9);
+        }
+        Py_BEGIN_ALLOW_THREADS
+        if (preemptive)
+            epicsEventWaitWithTimeout(pCompletion->event, wait);
+        else
+            ca_pend_event(MIN(wait, poll));
+        Py_END_ALLOW_THREADS
+        if (PyErr_CheckSignals() != 0)
+            return NULL;
+    }
+    Py_RETURN_TRUE;
 }
 
-static PyObject *Py_ca_write_access(PyObject *self, PyObject *args)
+/* the number of requests not yet completed */
+static PyObject *Py_ca_completion_pending(PyObject *self, PyObject *args)
 {
-    PyObject *pChid;
-    if(!PyArg_ParseTuple(args, "O", &pChid))
+    PyObject *pObject;
+    if(!PyArg_ParseTuple(args, "O", &pObject))
         return NULL;
 
-    chanId chid = (chanId) CAPSULE_EXTRACT(pChid, "chid");
-    if (chid == NULL)
+    Completion *pCompletion = (Completion *) CAPSULE_EXTRACT(pObject, "completion");
+    if (pCompletion == NULL)
         return NULL;
-    
-    int access;
-    Py_BEGIN_ALLOW_THREADS
-    access = ca_write_access(chid);
-    Py_END_ALLOW_THREADS
-
-    return PyBool_FromLong(access);
-}
 
-static PyObject *Py_ca_version(PyObject *self, PyObject *args)
-{
-    return CharToPyStringOrBytes(ca_version());
+    return PyLong_FromSize_t(epicsAtomicGetSizeT(&pCompletion->outstanding));
 }
 
 /*******************************************************
@@ -2368,6 +6855,38 @@ PyObject *ValueToNumpyArray(void *vp, Py_ssize_t count, const char *nptype)
     }
     #endif
     else {
+        /* the caller falls back to a list */
+        PyErr_Clear();
+        Py_XDECREF(value);
+        value = NULL;
+    }
+
+    return value;
+}
+
+/*
+    Strings go into a fixed width bytes array, numpy dtype 'S40'. Each is copied up to the null character,
+    the rest is zero filled, so that numpy does not show the bytes left behind it.
+*/
+template<>
+PyObject *ValueToNumpyArray<dbr_string_t>(void *vp, Py_ssize_t count, const char *nptype)
+{
+    PyObject *value = PyObject_CallMethod(NUMPY, (char*)"empty", (char*)"is", count, nptype);
+    if (value == NULL) {
+        PyErr_Print();
+        return NULL;
+    }
+
+    const dbr_string_t *src = (const dbr_string_t *)vp;
+    Py_buffer buffer = {0};
+    if (PyObject_CheckBuffer(value) && PyObject_GetBuffer(value, &buffer, PyBUF_CONTIG) == 0) {
+        dbr_string_t *dst = (dbr_string_t *)buffer.buf;
+        for (Py_ssize_t i = 0; i < count; i++)
+            strncpy(dst[i], src[i], sizeof(dbr_string_t));
+        PyBuffer_Release(&buffer);
+    } else {
+        /* the caller falls back to a list */
+        PyErr_Clear();
         Py_XDECREF(value);
         value = NULL;
     }
@@ -2375,8 +6894,9 @@ PyObject *ValueToNumpyArray(void *vp, Py_ssize_t count, const char *nptype)
     return value;
 }
 
+/* value is preset if it is formatted as string */
 #define FormatValue(VP, DBRTYPE, COUNT, FORMAT, NPTYPE, HAS_USE_NUMPY) \
-    {\
+    if (value == NULL) {\
         DBRTYPE *vp=(DBRTYPE *)(VP);\
         if(COUNT == 1)\
             value = FORMAT(*vp);\
@@ -2415,21 +6935,87 @@ static PyObject *TS2Stamp(const epicsTimeStamp& ts)
     return pStamp;
 }
 
+/* the stamp dict, or a single integer of nanoseconds without a dict */
+static PyObject *StampValue(const epicsTimeStamp &ts, int format)
+{
+    /* the CaChannel fields are taken from the buffer, the stamp object is dropped */
+    if (format & (FORMAT_STAMP_NS | FORMAT_PV_FIELDS))
+        return PyLong_FromLongLong(StampNanoseconds(ts));
+    return TS2Stamp(ts);
+}
+
+/* rename the DBR fields to the CaChannel names */
+static PyObject *PVFields(PyObject *pFields, chtype type, const void *val)
+{
+    static const char *names[][2] = {
+        {"lower_alarm_limit",   "pv_loalarmlim"},
+        {"lower_ctrl_limit",    "pv_loctrllim"},
+        {"lower_disp_limit",    "pv_lodislim"},
+        {"lower_warning_limit", "pv_lowarnlim"},
+        {"upper_alarm_limit",   "pv_upalarmlim"},
+        {"upper_ctrl_limit",    "pv_upctrllim"},
+        {"upper_disp_limit",    "pv_updislim"},
+        {"upper_warning_limit", "pv_upwarnlim"},
+        {"no_str",              "pv_nostrings"},
+        {"strs",                "pv_statestrings"},
+    };
+
+    PyObject *pResult = PyDict_New();
+    if (pResult == NULL)
+        return NULL;
+
+    PyObject *pKey, *pValue;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(pFields, &pos, &pKey, &pValue)) {
+        const char *key = PyString_AsString(pKey);
+        if (key == NULL) {
+            Py_DECREF(pResult);
+            return NULL;
+        }
+        if (strcmp(key, "stamp") == 0) {
+            /* all DBR_TIME structures have the same header */
+            const epicsTimeStamp &stamp = ((const struct dbr_time_double *)val)->stamp;
+            PyObject *o = PyInt_FromSsize_t((Py_ssize_t)stamp.secPastEpoch);
+            PyDict_SetItemString(pResult, "pv_seconds", o);
+            Py_XDECREF(o);
+            o = PyInt_FromLong(stamp.nsec);
+            PyDict_SetItemString(pResult, "pv_nseconds", o);
+            Py_XDECREF(o);
+            continue;
+        }
+        char name[64] = "pv_";
+        strncat(name, key, sizeof(name) - 4);
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strcmp(key, names[i][0]) == 0) {
+                strcpy(name, names[i][1]);
+                break;
+            }
+        }
+        PyDict_SetItemString(pResult, name, pValue);
+    }
+    return pResult;
+}
 
 PyObject * CBufferToPythonDict(chtype type,
                     unsigned long count,
                     const void *val,
-                    bool use_numpy)
+                    bool use_numpy,
+                    int format)
 {
     PyObject *arglist = NULL;
     PyObject *value   = NULL;
     
     bool has_use_numpy = use_numpy && HAS_NUMPY;
+    /* a list of str unless fixed width bytes are asked for */
+    bool has_fixed_strings = has_use_numpy && (format & FORMAT_FIXED_STRINGS);
+
+    if ((format & FORMAT_AS_STRING) && dbr_type_is_CHAR(type))
+        value = CharArrayToPyStringOrBytes((const char *)dbr_value_ptr(val, type), count);
 
     /* build arglist, value is inserted */
     switch(type){
     case DBR_STRING:
-        FormatValue(val, dbr_string_t, count, CharToPyStringOrBytes, "", false);
+        FormatValue(val, dbr_string_t, count, CharToPyStringOrBytes, "S40", has_fixed_strings);
         arglist = Py_BuildValue("O", value);
         break;
     case DBR_SHORT:
@@ -2462,7 +7048,7 @@ PyObject * CBufferToPythonDict(chtype type,
     case DBR_CTRL_STRING:
     {
         struct dbr_sts_string  *cval=(struct dbr_sts_string  *)val;
-        FormatValue(&(cval->value), dbr_string_t, count, CharToPyStringOrBytes, "", false);
+        FormatValue(&(cval->value), dbr_string_t, count, CharToPyStringOrBytes, "S40", has_fixed_strings);
         arglist=Py_BuildValue("{s:O,s:N,s:N}",
                 "value",    value,
                 "severity", IntToIntEnum("AlarmSeverity", cval->severity),
@@ -2533,12 +7119,12 @@ PyObject * CBufferToPythonDict(chtype type,
     case DBR_TIME_STRING:
     {
         struct dbr_time_string  *cval=(struct dbr_time_string  *)val;
-        FormatValue(&(cval->value), dbr_string_t, count, CharToPyStringOrBytes, "", false)
+        FormatValue(&(cval->value), dbr_string_t, count, CharToPyStringOrBytes, "S40", has_fixed_strings)
         arglist=Py_BuildValue("{s:O,s:N,s:N,s:N}",
                 "value",    value,
                 "severity", IntToIntEnum("AlarmSeverity", cval->severity),
                 "status",   IntToIntEnum("AlarmCondition", cval->status),
-                "stamp",    TS2Stamp(cval->stamp));
+                "stamp",    StampValue(cval->stamp, format));
     }
         break;
     case DBR_TIME_SHORT:
@@ -2549,7 +7135,7 @@ PyObject * CBufferToPythonDict(chtype type,
                 "value",    value,
                 "severity", IntToIntEnum("AlarmSeverity", cval->severity),
                 "status",   IntToIntEnum("AlarmCondition", cval->status),
-                "stamp",    TS2Stamp(cval->stamp));
+                "stamp",    StampValue(cval->stamp, format));
     }
         break;
     case DBR_TIME_FLOAT:
@@ -2560,7 +7146,7 @@ PyObject * CBufferToPythonDict(chtype type,
                 "value",    value,
                 "severity", IntToIntEnum("AlarmSeverity", cval->severity),
                 "status",   IntToIntEnum("AlarmCondition", cval->status),
-                "stamp",    TS2Stamp(cval->stamp));
+                "stamp",    StampValue(cval->stamp, format));
     }
         break;
     case DBR_TIME_ENUM:
@@ -2571,7 +7157,7 @@ PyObject * CBufferToPythonDict(chtype type,
                 "value",    value,
                 "severity", IntToIntEnum("AlarmSeverity", cval->severity),
                 "status",   IntToIntEnum("AlarmCondition", cval->status),
-                "stamp",    TS2Stamp(cval->stamp));
+                "stamp",    StampValue(cval->stamp, format));
     }
         break;
     case DBR_TIME_CHAR:
@@ -2582,7 +7168,7 @@ PyObject * CBufferToPythonDict(chtype type,
                 "value",    value,
                 "severity", IntToIntEnum("AlarmSeverity", cval->severity),
                 "status",   IntToIntEnum("AlarmCondition", cval->status),
-                "stamp",    TS2Stamp(cval->stamp));
+                "stamp",    StampValue(cval->stamp, format));
     }
         break;
     case DBR_TIME_LONG:
@@ -2593,7 +7179,7 @@ PyObject * CBufferToPythonDict(chtype type,
                 "value",    value,
                 "severity", IntToIntEnum("AlarmSeverity", cval->severity),
                 "status",   IntToIntEnum("AlarmCondition", cval->status),
-                "stamp",    TS2Stamp(cval->stamp));
+                "stamp",    StampValue(cval->stamp, format));
     }
         break;
     case DBR_TIME_DOUBLE:
@@ -2604,7 +7190,7 @@ PyObject * CBufferToPythonDict(chtype type,
                 "value",    value,
                 "severity", IntToIntEnum("AlarmSeverity", cval->severity),
                 "status",   IntToIntEnum("AlarmCondition", cval->status),
-                "stamp",    TS2Stamp(cval->stamp));
+                "stamp",    StampValue(cval->stamp, format));
     }
         break;
 
@@ -2859,12 +7445,18 @@ PyObject * CBufferToPythonDict(chtype type,
     break;
     case DBR_CLASS_NAME:
     {
-        FormatValue(val, dbr_string_t,  count, CharToPyStringOrBytes, "", false)
+        FormatValue(val, dbr_string_t,  count, CharToPyStringOrBytes, "S40", has_fixed_strings)
         arglist = Py_BuildValue("O", value);
     }
     break;
     }
     Py_XDECREF(value);
+
+    if ((format & FORMAT_PV_FIELDS) && arglist != NULL && PyDict_Check(arglist)) {
+        PyObject *pFields = PVFields(arglist, type, val);
+        Py_DECREF(arglist);
+        arglist = pFields;
+    }
     return arglist;
 }
 
@@ -2885,13 +7477,50 @@ PyObject * CBufferToPythonDict(chtype type,
 void *setup_put(chanId chid, PyObject *pValue, PyObject *pType, PyObject *pCount,
                                 chtype &dbrtype, unsigned long &count)
 {
-    void *pbuf = NULL;
-
     Py_BEGIN_ALLOW_THREADS
     dbrtype = dbf_type_to_DBR(ca_field_type(chid));
     count = ca_element_count(chid);
     Py_END_ALLOW_THREADS
 
+    return PythonToCBuffer(pValue, pType, pCount, dbrtype, count);
+}
+
+/*
+    Copy a fixed width bytes array, e.g. numpy dtype 'S40', without an object per element.
+    Longer items are truncated to the size of dbr_string_t.
+*/
+static bool StringsFromBuffer(PyObject *pValue, dbr_string_t *ptr, unsigned long count)
+{
+    if (!PyObject_CheckBuffer(pValue))
+        return false;
+
+    Py_buffer buffer;
+    if (PyObject_GetBuffer(pValue, &buffer, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+        PyErr_Clear();
+        return false;
+    }
+
+    size_t length = buffer.format == NULL ? 0 : strlen(buffer.format);
+    bool fixed = buffer.ndim == 1 && length > 0 && buffer.format[length - 1] == 's' && buffer.itemsize > 0 &&
+                 (unsigned long)(buffer.len / buffer.itemsize) >= count;
+    if (fixed) {
+        size_t size = MIN((size_t)buffer.itemsize, sizeof(dbr_string_t));
+        for (unsigned long i = 0; i < count; i++)
+            memcpy(ptr[i], (const char *)buffer.buf + i * buffer.itemsize, size);
+    }
+    PyBuffer_Release(&buffer);
+    return fixed;
+}
+
+/*
+    Convert the value to a buffer of the requested type and count, which default to
+    the native dbrtype and count passed in. The actual type and count are returned in them.
+*/
+void *PythonToCBuffer(PyObject *pValue, PyObject *pType, PyObject *pCount,
+                      chtype &dbrtype, unsigned long &count)
+{
+    void *pbuf = NULL;
+
     if (pType != Py_None) {
         dbrtype = PyObjectToLong(pType);
         if (PyErr_Occurred())
@@ -2977,6 +7606,8 @@ void *setup_put(chanId chid, PyObject *pValue, PyObject *pType, PyObject *pCount
             PyArg_Parse(pValue, "z#", &str, &size);
             if (str != NULL)
                 strncpy(ptr[0], str, sizeof(dbr_string_t));
+        } else if (StringsFromBuffer(pValue, ptr, count)) {
+            /* fixed width bytes array */
         } else {
             for(unsigned long i=0; i<count; i++) {
                 PyObject *item = PySequence_GetItem(pValue, i);
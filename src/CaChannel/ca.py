@@ -1,5 +1,7 @@
 import os
+import time
 import warnings
+import zlib
 
 if os.environ.get('CACHANNEL_BACKEND') == 'caffi':
     from caffi.ca import *
@@ -8,9 +10,188 @@ if os.environ.get('CACHANNEL_BACKEND') == 'caffi':
 else:
     try:
         from ._ca import *
+        from ._ca import _bench_decode, _bench_encode
     except:
         warnings.warn("c extension is not available, trying caffi as fallback", RuntimeWarning)
         from caffi.ca import *
         from caffi.macros import *
         from caffi.constants import *
 
+
+try:
+    ensure_attached
+except NameError:
+    def ensure_attached(context=None):
+        """
+        Attach to *context*, or to a new preemptive context if it is *None*, unless already attached.
+        Return the context to pass on subsequent calls.
+        """
+        if context is None:
+            if current_context() is None:
+                create_context(True)
+            return current_context()
+        if current_context() is None:
+            attach_context(context)
+        return context
+
+
+try:
+    preemptive_callback_is_enabled
+except NameError:
+    def preemptive_callback_is_enabled():
+        """
+        Check whether the current CA context has preemptive callbacks, False if not attached.
+        """
+        return False
+
+
+class ContextPool(object):
+    """
+    A pool of preemptive CA contexts.
+
+    A single context has one set of auxiliary threads which receive and dispatch all its traffic.
+    The pool spreads channels over *n* contexts, so that monitor updates are received and decoded
+    by *n* threads in parallel.
+
+    A channel is placed by its name,
+
+    - 'hash': by a hash of the whole name, which balances the channels evenly.
+    - 'prefix': by a hash of the name up to the first ':', which keeps the PVs of one IOC,
+      and thus their server circuit, in one context.
+    - a callable: returning a key for the name, e.g. a host name looked up from a table.
+
+    Only the channel creation and the execution functions depend on the attached context.
+    The channel and subscription functions operate on the context the channel was created in.
+
+    >>> pool = ContextPool(4)
+    >>> status, chid = pool.create_channel('catest')
+    >>> pool.pend_io(1)
+    <ECA.NORMAL: 1>
+    >>> status, evid = pool.create_subscription(chid, lambda epics_args: None)
+    >>> pool.destroy()
+    """
+    def __init__(self, n=None, placement='hash'):
+        if n is None:
+            n = getattr(os, 'cpu_count', lambda: 4)() or 4
+        if n < 1:
+            raise ValueError('the number of contexts must be positive')
+
+        self.placement = placement
+        self.contexts = []
+        previous = current_context()
+        if previous is not None:
+            detach_context()
+        try:
+            for _ in range(n):
+                create_context(True)
+                self.contexts.append(current_context())
+                detach_context()
+        finally:
+            if previous is not None:
+                attach_context(previous)
+
+    def __len__(self):
+        return len(self.contexts)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.destroy()
+
+    def _key(self, name):
+        if callable(self.placement):
+            return str(self.placement(name))
+        elif self.placement == 'prefix':
+            return name.split(':', 1)[0]
+        else:
+            return name
+
+    def context_for(self, name):
+        """
+        Return the context in which the channel of *name* is placed.
+        """
+        key = self._key(name)
+        if not isinstance(key, bytes):
+            key = key.encode('utf-8')
+        return self.contexts[zlib.crc32(key) % len(self.contexts)]
+
+    def _call_in(self, context, func, *args, **kws):
+        previous = current_context()
+        if previous is not None:
+            detach_context()
+        attach_context(context)
+        try:
+            return func(*args, **kws)
+        finally:
+            detach_context()
+            if previous is not None:
+                attach_context(previous)
+
+    # channel creation is bound to the context of the calling thread
+    def create_channel(self, name, callback=None, priority=CA_PRIORITY_DEFAULT):
+        return self._call_in(self.context_for(name), create_channel, name, callback, priority)
+
+    # other channel operations are bound to the context the channel was created in
+    def clear_channel(self, chid):
+        return clear_channel(chid)
+
+    def get(self, chid, *args, **kws):
+        return get(chid, *args, **kws)
+
+    def put(self, chid, value, *args, **kws):
+        return put(chid, value, *args, **kws)
+
+    def create_subscription(self, chid, callback, *args, **kws):
+        return create_subscription(chid, callback, *args, **kws)
+
+    def clear_subscription(self, evid):
+        return clear_subscription(evid)
+
+    def add_exception_event(self, callback=None):
+        """
+        Install the exception *callback* in all contexts.
+        """
+        for context in self.contexts:
+            self._call_in(context, add_exception_event, callback)
+
+    def flush_io(self):
+        """
+        Flush the send buffers of all contexts.
+        """
+        status = ECA_NORMAL
+        for context in self.contexts:
+            status = self._call_in(context, flush_io)
+            if status != ECA_NORMAL:
+                break
+        return status
+
+    def pend_io(self, timeout):
+        """
+        Wait until the outstanding connections and gets of all contexts complete or *timeout* expires.
+        """
+        deadline = time.time() + timeout
+        status = ECA_NORMAL
+        for context in self.contexts:
+            status = self._call_in(context, pend_io, max(deadline - time.time(), 1e-12))
+            if status != ECA_NORMAL:
+                break
+        return status
+
+    def pend_event(self, timeout):
+        """
+        Flush all contexts and wait for *timeout* seconds. Callbacks are delivered by the auxiliary threads meanwhile.
+        """
+        self.flush_io()
+        return self._call_in(self.contexts[0], pend_event, timeout)
+
+    def poll(self):
+        self.flush_io()
+        return ECA_TIMEOUT
+
+    def destroy(self):
+        """
+        Destroy all contexts. Channels and subscriptions created in the pool are no longer valid.
+        """
+        while self.contexts:
+            self._call_in(self.contexts.pop(), destroy_context)
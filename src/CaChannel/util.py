@@ -3,7 +3,10 @@ This module provides functions similiar to those command line tools found in EPI
 e.g. :func:`caget`, :func:`caput`, :func:`camonitor`, :func:`cainfo`.
 
 In those functions, :class:`CaChannel.CaChannel` objects are created implicitly and cached
-in :data:`_channel_` dictionary.
+in :data:`_channels_`, a bounded cache that evicts the least recently used and idle channels.
+Names that fail to connect are remembered for a while, so that repeated lookups of a
+missing PV do not each wait for a search timeout. See :func:`channel_cache_info` and
+:func:`channel_cache_configure`.
 
 >>> import time
 >>> caput('catest', 1.23, wait=True)
@@ -24,56 +27,394 @@ in :data:`_channel_` dictionary.
 
 
 import collections
+import contextlib
 import datetime
-import itertools
-import numbers
 import sys
 import threading
+import time
 
-from .CaChannel import ca, CaChannel
+from .CaChannel import ca, CaChannel, CaChannelException, _C_EXTENSION
 
-#: channel object cache
-_channels_ = {}
-
-
-def _ints_to_string(integers):
-    try:
-        sequence_type = collections.abc.Sequence # Python 3.10+
-    except AttributeError:
-        sequence_type = collections.Sequence
-    if isinstance(integers, sequence_type):
-        stripped = itertools.takewhile(lambda x: x != 0, integers)
-        if sys.hexversion < 0x03000000:
-            value = ''.join([chr(c) for c in stripped])
-        else:
-            value = bytes(stripped).decode()
-    elif isinstance(integers, numbers.Integral):
-        if integers == 0:
-            value = ''
-        elif sys.hexversion < 0x03000000:
-            value = chr(integers)
+_monotonic = getattr(time, 'monotonic', time.time)
+
+
+class _ChannelCache(object):
+    """
+    Cache of connected :class:`CaChannel.CaChannel` objects keyed by pv name.
+
+    - At most *max_size* channels are kept. The least recently used ones are evicted first.
+    - Channels not used for *idle_timeout* seconds are evicted.
+    - Evicted channels are cleared by a background thread, not by the caller.
+    - A name that fails to connect is not searched again for *negative_ttl* seconds,
+      doubled on each consecutive failure up to *negative_ttl_max* seconds.
+      It is forgotten *negative_ttl_max* seconds after it may be searched again.
+    - Concurrent first lookups of the same name wait for a single search.
+
+    Channels in use, i.e. borrowed through :meth:`channel` or pinned by a monitor, are never evicted.
+    """
+    def __init__(self, max_size=1000, idle_timeout=600.0, negative_ttl=1.0, negative_ttl_max=60.0):
+        self.max_size = max_size
+        self.idle_timeout = idle_timeout
+        self.negative_ttl = negative_ttl
+        self.negative_ttl_max = negative_ttl_max
+
+        self._lock = threading.Lock()
+        # name -> [channel, last used, borrow count, pinned]
+        self._entries = collections.OrderedDict()
+        # name -> event set when the first lookup completes
+        self._pending = {}
+        # name -> (retry time, backoff, status code)
+        self._failures = {}
+        # evicted channels waiting to be cleared
+        self._evicted = []
+        self._reaper = None
+        self._wakeup = threading.Event()
+
+        self._stats = dict(hits=0, misses=0, evictions=0, negative_hits=0, failures=0)
+
+    def get(self, name, pin=False):
+        """
+        Return the connected channel of *name*, searching for it if not cached.
+
+        If *pin* is True, the channel is also exempted from eviction as by :meth:`pin`,
+        before the lock is released, so that it cannot be evicted in between.
+
+        :raises CaChannelException: if the search fails or the name has recently failed.
+        """
+        return self._acquire(name, 0, pin)
+
+    @contextlib.contextmanager
+    def channel(self, name):
+        """
+        Borrow the channel of *name* for the duration of the *with* block. It will not be evicted meanwhile.
+        """
+        chan = self._acquire(name, 1)
+        try:
+            yield chan
+        finally:
+            with self._lock:
+                entry = self._entries.get(name)
+                if entry is not None and entry[0] is chan:
+                    entry[2] -= 1
+                    entry[1] = _monotonic()
+
+    def configure(self, max_size=None, idle_timeout=None, negative_ttl=None, negative_ttl_max=None):
+        """
+        Change the limits. Arguments left as *None* are unchanged.
+        Channels over the new *max_size* are evicted at once.
+        """
+        with self._lock:
+            if max_size is not None:
+                self.max_size = max_size
+            if idle_timeout is not None:
+                self.idle_timeout = idle_timeout
+            if negative_ttl is not None:
+                self.negative_ttl = negative_ttl
+            if negative_ttl_max is not None:
+                self.negative_ttl_max = negative_ttl_max
+            self._trim(self.max_size)
+
+    def pin(self, name, pinned=True):
+        """
+        Exempt the channel of *name* from eviction, e.g. while it has a monitor.
+        """
+        with self._lock:
+            entry = self._entries.get(name)
+            if entry is not None:
+                entry[3] = pinned
+
+    def _acquire(self, name, borrow, pin=False):
+        while True:
+            with self._lock:
+                entry = self._entries.get(name)
+                if entry is not None:
+                    # move to the most recently used end
+                    del self._entries[name]
+                    self._entries[name] = entry
+                    entry[1] = _monotonic()
+                    entry[2] += borrow
+                    entry[3] = entry[3] or pin
+                    self._stats['hits'] += 1
+                    return entry[0]
+
+                failure = self._failures.get(name)
+                if failure is not None and failure[0] > _monotonic():
+                    self._stats['negative_hits'] += 1
+                    # a new exception each time, a stored one would collect the traceback of every raise
+                    raise CaChannelException(failure[2])
+
+                event = self._pending.get(name)
+                if event is None:
+                    event = self._pending[name] = threading.Event()
+                    self._stats['misses'] += 1
+                    break
+            # another thread is searching the same name
+            event.wait()
+
+        chan = None
+        try:
+            chan = CaChannel(name)
+            chan.searchw()
+        except BaseException as e:
+            with self._lock:
+                if chan is not None:
+                    self._evicted.append(chan)
+                    self._wakeup.set()
+                    self._start_reaper()
+                if isinstance(e, CaChannelException):
+                    self._record_failure(name, e.status)
+                del self._pending[name]
+            event.set()
+            raise
+
+        with self._lock:
+            self._failures.pop(name, None)
+            self._entries[name] = [chan, _monotonic(), borrow, pin]
+            self._trim(self.max_size)
+            del self._pending[name]
+            self._start_reaper()
+        event.set()
+        return chan
+
+    @contextlib.contextmanager
+    def channels(self, names, timeout=None):
+        """
+        Borrow the channels of *names* for the duration of the *with* block.
+
+        Names not cached are searched all at once and waited for by a single :meth:`CaChannel.CaChannel.pend_io`.
+        The block receives a list, in the order of *names*, of either the connected channel or
+        the :class:`CaChannel.CaChannelException` explaining why it is not available.
+        """
+        result = self._acquire_many(names, timeout)
+        try:
+            yield result
+        finally:
+            with self._lock:
+                for name, chan in zip(names, result):
+                    entry = self._entries.get(name)
+                    if entry is not None and entry[0] is chan:
+                        entry[2] -= 1
+                        entry[1] = _monotonic()
+
+    def _acquire_many(self, names, timeout):
+        result = [None] * len(names)
+        # name -> [event, channel or exception, indices] of the names searched here
+        searching = collections.OrderedDict()
+        # name -> [event, indices] of the names being searched by other threads
+        waiting = {}
+
+        with self._lock:
+            now = _monotonic()
+            for i, name in enumerate(names):
+                if name in searching:
+                    searching[name][2].append(i)
+                    continue
+                entry = self._entries.get(name)
+                if entry is not None:
+                    del self._entries[name]
+                    self._entries[name] = entry
+                    entry[1] = now
+                    entry[2] += 1
+                    self._stats['hits'] += 1
+                    result[i] = entry[0]
+                    continue
+                failure = self._failures.get(name)
+                if failure is not None and failure[0] > now:
+                    self._stats['negative_hits'] += 1
+                    result[i] = CaChannelException(failure[2])
+                    continue
+                event = self._pending.get(name)
+                if event is not None:
+                    waiting.setdefault(name, [event, []])[1].append(i)
+                    continue
+                event = self._pending[name] = threading.Event()
+                self._stats['misses'] += 1
+                searching[name] = [event, None, [i]]
+
+        # issue all searches and wait once
+        try:
+            chan = None
+            for name, item in searching.items():
+                chan = CaChannel(name)
+                item[1] = chan
+                try:
+                    chan.search()
+                except CaChannelException as e:
+                    item[1] = e
+            if chan is not None:
+                try:
+                    chan.pend_io(timeout)
+                except CaChannelException:
+                    # connected or not is decided per channel below
+                    pass
+        finally:
+            with self._lock:
+                for name, (event, chan, indices) in searching.items():
+                    if isinstance(chan, CaChannel) and chan.state() == ca.cs_conn:
+                        self._failures.pop(name, None)
+                        self._entries[name] = [chan, _monotonic(), len(indices), False]
+                        value = chan
+                    else:
+                        if isinstance(chan, CaChannel):
+                            self._evicted.append(chan)
+                            chan = CaChannelException(ca.ECA_TIMEOUT)
+                        elif chan is None:
+                            chan = CaChannelException(ca.ECA_TIMEOUT)
+                        self._record_failure(name, chan.status)
+                        value = chan
+                    for i in indices:
+                        result[i] = value
+                    del self._pending[name]
+                self._trim(self.max_size)
+                if searching:
+                    self._start_reaper()
+                if self._evicted:
+                    self._wakeup.set()
+            for event, _, _ in searching.values():
+                event.set()
+
+        for name, (event, indices) in waiting.items():
+            event.wait()
+            for i in indices:
+                try:
+                    result[i] = self._acquire(name, 1)
+                except CaChannelException as e:
+                    result[i] = e
+
+        return result
+
+    def _record_failure(self, name, status):
+        # called with the lock held
+        previous = self._failures.get(name)
+        if previous is None:
+            backoff = self.negative_ttl
         else:
-            value = bytes([integers]).decode()
-    else:
-        value = None
+            backoff = min(previous[1] * 2, self.negative_ttl_max)
+        self._failures[name] = (_monotonic() + backoff, backoff, status)
+        self._stats['failures'] += 1
+        self._start_reaper()
+
+    def _forget_failures(self, now):
+        # called with the lock held, after another negative_ttl_max seconds the backoff would not grow anyway
+        for name, failure in list(self._failures.items()):
+            if failure[0] + self.negative_ttl_max < now:
+                del self._failures[name]
+
+    def _trim(self, max_size, idle_before=None):
+        # called with the lock held
+        evicted = []
+        for name, entry in list(self._entries.items()):
+            if len(self._entries) <= max_size and (idle_before is None or entry[1] >= idle_before):
+                if idle_before is None:
+                    break
+                continue
+            if entry[2] > 0 or entry[3]:
+                continue
+            del self._entries[name]
+            evicted.append(entry[0])
+        self._stats['evictions'] += len(evicted)
+        self._evicted.extend(evicted)
+        if evicted:
+            self._wakeup.set()
+
+    def _evict(self, channels):
+        for chan in channels:
+            try:
+                chan.clear_channel()
+            except CaChannelException:
+                pass
+        if channels:
+            channels[-1].flush_io()
+
+    def _start_reaper(self):
+        # called with the lock held
+        if self._reaper is None:
+            self._reaper = threading.Thread(target=self._reap, name='CaChannel.util cache')
+            self._reaper.daemon = True
+            self._reaper.start()
+
+    def _reap(self):
+        while True:
+            self._wakeup.wait(max(min(self.idle_timeout / 4., 10.0), 0.1))
+            self._wakeup.clear()
+            with self._lock:
+                now = _monotonic()
+                self._trim(self.max_size, now - self.idle_timeout)
+                self._forget_failures(now)
+                evicted, self._evicted = self._evicted, []
+                if not self._entries and not self._failures and not evicted:
+                    self._reaper = None
+                    return
+            self._evict(evicted)
+
+    def clear(self):
+        """
+        Evict all channels not in use and forget failed names.
+        """
+        with self._lock:
+            self._trim(0, _monotonic() + 1)
+            self._failures.clear()
+
+    def info(self):
+        with self._lock:
+            info = dict(self._stats)
+            info.update(size=len(self._entries),
+                        max_size=self.max_size,
+                        idle_timeout=self.idle_timeout,
+                        failed_names=len(self._failures))
+        return info
+
+    def __len__(self):
+        with self._lock:
+            return len(self._entries)
+
+    def __contains__(self, name):
+        with self._lock:
+            return name in self._entries
 
-    return value
 
+#: channel object cache
+_channels_ = _ChannelCache()
+
+
+def channel_cache_info():
+    """
+    Return the statistics of the channel cache.
+
+    :return: dict with keys *hits*, *misses*, *evictions*, *negative_hits* (lookups refused because
+             the name recently failed to connect), *failures* (failed searches), *size*, *max_size*,
+             *idle_timeout* and *failed_names*.
+    :rtype: dict
 
-def _get_or_create_channel(name):
+    .. versionadded:: 3.3
+    """
+    return _channels_.info()
+
+
+def channel_cache_configure(max_size=None, idle_timeout=None, negative_ttl=None, negative_ttl_max=None):
+    """
+    Change the channel cache limits. Arguments left as *None* are unchanged.
+
+    :param int max_size: maximum number of cached channels
+    :param float idle_timeout: seconds after which an unused channel is evicted
+    :param float negative_ttl: seconds before a name that failed to connect is searched again
+    :param float negative_ttl_max: upper limit of *negative_ttl* as it doubles on consecutive failures
+
+    .. versionadded:: 3.3
+    """
+    _channels_.configure(max_size, idle_timeout, negative_ttl, negative_ttl_max)
+
+
+def _get_or_create_channel(name, pin=False):
     """
     return the channel object associated with *name*. If nothing exists, create a new one.
 
     :param str name: pv name
+    :param bool pin: exempt the channel from eviction, see :meth:`_ChannelCache.pin`
     :return: channel object
     :rtype: :class:`CaChannel.CaChannel`
     """
-    chan = _channels_.get(name)
-    if chan is None:
-        chan = CaChannel(name)
-        chan.searchw()
-        _channels_[name] = chan
-    return chan
+    return _channels_.get(name, pin)
 
 
 def caget(name, as_string=False, count=None):
@@ -89,16 +430,13 @@ def caget(name, as_string=False, count=None):
     :param int count: number of element to request
     :return: pv value
     """
-    chan = _get_or_create_channel(name)
-
-    req_type = ca.dbf_type_to_DBR(chan.field_type())
-    if as_string and req_type == ca.DBR_ENUM:
-        req_type = ca.DBR_STRING
+    with _channels_.channel(name) as chan:
+        req_type = ca.dbf_type_to_DBR(chan.field_type())
+        # getw returns char array as string
+        if as_string and req_type in (ca.DBR_ENUM, ca.DBR_CHAR):
+            req_type = ca.DBR_STRING
 
-    value = chan.getw(req_type, count)
-
-    if as_string and req_type == ca.DBR_CHAR:
-        value = _ints_to_string(value)
+        value = chan.getw(req_type, count)
 
     return value
 
@@ -111,18 +449,224 @@ def caput(name, value, wait=False, timeout=None):
     :param bool wait: wait for completion
     :param float timeout: seconds to wait
     """
-    chan = _get_or_create_channel(name)
-
     def put_callback(_, user_args):
         user_args[0].set()
 
-    if wait:
-        event = threading.Event()
-        chan.array_put_callback(value, None, None, put_callback, event)
-        chan.flush_io()
-        event.wait(timeout)
-    else:
-        chan.putw(value)
+    with _channels_.channel(name) as chan:
+        if wait:
+            event = threading.Event()
+            chan.array_put_callback(value, None, None, put_callback, event)
+            chan.flush_io()
+            event.wait(timeout)
+        else:
+            chan.putw(value)
+
+
+def _per_element(argument, n):
+    if isinstance(argument, (list, tuple)):
+        if len(argument) != n:
+            raise ValueError('expect %d elements, got %d' % (n, len(argument)))
+        return argument
+    return [argument] * n
+
+
+class _Replies(object):
+    """
+    Collect the callback arguments of get or put requests, one per index, and wait for them all.
+    A request that fails or does not complete before the wait times out leaves *None* at its index.
+    """
+    def __init__(self, n):
+        self._lock = threading.Lock()
+        self._done = threading.Event()
+        self._replies = [None] * n
+        # the requests in flight, plus one until wait is called so that early replies do not end the wait
+        self._pending = 1
+
+    def issue(self, index, request):
+        """
+        Call *request* with the callback for *index*. It returns the status of the ca function.
+
+        :return: whether the request was issued
+        """
+        with self._lock:
+            self._pending += 1
+        try:
+            status = request(lambda epics_args: self._reply(index, epics_args))
+        except Exception:
+            status = None
+        if status == ca.ECA_NORMAL:
+            return True
+        self._reply(index, None)
+        return False
+
+    def _reply(self, index, epics_args):
+        with self._lock:
+            if epics_args is not None and epics_args['status'] == ca.ECA_NORMAL:
+                self._replies[index] = epics_args
+            self._pending -= 1
+            if self._pending == 0:
+                self._done.set()
+
+    def wait(self, timeout):
+        self._reply(None, None)
+        self._done.wait(timeout)
+        with self._lock:
+            return list(self._replies)
+
+
+def caget_many(names, as_string=False, count=None, timeout=None):
+    """
+    Return the current values of multiple PVs.
+
+    All PVs are searched at once and all reads are sent in one flush, so the elapsed time
+    is about one round trip instead of one per PV.
+
+    :param names: pv names
+    :param as_string: retrieve enum and char type as string. Either a bool for all PVs or a sequence of bools per PV.
+    :param count: number of element to request. Either an int or *None* for all PVs or a sequence per PV.
+    :param float timeout: seconds to wait for connection and for the values
+    :return: list of pv values in the order of *names*. *None* if the PV could not be read in time.
+
+    >>> caput_many(['catest', 'cabo'], [1.23, 'Busy'], wait=True)
+    [True, True]
+    >>> caget_many(['catest', 'cabo', 'cabo', 'cawave', 'non-exist'], as_string=[False, False, True, False, False], count=[None, None, None, 4, None])
+    [1.23, 1, 'Busy', [0.0, 1.0, 2.0, 3.0], None]
+
+    .. versionadded:: 3.3
+    """
+    names = list(names)
+    as_string = _per_element(as_string, len(names))
+    count = _per_element(count, len(names))
+
+    # read at every call, it can be changed at run time
+    from . import USE_NUMPY as use_numpy
+    replies = _Replies(len(names))
+    with _channels_.channels(names, timeout) as chans:
+        for i, (chan, string, n) in enumerate(zip(chans, as_string, count)):
+            if not isinstance(chan, CaChannel):
+                continue
+            req_type = ca.dbf_type_to_DBR(chan.field_type())
+            if string and req_type == ca.DBR_ENUM:
+                req_type = ca.DBR_STRING
+            if _C_EXTENSION:
+                options = {'pv_fields': True, 'as_string': string and req_type == ca.DBR_CHAR}
+            else:
+                options = {}
+            replies.issue(i, lambda callback, chan=chan, req_type=req_type, n=n:
+                          ca.get(chan._chid, req_type, n, callback, use_numpy, **options)[0])
+
+        for chan in chans:
+            if isinstance(chan, CaChannel):
+                chan.flush_io()
+                break
+
+        epics_args = replies.wait(timeout)
+
+    values = []
+    for args, string in zip(epics_args, as_string):
+        if args is None:
+            values.append(None)
+            continue
+        if not _C_EXTENSION:
+            args = CaChannel._format_cb_args(args, use_numpy)
+            if string and ca.dbr_type_is_CHAR(args['type']):
+                args['pv_value'] = CaChannel._ints_to_string(args['pv_value'])
+        values.append(args['pv_value'])
+
+    return values
+
+
+def caput_many(names, values, wait=False, timeout=None):
+    """
+    Write to multiple PVs.
+
+    All PVs are searched at once and all writes are sent in one flush.
+    If *wait* is True, it returns after all writes complete or *timeout* expires.
+
+    :param names: pv names
+    :param values: values to write, one per pv
+    :param bool wait: wait for completion
+    :param float timeout: seconds to wait for connection and completion
+    :return: list of bool in the order of *names*, whether the write was sent
+             (and completed if *wait* is True)
+
+    .. versionadded:: 3.3
+    """
+    names = list(names)
+    values = list(values)
+    if len(values) != len(names):
+        raise ValueError('expect %d values, got %d' % (len(names), len(values)))
+
+    replies = _Replies(len(names))
+    sent = [False] * len(names)
+    with _channels_.channels(names, timeout) as chans:
+        for i, (chan, value) in enumerate(zip(chans, values)):
+            if not isinstance(chan, CaChannel):
+                continue
+            if wait:
+                sent[i] = replies.issue(i, lambda callback, chan=chan, value=value:
+                                        ca.put(chan._chid, value, None, None, callback))
+            else:
+                try:
+                    chan.array_put(value)
+                except Exception:
+                    continue
+                sent[i] = True
+
+        for chan in chans:
+            if isinstance(chan, CaChannel):
+                chan.flush_io()
+                break
+
+        if wait:
+            sent = [args is not None for args in replies.wait(timeout)]
+
+    return sent
+
+
+def cainfo_many(names, timeout=None):
+    """
+    print information of multiple PVs.
+
+    The PVs are searched at once and the control information are read in one flush.
+    A PV whose control information does not arrive in time is printed without it.
+
+    :param names: pv names
+    :param float timeout: seconds to wait for connection and for the values
+
+    .. versionadded:: 3.3
+    """
+    names = list(names)
+    messages = []
+    replies = _Replies(len(names))
+    with _channels_.channels(names, timeout) as chans:
+        for i, chan in enumerate(chans):
+            if not isinstance(chan, CaChannel) or chan.state() != ca.cs_conn:
+                continue
+            req_type = ca.dbf_type_to_DBR_CTRL(chan.field_type())
+            options = {'pv_fields': True} if _C_EXTENSION else {}
+            replies.issue(i, lambda callback, chan=chan, req_type=req_type:
+                          ca.get(chan._chid, req_type, None, callback, **options)[0])
+
+        for chan in chans:
+            if isinstance(chan, CaChannel):
+                chan.flush_io()
+                break
+
+        ctrl_values = replies.wait(timeout)
+
+        for name, chan, ctrl in zip(names, chans, ctrl_values):
+            if not isinstance(chan, CaChannel):
+                messages.append('%s\n    State:          Not connected (%s)' % (name, chan))
+                continue
+            if ctrl is not None and not _C_EXTENSION:
+                ctrl = CaChannel._format_cb_args(ctrl, False)
+            try:
+                messages.append(_format_info(name, chan, ctrl, read=False))
+            except CaChannelException as e:
+                messages.append('%s\n    State:          %s' % (name, e))
+
+    print('\n'.join(messages))
 
 
 def camonitor(name, as_string=False, count=None, callback=None):
@@ -157,7 +701,8 @@ def camonitor(name, as_string=False, count=None, callback=None):
     >>> time.sleep(2)
 
     """
-    chan = _get_or_create_channel(name)
+    # a monitored channel must stay in the cache, pinned before the reaper can evict it
+    chan = _get_or_create_channel(name, pin=True)
 
     req_type = ca.dbf_type_to_DBR_TIME(chan.field_type())
     if as_string and req_type == ca.DBR_TIME_ENUM:
@@ -168,21 +713,18 @@ def camonitor(name, as_string=False, count=None, callback=None):
         # time.strftime does not support microseconds
         strfmt = datetime.datetime.fromtimestamp(stamp).strftime('%Y-%m-%d %H:%M:%S.%f')
         value = epics_args['pv_value']
-
-        if as_string and req_type == ca.DBR_CHAR:
-            value = _ints_to_string(value)
-
         print('%s %s %s' % (name, strfmt, value))
 
     if callback is not None and not callable(callback):
         chan.clear_event()
         chan.flush_io()
+        _channels_.pin(name, False)
         return
 
     if callback is None:
         callback = monitor_callback
 
-    chan.add_masked_array_event(req_type, count, None, callback)
+    chan.add_masked_array_event(req_type, count, None, callback, as_string=as_string)
     chan.flush_io()
 
 
@@ -205,8 +747,13 @@ def cainfo(name):
         Enumerates:     ('Done', 'Busy')
 
     """
-    chan = _get_or_create_channel(name)
+    with _channels_.channel(name) as chan:
+        message = _format_info(name, chan)
+
+    print(message)
 
+
+def _format_info(name, chan, ctrl=None, read=True):
     r = chan.read_access()
     w = chan.write_access()
     if not r and not w:
@@ -232,8 +779,10 @@ def cainfo(name):
             chan.element_count(),
             access)
 
-    if chan.state() == ca.cs_conn:
+    if ctrl is None and read and chan.state() == ca.cs_conn:
         ctrl = chan.getw(ca.dbf_type_to_DBR_CTRL(chan.field_type()))
+
+    if ctrl is not None:
         message += \
             """
     Status:         %s
@@ -244,7 +793,7 @@ def cainfo(name):
                 """
     Enumerates:     %s""" % (ctrl['pv_statestrings'],)
 
-    print(message)
+    return message
 
 
 if __name__ == '__main__':
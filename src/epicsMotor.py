@@ -12,9 +12,14 @@ Modifications:
   - Reformat the docstring and code indent.
   - Use class property to expose certain fields.
 """
+import threading
 import time
 
 import epicsPV
+from CaChannel import ca
+
+# notified by the monitor callbacks of all motors, so that wait_all can wait for several motors
+_CONDITION = threading.Condition()
 
 
 class epicsMotor(object):
@@ -60,6 +65,9 @@ class epicsMotor(object):
     >>> rrbv = m.get_position(readback=True, step=True) # Get the actual motor position in steps
     >>> m.set_position(100)   # Set the current position to 100 in user coordinates
     >>> m.set_position(10000, step=True) # Set the current position to 10000 steps
+
+    The .DMOV, .RBV and limit fields are monitored. :meth:`wait` and :func:`wait_all` wait for the
+    monitor callbacks instead of reading .DMOV repeatedly.
     """
 
     class PVProperty(object):
@@ -125,7 +133,14 @@ class epicsMotor(object):
                     }
         # Wait for all PVs to connect
         self.pvs['val'].pend_io()
-        self.pvs['dmov'].setMonitor()
+        self.state = _MotorState()
+        for field in _MotorState.FIELDS:
+            pv = self.pvs[field]
+            pv.add_masked_array_event(None, None, ca.DBE_VALUE, _monitorCallback, self.state, field, pv.callBack)
+            # getw on .DMOV and .RBV returns the value of the last callback
+            if field in ('dmov', 'rbv'):
+                pv.callBack.monitorState = 1
+        self.pvs['val'].flush_io()
 
     def move(self, value, relative=False, dial=False, step=False, ignore_limits=False):
         """
@@ -151,29 +166,34 @@ class epicsMotor(object):
         """
         if dial:
             # Position in dial coordinates
+            field = 'dval'
             if relative:
-                current = self.get_position(dial=True)
-                self.pvs['dval'].putw(current+value)
-            else:
-                self.pvs['dval'].putw(value)
-
+                value += self.get_position(dial=True)
         elif step:
             # Position in steps
+            field = 'rval'
             if relative:
-                current = self.get_position(step=True)
-                self.pvs['rval'].putw(current + value)
-            else:
-                self.pvs['rval'].putw(value)
+                value += self.get_position(step=True)
         else:
             # Position in user coordinates
-            if relative:
-                self.pvs['rlv'].putw(value)
-            else:
-                self.pvs['val'].putw(value)
+            field = 'rlv' if relative else 'val'
+
+        # The motor record completes the put when the move is done, or at once if the move did not start
+        with _CONDITION:
+            put = self.state.arm()
+        pv = self.pvs[field]
+        pv.array_put_callback(value, None, None, _putCallback, self.state, put)
+        pv.flush_io()
 
         # Check for limit violations
         if not ignore_limits:
-            self.check_limits()
+            try:
+                self.check_limits()
+            except epicsMotorException:
+                with _CONDITION:
+                    self.state.disarm(put)
+                    _CONDITION.notify_all()
+                raise
 
     def check_limits(self):
         """
@@ -266,19 +286,19 @@ class epicsMotor(object):
         # Put the motor back in "Use" mode
         self.pvs['set'].putw(0)
 
-    def wait(self, start=False, stop=False, poll=0.01, ignore_limits=False):
+    def wait(self, start=False, stop=False, poll=0.01, ignore_limits=False, timeout=None):
         """
         Waits for the motor to start moving and/or stop moving.
 
         :param bool start: If True, wait for the motor to start moving.
         :param bool stop:  If True, wait for the motor to stop moving.
-        :param float poll: The time to wait between reading the
-                           .DMOV field of the record to see if the motor is moving.
+        :param float poll: The interval to process callbacks if the CA context is not preemptive.
                            The default is 0.01 seconds.
         :param bool ignore_limits: If True, suppress raising an exception if a soft or
                                    hard limit is detected.
+        :param float timeout: The maximum time to wait in seconds. The default is to wait forever.
         :raises epicsMotorException: If software limit or hard limit violation detected,
-                                     unless *ignore_limits=True* is set.
+                                     unless *ignore_limits=True* is set, or on timeout.
 
 
         .. note:: If neither the "start" nor "stop" keywords are set then "stop"
@@ -294,16 +314,128 @@ class epicsMotor(object):
         """
         if not start and not stop:
             stop = True
+        deadline = None if timeout is None else time.time() + timeout
         if start:
-            while self.pvs['dmov'].getw() == 1:
-                time.sleep(poll)
+            _wait_for(lambda: self.state.started(), deadline, poll)
         if stop:
-            while self.pvs['dmov'].getw() == 0:
-                time.sleep(poll)
+            _wait_for(lambda: self.state.done(), deadline, poll)
         if not ignore_limits:
             self.check_limits()
 
 
+def wait_all(motors, poll=0.01, ignore_limits=False, timeout=None):
+    """
+    Waits for several motors to stop moving. It returns as soon as the last motor is done.
+
+    :param motors: The :class:`epicsMotor` objects.
+    :param float poll: The interval to process callbacks if the CA context is not preemptive.
+    :param bool ignore_limits: If True, suppress raising an exception if a soft or
+                               hard limit is detected.
+    :param float timeout: The maximum time to wait in seconds. The default is to wait forever.
+    :raises epicsMotorException: If software limit or hard limit violation detected,
+                                 unless *ignore_limits=True* is set, or on timeout.
+
+    >>> motors = [epicsMotor('13BMD:m%d' % i) for i in range(1, 41)]
+    >>> for m in motors:
+    ...     m.move(10)
+    >>> wait_all(motors)
+    """
+    motors = list(motors)
+    deadline = None if timeout is None else time.time() + timeout
+    _wait_for(lambda: all(m.state.done() for m in motors), deadline, poll)
+    if not ignore_limits:
+        for m in motors:
+            m.check_limits()
+
+
+def _wait_for(predicate, deadline, poll):
+    """
+    Wait until *predicate* is true, it is evaluated when a monitor callback arrives.
+    Without preemptive callbacks :meth:`CaChannel.CaChannel.poll` runs the callbacks every *poll* seconds.
+    """
+    preemptive = ca.preemptive_callback_is_enabled()
+    with _CONDITION:
+        while not predicate():
+            interval = poll
+            if deadline is not None:
+                remaining = deadline - time.time()
+                if remaining <= 0:
+                    raise epicsMotorException('Timeout waiting for motor')
+                interval = min(interval, remaining)
+            _CONDITION.wait(interval)
+            if preemptive:
+                continue
+            _CONDITION.release()
+            try:
+                ca.poll()
+            finally:
+                _CONDITION.acquire()
+
+
+class _MotorState(object):
+    """
+    The values of the monitored fields, updated by the monitor callbacks.
+    Like :class:`epicsPV.callBack` it avoids circular references to the :class:`epicsMotor` object.
+    """
+    FIELDS = ('dmov', 'rbv', 'lvio', 'lls', 'hls')
+
+    def __init__(self):
+        self.values = {}
+        # the number of times .DMOV changed to 0, and its value before the last move, None if no move is pending
+        self.moves = 0
+        self.moves_before = None
+        # the number of puts made by move(), it matches a put callback with its move
+        self.puts = 0
+
+    def arm(self):
+        self.puts += 1
+        self.moves_before = self.moves
+        return self.puts
+
+    def disarm(self, put):
+        # the last move did not start, e.g. a soft limit violation or a move within the deadband,
+        # so no .DMOV=0 is coming
+        if put == self.puts and self.moves_before is not None and self.moves == self.moves_before:
+            self.moves_before = None
+
+    def moved(self):
+        # .DMOV=0 of the last move has arrived, until then .DMOV=1 is the value from before the move
+        return self.moves_before is None or self.moves > self.moves_before
+
+    def done(self):
+        return self.values.get('dmov') == 1 and self.moved()
+
+    def started(self):
+        return self.values.get('dmov') == 0 or (self.moves_before is not None and self.moved())
+
+
+def _monitorCallback(epicsArgs, userArgs):
+    """
+    The monitor callback of the .DMOV, .RBV and limit fields. It updates the epicsPV
+    cache, the motor state and wakes up the waiting threads.
+    """
+    state, field, pvCallBack = userArgs
+    if pvCallBack.monitorState != 0:
+        epicsPV.getCallback(epicsArgs, (pvCallBack,))
+    with _CONDITION:
+        value = epicsArgs['pv_value']
+        if field == 'dmov' and value == 0 and state.values.get('dmov') != 0:
+            state.moves += 1
+        state.values[field] = value
+        _CONDITION.notify_all()
+
+
+def _putCallback(epicsArgs, userArgs):
+    """
+    The put callback of :meth:`epicsMotor.move`. If .DMOV has not changed to 0 by then, the move never
+    started and the waiting threads must not wait for it.
+    """
+    state, put = userArgs
+    with _CONDITION:
+        state.disarm(put)
+        _CONDITION.notify_all()
+
+
 class epicsMotorException(Exception):
     def __init__(self, message=''):
         self.message = message
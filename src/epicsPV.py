@@ -17,6 +17,9 @@ Modifications:
 """
 from CaChannel import ca, CaChannel
 
+# the caffi backend has no completion
+HAS_COMPLETION = hasattr(ca, 'completion_create')
+
 
 class epicsPV(CaChannel):
     """
@@ -57,6 +60,7 @@ class epicsPV(CaChannel):
         """
         # Invoke the base class initialization
         self.callBack = callBack()
+        self._completion = ca.completion_create() if HAS_COMPLETION else None
         CaChannel.__init__(self)
         if pvName is not None:
             if wait:
@@ -122,6 +126,8 @@ class epicsPV(CaChannel):
                           by calling :meth:`checkMonitor`.
         :param float poll: The timeout for :meth:`CaChannel.CaChannel.pend_event` calls, waiting for the callback
                            to occur. Shorter times reduce the latency at the price of CPU cycles.
+                           With preemptive callbacks the wait returns as soon as the callback completes,
+                           and it is unused.
 
         >>> pv = epicsPV('13IDC:m1')
         >>> pv.getControl()
@@ -151,6 +157,12 @@ class epicsPV(CaChannel):
         """
         if req_type is None: req_type = self.field_type()
         if wait: self.callBack.newMonitor = 0
+        if self._completion is not None:
+            self.array_get_callback(ca.dbf_type_to_DBR_CTRL(req_type),
+                                    count, getCallback, self.callBack, completion=self._completion)
+            if wait:
+                ca.completion_wait(self._completion, poll=poll)
+            return
         self.array_get_callback(ca.dbf_type_to_DBR_CTRL(req_type),
                                 count, getCallback, self.callBack)
         if wait:
@@ -219,8 +231,14 @@ class epicsPV(CaChannel):
         :param int count:  number of data values to write. Defaults to be the native count.
         :param float poll: The timeout for :meth:`CaChannel.CaChannel.pend_event` calls, waiting for the callback to occur.
                            Shorter times reduce the latency at the price of CPU cycles.
+                           With preemptive callbacks the wait returns as soon as the callback completes,
+                           and it is unused.
         """
         self.callBack.putComplete = 0
+        if self._completion is not None:
+            self.array_put_callback(value, req_type, count, putCallBack, self.callBack, completion=self._completion)
+            ca.completion_wait(self._completion, poll=poll)
+            return
         self.array_put_callback(value, req_type, count, putCallBack, self.callBack)
         while self.callBack.putComplete == 0:
             self.pend_event(poll)
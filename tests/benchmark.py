@@ -0,0 +1,316 @@
+#! /bin/env python
+#
+# filename: benchmark.py
+#
+# Benchmark the ca module against a local soft IOC.
+#
+# A synthetic database of scalar and waveform records is generated and
+# served by a softIoc bound to the loopback interface on a private port,
+# so that results do not depend on the site network or other IOCs.
+# The measurements are written as JSON, to be kept as a baseline and
+# compared between releases.
+#
+#   $ python benchmark.py --scalars 1000 --waveforms 10 --nelm 10000 -o baseline.json
+#
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import platform
+import shutil
+import subprocess
+import tempfile
+import threading
+import time
+
+SCAN_RATES = ['.1 second', '.2 second', '.5 second', '1 second', '2 second', '5 second', '10 second']
+
+
+def generate_db(prefix, scalars, waveforms, nelm, scan):
+    """
+    Return a database of *scalars* ao records, *scalars* calc records counting at *scan* rate,
+    and *waveforms* waveform records of *nelm* doubles processed at *scan* rate.
+    """
+    records = []
+    for i in range(scalars):
+        records.append('record(ao, "%sao%d") {\n    field(PREC, "3")\n}\n' % (prefix, i))
+        records.append('record(calc, "%scalc%d") {\n'
+                       '    field(SCAN, "%s")\n'
+                       '    field(INPA, "%scalc%d")\n'
+                       '    field(CALC, "A+1")\n}\n' % (prefix, i, scan, prefix, i))
+    for i in range(waveforms):
+        records.append('record(waveform, "%swf%d") {\n'
+                       '    field(SCAN, "%s")\n'
+                       '    field(FTVL, "DOUBLE")\n'
+                       '    field(NELM, "%d")\n}\n' % (prefix, i, scan, nelm))
+    return '\n'.join(records)
+
+
+def find_softioc(path=None):
+    if path:
+        return path
+    softioc = shutil.which('softIoc') if hasattr(shutil, 'which') else None
+    if softioc is None and os.environ.get('EPICS_BASE'):
+        host_arch = os.environ.get('EPICS_HOST_ARCH', '')
+        softioc = os.path.join(os.environ['EPICS_BASE'], 'bin', host_arch, 'softIoc')
+    if softioc is None or not os.path.exists(softioc):
+        raise RuntimeError('softIoc not found, add it to PATH or use --softioc')
+    return softioc
+
+
+class SoftIoc(object):
+    """
+    A softIoc serving *db* on the loopback interface at *port*.
+    """
+    def __init__(self, softioc, db, port):
+        self.directory = tempfile.mkdtemp(prefix='cabench')
+        dbfile = os.path.join(self.directory, 'bench.db')
+        with open(dbfile, 'w') as f:
+            f.write(db)
+        env = dict(os.environ)
+        env.update({
+            'EPICS_CAS_INTF_ADDR_LIST': '127.0.0.1',
+            'EPICS_CAS_AUTO_BEACON_ADDR_LIST': 'NO',
+            'EPICS_CAS_BEACON_ADDR_LIST': '127.0.0.1',
+            'EPICS_CA_SERVER_PORT': str(port),
+            'EPICS_CAS_SERVER_PORT': str(port),
+        })
+        self.process = subprocess.Popen([softioc, '-d', dbfile], env=env, cwd=self.directory,
+                                        stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+
+    def close(self):
+        try:
+            self.process.stdin.write(b'exit\n')
+            self.process.stdin.close()
+        except Exception:
+            pass
+        for _ in range(50):
+            if self.process.poll() is not None:
+                break
+            time.sleep(0.1)
+        else:
+            self.process.kill()
+            self.process.wait()
+        shutil.rmtree(self.directory, ignore_errors=True)
+
+
+def percentiles(values, points=(50, 90, 99, 99.9)):
+    if not values:
+        return None
+    values = sorted(values)
+    result = {}
+    for point in points:
+        index = min(len(values) - 1, int(point / 100.0 * len(values)))
+        result[str(point)] = values[index]
+    result['min'] = values[0]
+    result['max'] = values[-1]
+    result['mean'] = sum(values) / len(values)
+    return result
+
+
+def bench_connect(ca, names, timeout):
+    """
+    Time to connect all channels, and the distribution of the individual connection times.
+    """
+    if not names:
+        return [], None
+    connected = {}
+    done = threading.Event()
+    start = time.time()
+
+    def connection_callback(epics_args):
+        if epics_args['op'] == ca.CA_OP_CONN_UP:
+            connected[ca.name(epics_args['chid'])] = time.time() - start
+            if len(connected) == len(names):
+                done.set()
+
+    chids = []
+    for name in names:
+        status, chid = ca.create_channel(name, connection_callback)
+        chids.append(chid)
+    ca.flush_io()
+    done.wait(timeout)
+    elapsed = time.time() - start
+    return chids, {
+        'channels': len(names),
+        'connected': len(connected),
+        'seconds': elapsed,
+        'latency': percentiles(list(connected.values())),
+    }
+
+
+def bench_get(ca, chids, iterations):
+    """
+    Sequential gets, one round trip each, and batched gets of all channels with one pend_io.
+    """
+    start = time.time()
+    for i in range(iterations):
+        status, value = ca.get(chids[i % len(chids)])
+        ca.pend_io(5)
+        value.get()
+    sequential = time.time() - start
+
+    rounds = max(1, iterations // len(chids))
+    start = time.time()
+    for _ in range(rounds):
+        values = [ca.get(chid)[1] for chid in chids]
+        ca.pend_io(5)
+        for value in values:
+            value.get()
+    batched = time.time() - start
+
+    return {
+        'sequential_ops': iterations / sequential,
+        'batched_ops': rounds * len(chids) / batched,
+    }
+
+
+def bench_put(ca, chids, iterations):
+    """
+    Sequential puts with completion callback, and pipelined puts flushed once.
+    """
+    completed = threading.Event()
+
+    def put_callback(epics_args):
+        completed.set()
+
+    start = time.time()
+    for i in range(iterations):
+        completed.clear()
+        ca.put(chids[i % len(chids)], float(i), callback=put_callback)
+        ca.flush_io()
+        completed.wait(5)
+    sequential = time.time() - start
+
+    start = time.time()
+    for i in range(iterations):
+        ca.put(chids[i % len(chids)], float(i))
+    ca.pend_io(5)
+    # a get round trip to the server ensures the puts have been processed
+    ca.get(chids[0])
+    ca.pend_io(5)
+    pipelined = time.time() - start
+
+    return {
+        'sequential_ops': iterations / sequential,
+        'pipelined_ops': iterations / pipelined,
+    }
+
+
+def bench_monitor(ca, chids, duration, use_numpy):
+    """
+    Updates and elements per second received from the subscriptions, and the latency from the
+    record time stamp to the callback (the IOC runs on the same host, thus the same clock).
+    """
+    lock = threading.Lock()
+    latencies = []
+    counters = {'updates': 0, 'elements': 0}
+
+    def monitor_callback(epics_args):
+        now = time.time()
+        value = epics_args['value']
+        with lock:
+            counters['updates'] += 1
+            counters['elements'] += epics_args['count']
+            latencies.append(now - value['stamp']['timestamp'])
+
+    if hasattr(ca, 'enable_latency_stats'):
+        ca.enable_latency_stats()
+
+    evids = []
+    for chid in chids:
+        dbrtype = ca.dbf_type_to_DBR_TIME(ca.field_type(chid))
+        status, evid = ca.create_subscription(chid, monitor_callback, dbrtype, use_numpy=use_numpy)
+        evids.append(evid)
+    ca.flush_io()
+    # skip the initial updates
+    time.sleep(1)
+    with lock:
+        counters['updates'] = counters['elements'] = 0
+        del latencies[:]
+    if hasattr(ca, 'latency_stats'):
+        ca.latency_stats(reset=True)
+    time.sleep(duration)
+    with lock:
+        updates = counters['updates']
+        elements = counters['elements']
+        samples = list(latencies)
+    for evid in evids:
+        ca.clear_subscription(evid)
+    ca.flush_io()
+
+    result = {
+        'subscriptions': len(chids),
+        'updates_per_second': updates / duration,
+        'elements_per_second': elements / duration,
+        'latency': percentiles(samples),
+    }
+    if hasattr(ca, 'latency_stats'):
+        result['callback_latency'] = ca.latency_stats()
+        ca.enable_latency_stats(False)
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmark CaChannel against a local soft IOC')
+    parser.add_argument('--scalars', type=int, default=100, help='number of scalar records')
+    parser.add_argument('--waveforms', type=int, default=10, help='number of waveform records')
+    parser.add_argument('--nelm', type=int, default=1000, help='number of waveform elements')
+    parser.add_argument('--scan', default='.1 second', choices=SCAN_RATES, help='scan rate of the monitored records')
+    parser.add_argument('--iterations', type=int, default=1000, help='number of get and put operations')
+    parser.add_argument('--duration', type=float, default=5, help='seconds to receive monitor updates')
+    parser.add_argument('--port', type=int, default=15064, help='CA server port of the soft IOC')
+    parser.add_argument('--softioc', help='path to the softIoc executable')
+    parser.add_argument('--numpy', action='store_true', help='receive waveforms as numpy arrays')
+    parser.add_argument('-o', '--output', help='JSON output file, default to stdout')
+    args = parser.parse_args()
+
+    # the client only searches the loopback interface on the private port
+    os.environ['EPICS_CA_AUTO_ADDR_LIST'] = 'NO'
+    os.environ['EPICS_CA_ADDR_LIST'] = '127.0.0.1'
+    os.environ['EPICS_CA_SERVER_PORT'] = str(args.port)
+    os.environ['EPICS_CA_MAX_ARRAY_BYTES'] = str(max(16384, args.nelm * 8 + 1024))
+    from CaChannel import ca, __version__
+
+    prefix = 'cabench%d:' % os.getpid()
+    db = generate_db(prefix, args.scalars, args.waveforms, args.nelm, args.scan)
+    ioc = SoftIoc(find_softioc(args.softioc), db, args.port)
+    try:
+        ca.create_context(True)
+        results = {}
+        ao, results['connect'] = bench_connect(ca, ['%sao%d' % (prefix, i) for i in range(args.scalars)], 30)
+        calc, _ = bench_connect(ca, ['%scalc%d' % (prefix, i) for i in range(args.scalars)], 30)
+        wf, _ = bench_connect(ca, ['%swf%d' % (prefix, i) for i in range(args.waveforms)], 30)
+        if ao:
+            results['get'] = bench_get(ca, ao, args.iterations)
+            results['put'] = bench_put(ca, ao, args.iterations)
+        if calc:
+            results['monitor_scalar'] = bench_monitor(ca, calc, args.duration, args.numpy)
+        if wf:
+            results['monitor_waveform'] = bench_monitor(ca, wf, args.duration, args.numpy)
+        for chid in ao + calc + wf:
+            ca.clear_channel(chid)
+        ca.destroy_context()
+    finally:
+        ioc.close()
+
+    report = {
+        'time': time.strftime('%Y-%m-%dT%H:%M:%S'),
+        'platform': platform.platform(),
+        'python': platform.python_version(),
+        'cachannel': __version__,
+        'ca_version': ca.version(),
+        'parameters': vars(args),
+        'results': results,
+    }
+    output = json.dumps(report, indent=2, sort_keys=True, default=str)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(output)
+    else:
+        print(output)
+
+
+if __name__ == '__main__':
+    main()
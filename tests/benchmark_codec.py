@@ -0,0 +1,99 @@
+#! /bin/env python
+#
+# filename: benchmark_codec.py
+#
+# Benchmark the DBR conversion layer of the ca module without network.
+#
+# ca._bench_decode runs the decoding of get and monitor callbacks over a
+# synthetic buffer, ca._bench_encode the encoding of put values. Both
+# report ns/op and, on Python 3.5+ without the limited API,
+# allocations/op of the Python allocators.
+#
+#   $ python benchmark_codec.py --max-count 100000 -o codec.json
+#
+from __future__ import print_function
+
+import argparse
+import json
+import platform
+import time
+
+from CaChannel import ca, __version__
+
+CLASSES = ['', 'STS_', 'TIME_', 'GR_', 'CTRL_']
+TYPES = ['STRING', 'SHORT', 'FLOAT', 'ENUM', 'CHAR', 'LONG', 'DOUBLE']
+
+
+def sizes(max_count):
+    count = 1
+    while count <= max_count:
+        yield count
+        count *= 10
+
+
+def repeat(count, elements):
+    """enough repetitions to process about *elements* elements, at least 3"""
+    return max(3, min(100000, elements // count))
+
+
+def encode_value(dbrtype, count):
+    if dbrtype == ca.DBR_STRING:
+        value = [str(i) for i in range(count)]
+    elif dbrtype in (ca.DBR_FLOAT, ca.DBR_DOUBLE):
+        value = [float(i) for i in range(count)]
+    else:
+        value = [i % 128 for i in range(count)]
+    return value[0] if count == 1 else value
+
+
+def report_line(result):
+    allocations = result['allocations_per_op']
+    print('%-18s %8d %14.1f %12s' % (result['dbrtype'], result['count'], result['ns_per_op'],
+                                     '-' if allocations is None else '%.1f' % allocations))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmark the CaChannel DBR conversion')
+    parser.add_argument('--max-count', type=int, default=1000000, help='largest element count')
+    parser.add_argument('--elements', type=int, default=10000000, help='elements processed per measurement')
+    parser.add_argument('--numpy', action='store_true', help='decode arrays to numpy arrays')
+    parser.add_argument('--callback-args', action='store_true', help='build the complete callback argument')
+    parser.add_argument('-o', '--output', help='JSON output file')
+    args = parser.parse_args()
+
+    results = {'decode': [], 'encode': []}
+    print('%-18s %8s %14s %12s' % ('decode', 'count', 'ns/op', 'allocs/op'))
+    for cls in CLASSES:
+        for name in TYPES:
+            dbrtype = getattr(ca, 'DBR_' + cls + name)
+            for count in sizes(args.max_count):
+                result = ca._bench_decode(dbrtype, count, repeat(count, args.elements),
+                                          use_numpy=args.numpy, callback_args=args.callback_args)
+                result.update(dbrtype='DBR_' + cls + name, count=count)
+                results['decode'].append(result)
+                report_line(result)
+
+    print('%-18s %8s %14s %12s' % ('encode', 'count', 'ns/op', 'allocs/op'))
+    for name in TYPES:
+        dbrtype = getattr(ca, 'DBR_' + name)
+        for count in sizes(args.max_count):
+            result = ca._bench_encode(encode_value(dbrtype, count), dbrtype, count, repeat(count, args.elements))
+            result.update(dbrtype='DBR_' + name, count=count)
+            results['encode'].append(result)
+            report_line(result)
+
+    if args.output:
+        report = {
+            'time': time.strftime('%Y-%m-%dT%H:%M:%S'),
+            'platform': platform.platform(),
+            'python': platform.python_version(),
+            'cachannel': __version__,
+            'parameters': vars(args),
+            'results': results,
+        }
+        with open(args.output, 'w') as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,88 @@
+#! /bin/env python
+#
+# filename: benchmark_import.py
+#
+# Measure the import time of CaChannel with python -X importtime (Python 3.7+).
+#
+# Every run imports the package in a new interpreter. The median self and
+# cumulative times of the main modules are reported. With --budget-ms the
+# script fails if the self time of the extension module exceeds the budget.
+#
+#   $ python benchmark_import.py --runs 20 --budget-ms 5 -o import.json
+#
+from __future__ import print_function
+
+import argparse
+import json
+import platform
+import subprocess
+import sys
+import time
+
+MODULES = ['CaChannel', 'CaChannel.ca', 'CaChannel._ca', 'CaChannel.CaChannel', 'numpy', 'enum']
+
+
+def import_times(statement):
+    """self and cumulative import time in us of every module imported by *statement*"""
+    output = subprocess.run([sys.executable, '-X', 'importtime', '-c', statement],
+                            stderr=subprocess.PIPE, universal_newlines=True, check=True).stderr
+    times = {}
+    for line in output.splitlines():
+        if not line.startswith('import time:') or 'self [us]' in line:
+            continue
+        self_us, cumulative_us, name = line[len('import time:'):].split('|')
+        times[name.strip()] = (int(self_us), int(cumulative_us))
+    return times
+
+
+def median(values):
+    values = sorted(values)
+    return values[len(values) // 2] if values else None
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Measure the import time of CaChannel')
+    parser.add_argument('--runs', type=int, default=10, help='number of interpreter runs')
+    parser.add_argument('--statement', default='import CaChannel', help='import statement to measure')
+    parser.add_argument('--budget-ms', type=float, help='maximum self time of CaChannel._ca')
+    parser.add_argument('-o', '--output', help='JSON output file')
+    args = parser.parse_args()
+
+    runs = [import_times(args.statement) for _ in range(args.runs)]
+
+    results = {}
+    print('%-22s %12s %12s' % ('module', 'self [ms]', 'total [ms]'))
+    for module in MODULES:
+        samples = [run[module] for run in runs if module in run]
+        if not samples:
+            continue
+        results[module] = {
+            'self_ms': median([s[0] for s in samples]) / 1000.0,
+            'cumulative_ms': median([s[1] for s in samples]) / 1000.0,
+        }
+        print('%-22s %12.2f %12.2f' % (module, results[module]['self_ms'], results[module]['cumulative_ms']))
+
+    if args.output:
+        report = {
+            'time': time.strftime('%Y-%m-%dT%H:%M:%S'),
+            'platform': platform.platform(),
+            'python': platform.python_version(),
+            'parameters': vars(args),
+            'results': results,
+        }
+        with open(args.output, 'w') as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+
+    if args.budget_ms is not None:
+        spent = results.get('CaChannel._ca', {}).get('self_ms')
+        if spent is None:
+            print('CaChannel._ca was not imported')
+            return 1
+        if spent > args.budget_ms:
+            print('CaChannel._ca import takes %.2f ms, over the budget of %.2f ms' % (spent, args.budget_ms))
+            return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,4 +1,12 @@
 from CaChannel import ca
+import math
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
 import unittest
 
 class CaTest(unittest.TestCase):
@@ -255,6 +263,299 @@ class CaGroupTest(CaTest):
             ca.clear_channel(chid)
         ca.flush_io()
 
+class CaChannelTest(CaTest):
+
+    def setUp(self):
+        status, chid = ca.create_channel(self.chanName)
+        self.assertNormal(status)
+        status = ca.pend_io(10)
+        self.assertNormal(status)
+        self.assertTrue(ca.state(chid) == ca.cs_conn)
+        self.chid = chid
+
+    def putw(self, value, chid=None):
+        status = ca.put(chid or self.chid, value)
+        self.assertNormal(status)
+        ca.pend_event(0.2)
+
+    def stamp_ns(self):
+        status, dbrValue = ca.get(self.chid, chtype=ca.DBR_TIME_DOUBLE, stamp_ns=True)
+        self.assertNormal(status)
+        status = ca.pend_io(10)
+        self.assertNormal(status)
+        return dbrValue.get()['stamp']
+
+    def tearDown(self):
+        ca.clear_channel(self.chid)
+        ca.flush_io()
+
+class CaStampTest(CaChannelTest):
+
+    def test_stamp_ns(self):
+        self.putw(1.5)
+        # the record is not processed in between, both have its time stamp
+        status, dbrValue = ca.get(self.chid, chtype=ca.DBR_TIME_DOUBLE)
+        self.assertNormal(status)
+        status, dbrValueNs = ca.get(self.chid, chtype=ca.DBR_TIME_DOUBLE, stamp_ns=True)
+        self.assertNormal(status)
+        status = ca.pend_io(10)
+        self.assertNormal(status)
+        stamp = dbrValue.get()['stamp']
+        self.assertEqual(dbrValueNs.get()['stamp'], stamp['seconds'] * 1000000000 + stamp['nanoseconds'])
+
+class CaRecorderTest(CaChannelTest):
+
+    def __init__(self, testName, chanName, otherName):
+        CaChannelTest.__init__(self, testName, chanName)
+        self.otherName = otherName
+
+    def setUp(self):
+        CaChannelTest.setUp(self)
+        status, self.other = ca.create_channel(self.otherName)
+        self.assertNormal(status)
+        status = ca.pend_io(10)
+        self.assertNormal(status)
+        self.directory = tempfile.mkdtemp()
+        self.path = os.path.join(self.directory, 'run')
+
+    def record(self, values):
+        recorder = ca.recorder_open(self.path)
+        self.putw(values[0])
+        self.putw(0, self.other)
+        status, evid = ca.create_subscription(self.chid, None, chtype=ca.DBR_TIME_DOUBLE, recorder=recorder)
+        self.assertNormal(status)
+        status, other_evid = ca.create_subscription(self.other, None, chtype=ca.DBR_TIME_LONG, recorder=recorder)
+        self.assertNormal(status)
+        ca.pend_event(0.2)
+        for value in values[1:]:
+            self.putw(value)
+        ca.clear_subscription(evid)
+        ca.clear_subscription(other_evid)
+        ca.pend_event(0.05)
+        ca.recorder_close(recorder)
+
+    def test_replay(self):
+        self.record([0.5, 1.5, 2.5, 3.5])
+
+        updates = []
+        info = ca.replay(self.path, updates.append, speed='max')
+        self.assertEqual(info['callbacks'], len(updates))
+        values = [args['value']['value'] for args in updates if args['name'] == self.chanName]
+        self.assertEqual(values, [0.5, 1.5, 2.5, 3.5])
+        self.assertEqual([args['value']['value'] for args in updates if args['name'] == self.otherName], [0])
+
+        # only the updates of the given channels
+        updates = []
+        ca.replay(self.path, updates.append, speed='max', channels=[self.otherName])
+        self.assertEqual([args['name'] for args in updates], [self.otherName])
+
+    def test_corrupt(self):
+        self.record([0.5, 1.5])
+
+        # the size of the first record is less than its header
+        segment = self.path + '-000000.carec'
+        with open(segment, 'rb') as f:
+            data = bytearray(f.read())
+        header_size, = struct.unpack_from('I', data, 8)
+        struct.pack_into('I', data, header_size, 4)
+        with open(segment, 'wb') as f:
+            f.write(data)
+        self.assertRaises(ValueError, ca.replay, self.path, lambda args: None, speed='max')
+
+    def test_segments(self):
+        # the index of the first segment cannot be written
+        os.mkdir(self.path + '-000000.caidx')
+        recorder = ca.recorder_open(self.path, segment_size=4096)
+        status, evid = ca.create_subscription(self.chid, None, chtype=ca.DBR_TIME_DOUBLE, recorder=recorder)
+        self.assertNormal(status)
+        # an update larger than a segment is dropped
+        status, other_evid = ca.create_subscription(self.other, None, chtype=ca.DBR_DOUBLE, count=1000, recorder=recorder)
+        self.assertNormal(status)
+        ca.pend_event(0.2)
+        for i in range(150):
+            ca.put(self.chid, i)
+            ca.pend_event(0.01)
+        ca.pend_event(0.2)
+        ca.clear_subscription(evid)
+        ca.clear_subscription(other_evid)
+        ca.pend_event(0.05)
+        stats = ca.recorder_stats(recorder)
+        ca.recorder_close(recorder)
+
+        self.assertEqual(stats['dropped'], 1)
+        self.assertEqual(stats['index_errors'], 1)
+        self.assertTrue(stats['segments'] >= 2)
+        self.assertTrue(os.path.exists(self.path + '-000001.caidx'))
+        # the updates of all segments, in order
+        updates = []
+        info = ca.replay(self.path, updates.append, speed='max')
+        self.assertEqual(info['segments'], stats['segments'])
+        self.assertEqual(len(updates), stats['records'])
+        values = [args['value']['value'] for args in updates]
+        self.assertEqual(values[-1], 149)
+        self.assertEqual(values[1:], sorted(values[1:]))
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+        ca.clear_channel(self.other)
+        CaChannelTest.tearDown(self)
+
+class CaSamplerTest(CaChannelTest):
+
+    def test_sample(self):
+        sampler = ca.sampler_create(tolerance=1.0)
+        status, evid = ca.create_subscription(self.chid, None, chtype=ca.DBR_TIME_DOUBLE, sampler=sampler)
+        self.assertNormal(status)
+        self.putw(5)
+        first = self.stamp_ns()
+        self.putw(6)
+        second = self.stamp_ns()
+
+        # the latest update at or before each sample time, NaN if older than the tolerance
+        ca.sampler_sample(sampler, at=(first + (second - first) // 2) * 1e-9)
+        ca.sampler_sample(sampler, at=second * 1e-9 + 0.5)
+        ca.sampler_sample(sampler, at=second * 1e-9 + 2.0)
+        # a sample time exact to the nanosecond
+        ca.sampler_sample(sampler, at=1700000000.25)
+        data = ca.sampler_data(sampler, stamp_ns=True)
+        ca.clear_subscription(evid)
+        ca.sampler_close(sampler)
+
+        self.assertEqual(data['channels'], [self.chanName])
+        values = [row[0] for row in data['value']]
+        self.assertEqual(values[:2], [5, 6])
+        self.assertTrue(math.isnan(values[2]))
+        self.assertEqual(data['stale'], 1)
+        stamps = [int(row[0].astype('int64')) if hasattr(row[0], 'astype') else row[0] for row in data['timestamp']]
+        self.assertEqual(stamps[:3], [first, second, second])
+        time = data['time'][3]
+        self.assertEqual(int(time.astype('int64')) if hasattr(time, 'astype') else time, 1700000000250000000)
+
+class CaShmTest(CaChannelTest):
+
+    def setUp(self):
+        CaChannelTest.setUp(self)
+        self.name = 'cachannel_test_%d' % os.getpid()
+
+    def publish(self, value):
+        publisher = ca.shm_create(self.name, slots=4, slot_size=256)
+        status, evid = ca.create_subscription(self.chid, None, chtype=ca.DBR_TIME_DOUBLE, shm=publisher)
+        self.assertNormal(status)
+        self.putw(value)
+        ca.clear_subscription(evid)
+        ca.pend_event(0.05)
+        return publisher
+
+    def test_round_trip(self):
+        publisher = self.publish(4.5)
+        # only one publisher per name
+        self.assertRaises(IOError, ca.shm_create, self.name)
+
+        reader = ca.shm_attach(self.name)
+        self.assertEqual(ca.shm_channels(reader), [self.chanName])
+        self.assertEqual(ca.shm_read(reader, self.chanName)['value']['value'], 4.5)
+        self.assertEqual(list(ca.shm_read(reader)), [self.chanName])
+        self.assertRaises(KeyError, ca.shm_read, reader, 'non-exist')
+        ca.shm_close(reader)
+        self.assertRaises(ValueError, ca.shm_read, reader)
+        ca.shm_close(publisher)
+        self.assertRaises(IOError, ca.shm_attach, self.name)
+
+    def test_stale(self):
+        path = '/dev/shm/' + self.name
+        if not os.path.isdir('/dev/shm'):
+            self.skipTest('no /dev/shm')
+        publisher = self.publish(5.5)
+        with open(path, 'rb') as f:
+            data = bytearray(f.read())
+        ca.shm_close(publisher)
+
+        # the region of a publisher which exited without closing it
+        child = subprocess.Popen([sys.executable, '-c', ''])
+        child.wait()
+        struct.pack_into('Q', data, 32, child.pid)
+        with open(path, 'wb') as f:
+            f.write(data)
+        reader = ca.shm_attach(self.name)
+        self.assertEqual(ca.shm_read(reader, self.chanName)['value']['value'], 5.5)
+        ca.shm_close(reader)
+
+        # a new publisher replaces it
+        publisher = ca.shm_create(self.name, slots=2, slot_size=256)
+        self.assertEqual(ca.shm_stats(publisher)['pid'], os.getpid())
+        self.assertEqual(ca.shm_channels(publisher), [])
+        ca.shm_close(publisher)
+
+        # a layout shm_create does not write
+        struct.pack_into('I', data, 16, 100)
+        with open(path, 'wb') as f:
+            f.write(data)
+        self.assertRaises(ValueError, ca.shm_attach, self.name)
+        os.remove(path)
+
+class CaContextPoolTest(CaTest):
+
+    def test_placement(self):
+        with ca.ContextPool(3, placement='prefix') as pool:
+            self.assertEqual(len(pool), 3)
+            # the PVs of one IOC share a context
+            self.assertTrue(pool.context_for('ioc1:a') is pool.context_for('ioc1:b'))
+            self.assertTrue(pool.context_for('ioc1:a') in pool.contexts)
+        with ca.ContextPool(3, placement=lambda name: 'host') as pool:
+            self.assertTrue(pool.context_for('ioc1:a') is pool.context_for('ioc2:a'))
+
+    def test_fan_out(self):
+        # keys chosen to place the two channels in different contexts
+        keys = {self.chanName[0]: 'catest', self.chanName[1]: 'a'}
+        with ca.ContextPool(2, placement=keys.get) as pool:
+            self.assertFalse(pool.context_for(self.chanName[0]) is pool.context_for(self.chanName[1]))
+            chids = []
+            for name in self.chanName:
+                status, chid = pool.create_channel(name)
+                self.assertNormal(status)
+                chids.append(chid)
+            self.assertNormal(pool.pend_io(10))
+
+            # the puts are sent by the flush of each context
+            for i, chid in enumerate(chids):
+                self.assertNormal(pool.put(chid, i + 1))
+            self.assertNormal(pool.flush_io())
+            time.sleep(0.2)
+            # a get without callback completes in the pend_io of its context
+            dbrValues = []
+            for chid in chids:
+                status, dbrValue = pool.get(chid)
+                self.assertNormal(status)
+                dbrValues.append(dbrValue)
+            self.assertNormal(pool.pend_io(10))
+            self.assertEqual([dbrValue.get() for dbrValue in dbrValues], [1, 2])
+            for chid in chids:
+                pool.clear_channel(chid)
+
+class CaCompletionTest(CaChannelTest):
+
+    def test_completion(self):
+        completion = ca.completion_create()
+        values = []
+        status = ca.put(self.chid, 2.5, completion=completion)
+        self.assertNormal(status)
+        for i in range(3):
+            status, _ = ca.get(self.chid, callback=lambda args: values.append(args['value']), completion=completion)
+            self.assertNormal(status)
+        self.assertTrue(ca.completion_wait(completion, timeout=10))
+        self.assertEqual(ca.completion_pending(completion), 0)
+        self.assertEqual(values, [2.5] * 3)
+
+    def test_timeout(self):
+        # the put completes after the output delay of the record
+        completion = ca.completion_create()
+        status = ca.put(self.chid, 1, completion=completion)
+        self.assertNormal(status)
+        self.assertFalse(ca.completion_wait(completion, timeout=0.5))
+        self.assertEqual(ca.completion_pending(completion), 1)
+        self.assertTrue(ca.completion_wait(completion, timeout=10))
+        self.assertEqual(ca.completion_pending(completion), 0)
+
 if __name__ == '__main__':
     ca.add_exception_event(lambda _: None)
 
@@ -356,6 +657,19 @@ if __name__ == '__main__':
                 suit.addTest(CaGetTest(func, "cawave", dbrType, value, use_numpy))
 
 
+    suit.addTest(CaStampTest("test_stamp_ns", "catest"))
+    suit.addTest(CaRecorderTest("test_replay", "catest", "calong"))
+    suit.addTest(CaRecorderTest("test_corrupt", "catest", "calong"))
+    suit.addTest(CaRecorderTest("test_segments", "catest", "cawavehuge"))
+    suit.addTest(CaSamplerTest("test_sample", "catest"))
+    suit.addTest(CaShmTest("test_round_trip", "catest"))
+    suit.addTest(CaShmTest("test_stale", "catest"))
+    suit.addTest(CaContextPoolTest("test_placement", None))
+    suit.addTest(CaContextPoolTest("test_fan_out", ["catest", "calong"]))
+    suit.addTest(CaCompletionTest("test_completion", "catest"))
+    # cadelay completes a put after 2 seconds
+    suit.addTest(CaCompletionTest("test_timeout", "cadelay"))
+
     #suit.addTest(CaGroupTest("test_group", [
     #                            ("cabo",   ca.DBR_STRING, "Busy"),
     #                            ('catest', ca.DBR_DOUBLE, 1),
@@ -365,5 +679,4 @@ if __name__ == '__main__':
     result = unittest.TextTestRunner(failfast=True).run(suit)
 
     # exit code is 1 if failures happen
-    import sys
     sys.exit(len(result.failures))
@@ -0,0 +1,145 @@
+#! /bin/env python
+#
+# filename: motor_test.py
+#
+# Test epicsMotor.wait and wait_all without a motor record. The PVs are replaced by a
+# simulation that posts the .DMOV monitors and completes the put from another thread some
+# time after the put, as an IOC does.
+#
+#   $ python motor_test.py
+#
+import threading
+import time
+import unittest
+
+import epicsMotor
+import epicsPV
+
+
+class SimulatedMotor(object):
+    def __init__(self, delay=0.05, duration=0.1, moves=True):
+        self.delay = delay
+        self.duration = duration
+        # if False the put completes without changing .DMOV, as a move within the deadband
+        self.moves = moves
+        self.values = {'dmov': 1, 'rbv': 0.0, 'val': 0.0, 'lvio': 0, 'lls': 0, 'hls': 0}
+        self.monitors = {}
+
+    def post(self, field, value):
+        self.values[field] = value
+        if field in self.monitors:
+            callback, user_args = self.monitors[field]
+            callback({'pv_value': value}, user_args)
+
+    def start(self, position, callback, user_args):
+        def run():
+            time.sleep(self.delay)
+            if self.moves:
+                self.post('dmov', 0)
+                time.sleep(self.duration)
+                self.post('rbv', position)
+                self.post('dmov', 1)
+            callback({'status': 1}, user_args)
+        thread = threading.Thread(target=run)
+        thread.daemon = True
+        thread.start()
+
+
+class SimulatedPV(object):
+    motor = None
+
+    def __init__(self, name, wait=True):
+        self.field = name.split('.')[-1].lower()
+        self.callBack = epicsPV.callBack()
+        self.motor = SimulatedPV.motor
+
+    def pend_io(self, timeout=None):
+        pass
+
+    def flush_io(self):
+        pass
+
+    def add_masked_array_event(self, req_type, count, mask, callback, *user_args):
+        self.motor.monitors[self.field] = (callback, user_args)
+        # the first monitor has the current value
+        callback({'pv_value': self.getw()}, user_args)
+
+    def getw(self, req_type=None, count=None):
+        return self.motor.values.get(self.field, 0)
+
+    def putw(self, value):
+        self.motor.values[self.field] = value
+
+    def array_put_callback(self, value, req_type, count, callback, *user_args):
+        self.motor.values[self.field] = value
+        self.motor.start(value, callback, user_args)
+
+
+def create_motor(simulation):
+    SimulatedPV.motor = simulation
+    original = epicsPV.epicsPV
+    epicsPV.epicsPV = SimulatedPV
+    try:
+        return epicsMotor.epicsMotor('sim:m1')
+    finally:
+        epicsPV.epicsPV = original
+
+
+class MotorWaitTest(unittest.TestCase):
+
+    def test_wait(self):
+        simulation = SimulatedMotor()
+        m = create_motor(simulation)
+        m.move(10, ignore_limits=True)
+        m.wait(ignore_limits=True, timeout=5)
+        self.assertEqual(simulation.values['dmov'], 1)
+        self.assertEqual(simulation.values['rbv'], 10)
+
+    def test_wait_start(self):
+        simulation = SimulatedMotor()
+        m = create_motor(simulation)
+        m.move(5, ignore_limits=True)
+        m.wait(start=True, ignore_limits=True, timeout=5)
+        self.assertEqual(simulation.values['dmov'], 0)
+        m.wait(ignore_limits=True, timeout=5)
+        self.assertEqual(simulation.values['rbv'], 5)
+
+    def test_wait_all(self):
+        simulations = [SimulatedMotor(delay=0.02 * i) for i in range(1, 4)]
+        motors = [create_motor(simulation) for simulation in simulations]
+        for i, m in enumerate(motors):
+            m.move(i + 1, ignore_limits=True)
+        epicsMotor.wait_all(motors, ignore_limits=True, timeout=5)
+        for i, simulation in enumerate(simulations):
+            self.assertEqual(simulation.values['dmov'], 1)
+            self.assertEqual(simulation.values['rbv'], i + 1)
+
+    def test_wait_idle(self):
+        m = create_motor(SimulatedMotor())
+        m.wait(ignore_limits=True, timeout=1)
+
+    def test_wait_no_motion(self):
+        m = create_motor(SimulatedMotor(moves=False))
+        m.move(0, ignore_limits=True)
+        m.wait(ignore_limits=True, timeout=5)
+        motors = [create_motor(SimulatedMotor()), m]
+        for i, m in enumerate(motors):
+            m.move(i, ignore_limits=True)
+        epicsMotor.wait_all(motors, ignore_limits=True, timeout=5)
+
+    def test_limit_violation(self):
+        # the put completes only after the wait times out
+        simulation = SimulatedMotor(delay=5, moves=False)
+        simulation.values['lvio'] = 1
+        m = create_motor(simulation)
+        self.assertRaises(epicsMotor.epicsMotorException, m.move, 100)
+        m.wait(ignore_limits=True, timeout=1)
+
+    def test_timeout(self):
+        m = create_motor(SimulatedMotor(duration=5))
+        m.move(1, ignore_limits=True)
+        self.assertRaises(epicsMotor.epicsMotorException, m.wait, ignore_limits=True, timeout=0.2)
+
+
+if __name__ == '__main__':
+    unittest.main()